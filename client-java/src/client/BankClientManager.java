@@ -1,10 +1,12 @@
 package client;
 
 import common.Constants;
-import common.Marshaller;
+import common.CurrencyType;
+import common.Messages;
 import common.NetworkUtil;
 
 import java.lang.reflect.Field;
+import java.math.BigDecimal;
 import java.net.DatagramPacket;
 import java.net.DatagramSocket;
 import java.net.InetAddress;
@@ -77,12 +79,10 @@ public class BankClientManager {
         }
     }
 
-    public Result openAccount(String name, String password, String currency, float initialBalance) throws Exception {
+    public Result openAccount(String name, String password, String currency, BigDecimal initialBalance) throws Exception {
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packString(payloadBuf, name);
-        Marshaller.packString(payloadBuf, password);
-        Marshaller.packFloat(payloadBuf, initialBalance);
-        Marshaller.packString(payloadBuf, currency);
+        Messages.packOpen(payloadBuf, false, name, password,
+                CurrencyType.toMinorUnits(currency, initialBalance), currency);
 
         int opCode = Constants.OP_OPEN_ACCOUNT;
         Response response = sendRequest(opCode, payloadBuf);
@@ -97,10 +97,7 @@ public class BankClientManager {
 
     public Result login(int accountId, String name, String password, String currency) throws Exception {
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, accountId);
-        Marshaller.packString(payloadBuf, name);
-        Marshaller.packString(payloadBuf, password);
-        Marshaller.packString(payloadBuf, currency);
+        Messages.packCheckBalance(payloadBuf, false, accountId, name, password, currency);
 
         int opCode = Constants.OP_CHECK_BALANCE;
         Response response = sendRequest(opCode, payloadBuf);
@@ -112,64 +109,50 @@ public class BankClientManager {
         return new Result(response.status, response.message, response.payload);
     }
 
-    public Result deposit(int accountId, String currency, float amount) throws Exception {
+    public Result deposit(int accountId, String currency, BigDecimal amount) throws Exception {
         UserSession session = requireSession();
 
         int opCode = Constants.OP_DEPOSIT;
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, accountId);
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
-        Marshaller.packString(payloadBuf, currency);
-        Marshaller.packFloat(payloadBuf, amount);
+        Messages.packDeposit(payloadBuf, false, accountId, session.getName(), session.getPassword(), currency,
+                CurrencyType.toMinorUnits(currency, amount));
 
         Response response = sendRequest(opCode, payloadBuf);
         return new Result(response.status, response.message, response.payload);
     }
 
-    public Result transfer(int receiverId, String currency, float amount) throws Exception {
+    public Result transfer(int receiverId, String currency, BigDecimal amount) throws Exception {
         UserSession session = requireSession();
 
         int opCode = Constants.OP_TRANSFER;
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, session.getAccountId());
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
-        Marshaller.packString(payloadBuf, currency);
-        Marshaller.packFloat(payloadBuf, amount);
-        Marshaller.packInt(payloadBuf, receiverId);
+        Messages.packTransfer(payloadBuf, false, session.getAccountId(), session.getName(), session.getPassword(),
+                currency, CurrencyType.toMinorUnits(currency, amount), receiverId);
 
         Response response = sendRequest(opCode, payloadBuf);
         return new Result(response.status, response.message, response.payload);
     }
 
-    public Result exchange(String fromCurrency, String toCurrency, float amountToExchange) throws Exception {
+    public Result exchange(String fromCurrency, String toCurrency, BigDecimal amountToExchange) throws Exception {
         UserSession session = requireSession();
 
         int opCode = Constants.OP_EXCHANGE;
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, session.getAccountId());
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
-        Marshaller.packString(payloadBuf, fromCurrency);
-        Marshaller.packString(payloadBuf, toCurrency);
-        Marshaller.packFloat(payloadBuf, amountToExchange);
+        Messages.packExchange(payloadBuf, false, session.getAccountId(), session.getName(), session.getPassword(),
+                fromCurrency, toCurrency, CurrencyType.toMinorUnits(toCurrency, amountToExchange));
 
         Response response = sendRequest(opCode, payloadBuf);
         return new Result(response.status, response.message, response.payload);
     }
 
-    public Result withdraw(int accountId, String currency, float amount) throws Exception {
+    public Result withdraw(int accountId, String currency, BigDecimal amount) throws Exception {
         UserSession session = requireSession();
 
         int opCode = Constants.OP_WITHDRAW;
 
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, accountId);
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
-        Marshaller.packString(payloadBuf, currency);
-        Marshaller.packFloat(payloadBuf, amount);
+        Messages.packWithdraw(payloadBuf, false, accountId, session.getName(), session.getPassword(), currency,
+                CurrencyType.toMinorUnits(currency, amount));
 
         Response response = sendRequest(opCode, payloadBuf);
         return new Result(response.status, response.message, response.payload);
@@ -180,10 +163,8 @@ public class BankClientManager {
 
         int opCode = Constants.OP_CHECK_BALANCE;
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, session.getAccountId());
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
-        Marshaller.packString(payloadBuf, currency);
+        Messages.packCheckBalance(payloadBuf, false, session.getAccountId(), session.getName(), session.getPassword(),
+                currency);
 
         Response response = sendRequest(opCode, payloadBuf);
         return new Result(response.status, response.message, response.payload);
@@ -194,9 +175,7 @@ public class BankClientManager {
 
         int opCode = Constants.OP_CLOSE_ACCOUNT;
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packInt(payloadBuf, session.getAccountId());
-        Marshaller.packString(payloadBuf, session.getName());
-        Marshaller.packString(payloadBuf, session.getPassword());
+        Messages.packClose(payloadBuf, false, session.getAccountId(), session.getName(), session.getPassword());
 
         Response response = sendRequest(opCode, payloadBuf);
         if (response.status == Constants.STATUS_OK) {
@@ -208,6 +187,13 @@ public class BankClientManager {
     }
 
     public Result startMonitor(long durationMillis) throws Exception {
+        return startMonitor(durationMillis, new int[0], 0, 0f);
+    }
+
+    // only the callbacks of the given accounts (all if empty, sent as ranges covering
+    // up to 4096 accounts), of the ops whose bit 1 << op is set in opMask (all if 0),
+    // moving at least minAmount
+    public Result startMonitor(long durationMillis, int[] accounts, int opMask, float minAmount) throws Exception {
         if (durationMillis <= 0) {
             return new Result(Constants.STATUS_ERROR, "Invalid monitor duration", new byte[0]);
         }
@@ -223,7 +209,7 @@ public class BankClientManager {
         }
 
         ByteBuffer payloadBuf = ByteBuffer.allocate(Constants.BUFFER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
-        Marshaller.packLong(payloadBuf, durationMillis);
+        Messages.packMonitor(payloadBuf, false, durationMillis, accountRanges(accounts), opMask, minAmount, 0, 0);
 
         Response response = sendRequestWithSocket(Constants.OP_MONITOR, payloadBuf, monitorSocket);
         if (response.status == Constants.STATUS_OK) {
@@ -232,6 +218,26 @@ public class BankClientManager {
         return new Result(response.status, response.message, response.payload);
     }
 
+    // first id, last id and step of each run of evenly spaced ids, flattened as the
+    // monitor request carries them
+    private static int[] accountRanges(int[] accounts) {
+        int[] ids = Arrays.stream(accounts).distinct().sorted().toArray();
+        int[] ranges = new int[3 * ids.length];
+        int n = 0;
+        for (int i = 0; i < ids.length; ) {
+            int j = i;
+            int step = i + 1 < ids.length ? ids[i + 1] - ids[i] : 1;
+            while (j + 1 < ids.length && ids[j + 1] - ids[j] == step) {
+                j++;
+            }
+            ranges[n++] = ids[i];
+            ranges[n++] = ids[j];
+            ranges[n++] = step;
+            i = j + 1;
+        }
+        return Arrays.copyOf(ranges, n);
+    }
+
     private UserSession requireSession() {
         UserSession session = getCurrentUser();
         if (session == null) {
@@ -1,9 +1,11 @@
 package client;
 
 import common.Constants;
+import common.CurrencyType;
 import common.Marshaller;
 import common.NetworkUtil;
 
+import java.math.BigDecimal;
 import java.net.DatagramPacket;
 import java.net.DatagramSocket;
 import java.net.InetAddress;
@@ -83,12 +85,12 @@ public class ClientMain {
                         String pwd = scanner.nextLine();
                         String curr = readCurrency(scanner);
                         System.out.print("Enter Initial Balance: ");
-                        float bal = Float.parseFloat(scanner.nextLine());
+                        BigDecimal bal = new BigDecimal(scanner.nextLine().trim());
 
                         opCode = Constants.OP_OPEN_ACCOUNT;
                         Marshaller.packString(payloadBuf, name);
                         Marshaller.packString(payloadBuf, pwd);
-                        Marshaller.packFloat(payloadBuf, bal);
+                        Marshaller.packLong(payloadBuf, CurrencyType.toMinorUnits(curr, bal));
                         Marshaller.packString(payloadBuf, curr);
                         break;
 
@@ -131,14 +133,14 @@ public class ClientMain {
                         String depPwd = scanner.nextLine();
                         String depCurr = readCurrency(scanner);
                         System.out.print("Enter Amount: ");
-                        float depAmt = Float.parseFloat(scanner.nextLine());
+                        BigDecimal depAmt = new BigDecimal(scanner.nextLine().trim());
 
                         opCode = Constants.OP_DEPOSIT;
                         Marshaller.packInt(payloadBuf, depId);
                         Marshaller.packString(payloadBuf, depName);
                         Marshaller.packString(payloadBuf, depPwd);
                         Marshaller.packString(payloadBuf, depCurr);
-                        Marshaller.packFloat(payloadBuf, depAmt);
+                        Marshaller.packLong(payloadBuf, CurrencyType.toMinorUnits(depCurr, depAmt));
                         break;
 
                     case 5: // Withdraw
@@ -150,14 +152,14 @@ public class ClientMain {
                         String wPwd = scanner.nextLine();
                         String wCurr = readCurrency(scanner);
                         System.out.print("Enter Amount: ");
-                        float wAmt = Float.parseFloat(scanner.nextLine());
+                        BigDecimal wAmt = new BigDecimal(scanner.nextLine().trim());
 
                         opCode = Constants.OP_WITHDRAW;
                         Marshaller.packInt(payloadBuf, wId);
                         Marshaller.packString(payloadBuf, wName);
                         Marshaller.packString(payloadBuf, wPwd);
                         Marshaller.packString(payloadBuf, wCurr);
-                        Marshaller.packFloat(payloadBuf, wAmt);
+                        Marshaller.packLong(payloadBuf, CurrencyType.toMinorUnits(wCurr, wAmt));
                         break;
 
                     case 6: // Transfer
@@ -169,7 +171,7 @@ public class ClientMain {
                         String senderPwd = scanner.nextLine();
                         String tCurr = readCurrency(scanner);
                         System.out.print("Enter Amount: ");
-                        float tAmt = Float.parseFloat(scanner.nextLine());
+                        BigDecimal tAmt = new BigDecimal(scanner.nextLine().trim());
                         System.out.print("Enter Receiver Account ID: ");
                         int receiverId = Integer.parseInt(scanner.nextLine());
 
@@ -178,7 +180,7 @@ public class ClientMain {
                         Marshaller.packString(payloadBuf, senderName);
                         Marshaller.packString(payloadBuf, senderPwd);
                         Marshaller.packString(payloadBuf, tCurr);
-                        Marshaller.packFloat(payloadBuf, tAmt);
+                        Marshaller.packLong(payloadBuf, CurrencyType.toMinorUnits(tCurr, tAmt));
                         Marshaller.packInt(payloadBuf, receiverId);
                         break;
 
@@ -194,7 +196,7 @@ public class ClientMain {
                         System.out.print("Enter To Currency: ");
                         String toCurr = scanner.nextLine().trim().toUpperCase();
                         System.out.print("Enter Amount (target currency): ");
-                        float exAmt = Float.parseFloat(scanner.nextLine());
+                        BigDecimal exAmt = new BigDecimal(scanner.nextLine().trim());
 
                         opCode = Constants.OP_EXCHANGE;
                         Marshaller.packInt(payloadBuf, exId);
@@ -202,7 +204,7 @@ public class ClientMain {
                         Marshaller.packString(payloadBuf, exPwd);
                         Marshaller.packString(payloadBuf, fromCurr);
                         Marshaller.packString(payloadBuf, toCurr);
-                        Marshaller.packFloat(payloadBuf, exAmt);
+                        Marshaller.packLong(payloadBuf, CurrencyType.toMinorUnits(toCurr, exAmt));
                         break;
 
                     case 8: // Monitor
@@ -5,6 +5,11 @@ public class Constants {
     public static final int BUFFER_SIZE = 1200; // 对应 protocol.h 中的 payload_size
     public static final int NETWORK_BUFFER_SIZE = BUFFER_SIZE + 200; // 对应 server in/out buffer长度
 
+    // === 对应 protocol.h 中的 wire_version ===
+    public static final int WIRE_V1 = 1; // 定长 1208 字节帧
+    public static final int WIRE_V2 = 2; // 版本字节 + id + code + u16 长度 + payload
+    public static final int WIRE_V3 = 3; // v2 的紧凑编码: varint, 单字节枚举
+
     // === 必须与 C++ op_code 枚举一致 ===
     public static final int OP_OPEN_ACCOUNT = 1;
     public static final int OP_CLOSE_ACCOUNT = 2;
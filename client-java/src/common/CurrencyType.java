@@ -1,5 +1,8 @@
 package common;
 
+import java.math.BigDecimal;
+import java.math.RoundingMode;
+
 public enum CurrencyType {
     USD,
     RMB,
@@ -13,4 +16,18 @@ public enum CurrencyType {
         }
         return CurrencyType.valueOf(value.trim().toUpperCase());
     }
+
+    /** Decimal digits of the minor unit, cents for most, none for yen. */
+    public int scale() {
+        return Messages.SCALES[ordinal()];
+    }
+
+    /** The amount in minor units as sent to the server, halves rounded away from zero. */
+    public long toMinorUnits(BigDecimal amount) {
+        return amount.setScale(scale(), RoundingMode.HALF_UP).unscaledValue().longValueExact();
+    }
+
+    public static long toMinorUnits(String currency, BigDecimal amount) {
+        return fromString(currency).toMinorUnits(amount);
+    }
 }
@@ -71,6 +71,88 @@ public class Marshaller {
     }
 
 
+    // === Compact encoding (wire v3) ===
+    // Integers are varints, 7 bits a byte with the low bits first, signed ones zigzag
+    // mapped; string lengths are unsigned varints; op codes, status codes and currencies
+    // take one byte; floats keep their 4 bytes. Matches Reader / Writer in serdes.h.
+
+    public static void packVarInt(ByteBuffer buf, long value) {
+        while ((value & ~0x7FL) != 0) {
+            buf.put((byte) ((value & 0x7F) | 0x80));
+            value >>>= 7;
+        }
+        buf.put((byte) value);
+    }
+
+    public static long unpackVarInt(ByteBuffer buf) {
+        long value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            byte b = buf.get();
+            value |= (long) (b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw new IllegalArgumentException("Varint too long");
+    }
+
+    public static long zigzag(long value) {
+        return (value << 1) ^ (value >> 63);
+    }
+
+    public static long unzigzag(long value) {
+        return (value >>> 1) ^ -(value & 1);
+    }
+
+    public static void packCompactInt(ByteBuffer buf, long value) {
+        packVarInt(buf, zigzag(value));
+    }
+
+    public static long unpackCompactInt(ByteBuffer buf) {
+        return unzigzag(unpackVarInt(buf));
+    }
+
+    public static void packCompactString(ByteBuffer buf, String text) {
+        if (text == null) text = "";
+        byte[] bytes = text.getBytes(StandardCharsets.UTF_8);
+        packVarInt(buf, bytes.length);
+        buf.put(bytes);
+    }
+
+    public static String unpackCompactString(ByteBuffer buf) {
+        long len = unpackVarInt(buf);
+        if (len > buf.remaining()) {
+            throw new IllegalArgumentException("String length too large: " + len);
+        }
+        byte[] bytes = new byte[(int) len];
+        buf.get(bytes);
+        return new String(bytes, StandardCharsets.UTF_8);
+    }
+
+    /** Op and status codes as one byte. */
+    public static void packCompactEnum(ByteBuffer buf, int value) {
+        buf.put((byte) value);
+    }
+
+    public static int unpackCompactEnum(ByteBuffer buf) {
+        return buf.get() & 0xFF;
+    }
+
+    /** A currency as its index in the server's enum, which CurrencyType mirrors. */
+    public static void packCompactCurrency(ByteBuffer buf, String currency) {
+        buf.put((byte) CurrencyType.fromString(currency).ordinal());
+    }
+
+    public static String unpackCompactCurrency(ByteBuffer buf) {
+        int index = buf.get() & 0xFF;
+        CurrencyType[] values = CurrencyType.values();
+        if (index >= values.length) {
+            throw new IllegalArgumentException("Invalid currency index: " + index);
+        }
+        return values[index].name();
+    }
+
+
     // === Legacy Support for string-only packing (for tests) ===
     // Keeps the old method to avoid breaking existing tests immediately, 
     // or we can update tests.
@@ -0,0 +1,157 @@
+// Generated by distbank-schemagen from server-c/src/rpc/messages.h, do not edit.
+package common;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+
+/** Payload layouts of the requests, fixed (wire v1 and v2) or compact (wire v3). */
+public final class Messages {
+
+    private Messages() {}
+
+    /** Decimal digits of the minor units of each currency, amounts are sent in minor units. */
+    public static final int[] SCALES = {2, 2, 2, 0, 2};
+
+    private static void checkLength(String text, int maxLength) {
+        if (text != null && text.getBytes(StandardCharsets.UTF_8).length > maxLength) {
+            throw new IllegalArgumentException("String exceeds " + maxLength + " bytes");
+        }
+    }
+
+    private static void packIntList(ByteBuffer buf, boolean compact, int[] list, int maxLength) {
+        if (list == null) list = new int[0];
+        if (list.length > maxLength) {
+            throw new IllegalArgumentException("List exceeds " + maxLength + " entries");
+        }
+        if (compact) Marshaller.packVarInt(buf, list.length); else Marshaller.packLong(buf, list.length);
+        for (int v : list) {
+            if (compact) Marshaller.packCompactInt(buf, v); else Marshaller.packInt(buf, v);
+        }
+    }
+
+    // === open ===
+
+    public static final int OPEN_MAX_SIZE = 113;
+    public static final int OPEN_MAX_SIZE_COMPACT = 91;
+
+    public static void packOpen(ByteBuffer buf, boolean compact, String userName, String password, long balance, String currency) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactInt(buf, balance); else Marshaller.packLong(buf, balance);
+        if (compact) Marshaller.packCompactCurrency(buf, currency); else Marshaller.packString(buf, currency);
+    }
+
+    // === close ===
+
+    public static final int CLOSE_MAX_SIZE = 98;
+    public static final int CLOSE_MAX_SIZE_COMPACT = 85;
+
+    public static void packClose(ByteBuffer buf, boolean compact, int id, String userName, String password) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, id); else Marshaller.packInt(buf, id);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+    }
+
+    // === check_balance ===
+
+    public static final int CHECK_BALANCE_MAX_SIZE = 109;
+    public static final int CHECK_BALANCE_MAX_SIZE_COMPACT = 86;
+
+    public static void packCheckBalance(ByteBuffer buf, boolean compact, int id, String userName, String password, String currency) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, id); else Marshaller.packInt(buf, id);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactCurrency(buf, currency); else Marshaller.packString(buf, currency);
+    }
+
+    // === deposit ===
+
+    public static final int DEPOSIT_MAX_SIZE = 117;
+    public static final int DEPOSIT_MAX_SIZE_COMPACT = 96;
+
+    public static void packDeposit(ByteBuffer buf, boolean compact, int id, String userName, String password, String currency, long amount) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, id); else Marshaller.packInt(buf, id);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactCurrency(buf, currency); else Marshaller.packString(buf, currency);
+        if (compact) Marshaller.packCompactInt(buf, amount); else Marshaller.packLong(buf, amount);
+    }
+
+    // === withdraw ===
+
+    public static final int WITHDRAW_MAX_SIZE = 117;
+    public static final int WITHDRAW_MAX_SIZE_COMPACT = 96;
+
+    public static void packWithdraw(ByteBuffer buf, boolean compact, int id, String userName, String password, String currency, long amount) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, id); else Marshaller.packInt(buf, id);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactCurrency(buf, currency); else Marshaller.packString(buf, currency);
+        if (compact) Marshaller.packCompactInt(buf, amount); else Marshaller.packLong(buf, amount);
+    }
+
+    // === transfer ===
+
+    public static final int TRANSFER_MAX_SIZE = 121;
+    public static final int TRANSFER_MAX_SIZE_COMPACT = 101;
+
+    public static void packTransfer(ByteBuffer buf, boolean compact, int senderId, String userName, String password, String currency, long amount, int receiverId) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, senderId); else Marshaller.packInt(buf, senderId);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactCurrency(buf, currency); else Marshaller.packString(buf, currency);
+        if (compact) Marshaller.packCompactInt(buf, amount); else Marshaller.packLong(buf, amount);
+        if (compact) Marshaller.packCompactInt(buf, receiverId); else Marshaller.packInt(buf, receiverId);
+    }
+
+    // === exchange ===
+
+    public static final int EXCHANGE_MAX_SIZE = 128;
+    public static final int EXCHANGE_MAX_SIZE_COMPACT = 97;
+
+    public static void packExchange(ByteBuffer buf, boolean compact, int id, String userName, String password, String fromCurrency, String toCurrency, long amount) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, id); else Marshaller.packInt(buf, id);
+        checkLength(userName, 39);
+        if (compact) Marshaller.packCompactString(buf, userName); else Marshaller.packString(buf, userName);
+        checkLength(password, 39);
+        if (compact) Marshaller.packCompactString(buf, password); else Marshaller.packString(buf, password);
+        if (compact) Marshaller.packCompactCurrency(buf, fromCurrency); else Marshaller.packString(buf, fromCurrency);
+        if (compact) Marshaller.packCompactCurrency(buf, toCurrency); else Marshaller.packString(buf, toCurrency);
+        if (compact) Marshaller.packCompactInt(buf, amount); else Marshaller.packLong(buf, amount);
+    }
+
+    // === monitor ===
+
+    public static final int MONITOR_MAX_SIZE = 824;
+    public static final int MONITOR_MAX_SIZE_COMPACT = 1021;
+
+    public static void packMonitor(ByteBuffer buf, boolean compact, long duration, int[] ranges, int ops, float minAmount, int interval, int multicast) {
+        buf.order(ByteOrder.LITTLE_ENDIAN);
+        if (compact) Marshaller.packCompactInt(buf, duration); else Marshaller.packLong(buf, duration);
+        packIntList(buf, compact, ranges, 198);
+        if (compact) Marshaller.packCompactInt(buf, ops); else Marshaller.packInt(buf, ops);
+        Marshaller.packFloat(buf, minAmount);
+        if (compact) Marshaller.packCompactInt(buf, interval); else Marshaller.packInt(buf, interval);
+        if (compact) Marshaller.packCompactInt(buf, multicast); else Marshaller.packInt(buf, multicast);
+    }
+}
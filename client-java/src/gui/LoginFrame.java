@@ -21,6 +21,7 @@ import javax.swing.ButtonGroup;
 import java.awt.GridBagConstraints;
 import java.awt.GridBagLayout;
 import java.awt.Insets;
+import java.math.BigDecimal;
 
 public class LoginFrame extends JFrame {
     private final JTextField serverIpField = new JTextField("127.0.0.1", 15);
@@ -147,11 +148,11 @@ public class LoginFrame extends JFrame {
             return;
         }
 
-        float balanceValue = 0f;
+        BigDecimal balanceValue = BigDecimal.ZERO;
         String currencyValue = (String) currencyBox.getSelectedItem();
         if (isOpen) {
             try {
-                balanceValue = Float.parseFloat(balanceField.getText().trim());
+                balanceValue = new BigDecimal(balanceField.getText().trim());
             } catch (NumberFormatException ex) {
                 GuiUtils.showError(this, "Invalid initial balance.");
                 return;
@@ -159,7 +160,7 @@ public class LoginFrame extends JFrame {
         }
 
         final int finalAccountId = accountId;
-        final float balance = balanceValue;
+        final BigDecimal balance = balanceValue;
         final String currency = currencyValue;
 
         connectButton.setEnabled(false);
@@ -19,6 +19,7 @@ import javax.swing.SwingConstants;
 import javax.swing.SwingUtilities;
 import javax.swing.SwingWorker;
 import java.awt.BorderLayout;
+import java.math.BigDecimal;
 import java.awt.GridBagConstraints;
 import java.awt.GridBagLayout;
 import java.awt.Insets;
@@ -233,9 +234,9 @@ public class MainFrame extends JFrame {
             showError("Please login again.");
             return;
         }
-        float amount;
+        BigDecimal amount;
         try {
-            amount = Float.parseFloat(depositAmountField.getText().trim());
+            amount = new BigDecimal(depositAmountField.getText().trim());
         } catch (NumberFormatException e) {
             showError("Invalid amount.");
             return;
@@ -258,9 +259,9 @@ public class MainFrame extends JFrame {
             showError("Please login again.");
             return;
         }
-        float amount;
+        BigDecimal amount;
         try {
-            amount = Float.parseFloat(withdrawAmountField.getText().trim());
+            amount = new BigDecimal(withdrawAmountField.getText().trim());
         } catch (NumberFormatException e) {
             showError("Invalid amount.");
             return;
@@ -286,9 +287,9 @@ public class MainFrame extends JFrame {
             return;
         }
 
-        float amount;
+        BigDecimal amount;
         try {
-            amount = Float.parseFloat(transferAmountField.getText().trim());
+            amount = new BigDecimal(transferAmountField.getText().trim());
         } catch (NumberFormatException e) {
             showError("Invalid amount.");
             return;
@@ -306,9 +307,9 @@ public class MainFrame extends JFrame {
     }
 
     private void submitExchange() {
-        float amount;
+        BigDecimal amount;
         try {
-            amount = Float.parseFloat(exchangeAmountField.getText().trim());
+            amount = new BigDecimal(exchangeAmountField.getText().trim());
         } catch (NumberFormatException e) {
             showError("Invalid amount.");
             return;
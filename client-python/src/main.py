@@ -10,12 +10,24 @@ import time
 from . import client as udp_client
 from . import protocol
 
+# Wire version of the requests sent, set from --wire
+WIRE = protocol.WIRE_V1
+
+
+def compact() -> bool:
+    """Whether payloads are packed in the compact encoding of wire v3."""
+    return WIRE == protocol.WIRE_V3
+
 
 def parse_args():
     p = argparse.ArgumentParser(description="Distributed Bank UDP client (matches server protocol)")
     p.add_argument("host", help="Server host (e.g. 127.0.0.1)")
     p.add_argument("port", type=int, help="Server port (e.g. 8080)")
     p.add_argument("--timeout", type=float, default=5.0, help="Request timeout in seconds")
+    p.add_argument(
+        "--wire", type=int, choices=(1, 2, 3), default=1,
+        help="Wire version: 1 fixed 1208 byte frames, 2 trimmed frames, 3 compact encoding",
+    )
     return p.parse_args()
 
 
@@ -31,7 +43,7 @@ def get_currency() -> str:
 def send_and_show(sock, server_addr: tuple, request_id: int, op_code: int, content: bytes) -> int:
     """Build request, send, receive, parse response and print message. Returns next request_id."""
     # 1. Only pack the request once
-    req = protocol.pack_request(request_id, op_code, content)
+    req = protocol.pack_frame(WIRE, request_id, op_code, content)
     # 2. Set up the retry configuration
     MAX_RETRIES = 5
     reply = None
@@ -49,7 +61,7 @@ def send_and_show(sock, server_addr: tuple, request_id: int, op_code: int, conte
         return request_id + 1
     # this time, reply is supposed to be not none
     try:
-        _resp_id, status, msg = protocol.unpack_response(reply)
+        _resp_id, status, msg = protocol.unpack_any(reply)
     except Exception as e:
         print(f"Error: Invalid response from server: {e}")
         return request_id + 1
@@ -71,11 +83,11 @@ def do_open_account(sock, server_addr: tuple, request_id: int) -> int:
     currency_str = get_currency()
     while True:
         try:
-            balance = float(input("Initial balance: ").strip())
+            balance = protocol.parse_amount(input("Initial balance: "))
             break
         except ValueError:
             print("Enter a valid number.")
-    content = protocol.pack_open_account(name, password, currency_str, balance)
+    content = protocol.pack_open_account(name, password, currency_str, balance, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_OPEN, content)
 
 
@@ -88,7 +100,7 @@ def do_close_account(sock, server_addr: tuple, request_id: int) -> int:
             print("Enter a valid integer.")
     name = input("Account holder name: ").strip()
     password = input("Password: ").strip()
-    content = protocol.pack_close_account(acc_id, name, password)
+    content = protocol.pack_close_account(acc_id, name, password, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_CLOSE, content)
 
 
@@ -102,7 +114,7 @@ def do_check_balance(sock, server_addr: tuple, request_id: int) -> int:
     name = input("Account holder name: ").strip()
     password = input("Password: ").strip()
     currency_str = get_currency()
-    content = protocol.pack_check_balance(acc_id, name, password, currency_str)
+    content = protocol.pack_check_balance(acc_id, name, password, currency_str, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_CHECK_BALANCE, content)
 
 
@@ -118,11 +130,11 @@ def do_deposit(sock, server_addr: tuple, request_id: int) -> int:
     currency_str = get_currency()
     while True:
         try:
-            amount = float(input("Amount to deposit: ").strip())
+            amount = protocol.parse_amount(input("Amount to deposit: "))
             break
         except ValueError:
             print("Enter a valid number.")
-    content = protocol.pack_deposit_or_withdraw(acc_id, name, password, currency_str, amount)
+    content = protocol.pack_deposit_or_withdraw(acc_id, name, password, currency_str, amount, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_DEPOSIT, content)
 
 
@@ -138,11 +150,11 @@ def do_withdraw(sock, server_addr: tuple, request_id: int) -> int:
     currency_str = get_currency()
     while True:
         try:
-            amount = float(input("Amount to withdraw: ").strip())
+            amount = protocol.parse_amount(input("Amount to withdraw: "))
             break
         except ValueError:
             print("Enter a valid number.")
-    content = protocol.pack_deposit_or_withdraw(acc_id, name, password, currency_str, amount)
+    content = protocol.pack_deposit_or_withdraw(acc_id, name, password, currency_str, amount, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_WITHDRAW, content)
 
 
@@ -158,7 +170,7 @@ def do_transfer(sock, server_addr: tuple, request_id: int) -> int:
     currency_str = get_currency()
     while True:
         try:
-            amount = float(input("Amount to transfer: ").strip())
+            amount = protocol.parse_amount(input("Amount to transfer: "))
             break
         except ValueError:
             print("Enter a valid number.")
@@ -168,7 +180,7 @@ def do_transfer(sock, server_addr: tuple, request_id: int) -> int:
             break
         except ValueError:
             print("Enter a valid integer.")
-    content = protocol.pack_transfer(sender_id, name, password, currency_str, amount, receiver_id)
+    content = protocol.pack_transfer(sender_id, name, password, currency_str, amount, receiver_id, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_TRANSFER, content)
 
 
@@ -187,14 +199,58 @@ def do_exchange(sock, server_addr: tuple, request_id: int) -> int:
     to_cur = get_currency()
     while True:
         try:
-            amount = float(input("Amount (in target currency) to receive: ").strip())
+            amount = protocol.parse_amount(input("Amount (in target currency) to receive: "))
             break
         except ValueError:
             print("Enter a valid number.")
-    content = protocol.pack_exchange(acc_id, name, password, from_cur, to_cur, amount)
+    content = protocol.pack_exchange(acc_id, name, password, from_cur, to_cur, amount, compact=compact())
     return send_and_show(sock, server_addr, request_id, protocol.OP_EXCHANGE, content)
 
 
+def do_multicast(sock, server_addr: tuple, request_id: int, duration_ms: int, timeout_sec: float) -> int:
+    """Ask for the multicast group, then receive every callback from it."""
+    content = protocol.pack_monitor(duration_ms, multicast=True, compact=compact())
+    reply = udp_client.request_reply(sock, server_addr, protocol.pack_frame(WIRE, request_id, protocol.OP_MONITOR, content))
+    if reply is None:
+        print("Error: No reply from server (timeout).")
+        return request_id + 1
+    _rid, status, msg = protocol.unpack_any(reply)
+    if status != protocol.STATUS_SUCCESS:
+        print("Response:", msg)
+        return request_id + 1
+    group, port = protocol.parse_multicast_group(msg)
+    # join on the interface that reaches the server, loopback when it runs locally
+    local_ip = sock.getsockname()[0]
+    if local_ip == "0.0.0.0":
+        local_ip = server_addr[0] if server_addr[0].startswith("127.") else "0.0.0.0"
+    msock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    msock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    msock.bind(("", port))
+    msock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, socket.inet_aton(group) + socket.inet_aton(local_ip))
+    msock.settimeout(1.0)
+    print(f"Joined {group}:{port}")
+    deadline = time.time() + duration_ms / 1000.0
+    expected = None
+    try:
+        while time.time() < deadline:
+            try:
+                data, _ = msock.recvfrom(65535)
+            except socket.timeout:
+                continue
+            if not protocol.is_multicast_datagram(data):
+                continue
+            seq, text = protocol.unpack_multicast(data)
+            if expected is not None and seq > expected:
+                print(f"Lost {seq - expected} update(s)")
+            expected = seq + 1
+            print("Update:", text)
+    finally:
+        msock.close()
+    sock.settimeout(timeout_sec)
+    print("Monitor window ended.")
+    return request_id + 1
+
+
 def do_monitor(sock, server_addr: tuple, request_id: int, timeout_sec: float = 5.0) -> int:
     while True:
         try:
@@ -204,9 +260,48 @@ def do_monitor(sock, server_addr: tuple, request_id: int, timeout_sec: float = 5
             print("Enter a positive number.")
         except ValueError:
             print("Enter a valid integer.")
+    if input("Join the server's multicast group instead of a window? (y/N): ").strip().lower() == "y":
+        return do_multicast(sock, server_addr, request_id, duration_ms, timeout_sec)
+    # Optional filters, blank for every account / op / amount
+    while True:
+        try:
+            raw = input("Account ids or first-last ranges to monitor, comma separated (blank for all): ").strip()
+            accounts = []
+            for x in raw.split(","):
+                first, dash, last = x.strip().partition("-")
+                if dash:
+                    accounts += range(int(first), int(last) + 1)
+                elif first:
+                    accounts.append(int(first))
+            break
+        except ValueError:
+            print("Enter integers or ranges separated by commas.")
+    while True:
+        raw = input(f"Ops to monitor among {', '.join(protocol.MONITOR_OPS)} (blank for all): ").strip().lower()
+        names = [x.strip() for x in raw.split(",") if x.strip()]
+        if all(n in protocol.MONITOR_OPS for n in names):
+            ops = [protocol.MONITOR_OPS[n] for n in names]
+            break
+        print("Unknown op.")
+    while True:
+        try:
+            raw = input("Minimum amount (blank for any): ").strip()
+            min_amount = float(raw) if raw else 0.0
+            break
+        except ValueError:
+            print("Enter a valid number.")
+    while True:
+        try:
+            raw = input("Update interval in milliseconds, balances coalesced (blank for every change): ").strip()
+            interval_ms = int(raw) if raw else 0
+            if interval_ms >= 0:
+                break
+            print("Enter a non-negative number.")
+        except ValueError:
+            print("Enter a valid integer.")
     # Send monitor request
-    content = protocol.pack_monitor(duration_ms)
-    req = protocol.pack_request(request_id, protocol.OP_MONITOR, content)
+    content = protocol.pack_monitor(duration_ms, accounts, ops, min_amount, interval_ms, compact=compact())
+    req = protocol.pack_frame(WIRE, request_id, protocol.OP_MONITOR, content)
     MAX_RETRIES = 5
     reply = None
 
@@ -242,6 +337,11 @@ def do_monitor(sock, server_addr: tuple, request_id: int, timeout_sec: float = 5
         while time.time() < deadline:
             try:
                 data, _ = udp_client.receive_response(sock)
+                if protocol.is_delta_datagram(data):
+                    for account_id, balances in protocol.unpack_deltas(data):
+                        text = ", ".join(f"{cur} {bal}" for cur, bal in balances.items())
+                        print(f"Update: account {account_id}", text if balances else "closed")
+                    continue
                 msg = protocol.unpack_callback(data)
                 print("Update:", msg)
             except socket.timeout:
@@ -254,7 +354,9 @@ def do_monitor(sock, server_addr: tuple, request_id: int, timeout_sec: float = 5
 
 
 def main() -> int:
+    global WIRE
     args = parse_args()
+    WIRE = args.wire
     server_addr = (args.host, args.port)
     sock = udp_client.create_socket(server_addr, args.timeout)
     request_id = 1
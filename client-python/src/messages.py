@@ -0,0 +1,311 @@
+# Generated by distbank-schemagen from server-c/src/rpc/messages.h, do not edit.
+# Payload codecs of the requests, in the fixed encoding (wire v1 and v2) or the
+# compact one (wire v3): varint integers, zigzag when signed, varint prefixed
+# strings, one byte currencies, floats always 4 bytes little-endian. amounts
+# are integers of minor units, SCALES[c] decimal digits of currency c.
+
+import struct
+from typing import List, Tuple
+
+CURRENCIES = ["USD", "RMB", "SGD", "JPY", "BPD"]
+SCALES = [2, 2, 2, 0, 2]
+
+
+def _varint(v: int) -> bytes:
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _get_varint(data: bytes, i: int) -> Tuple[int, int]:
+    v = 0
+    for shift in range(0, 64, 7):
+        if i >= len(data):
+            raise ValueError("Varint truncated")
+        b = data[i]
+        i += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, i
+    raise ValueError("Varint too long")
+
+
+def _int(v: int, fmt: str, compact: bool) -> bytes:
+    return _varint((v << 1) ^ (v >> 63)) if compact else struct.pack(fmt, v)
+
+
+def _get_int(data: bytes, i: int, fmt: str, compact: bool) -> Tuple[int, int]:
+    if compact:
+        v, i = _get_varint(data, i)
+        return (v >> 1) ^ -(v & 1), i
+    return struct.unpack_from(fmt, data, i)[0], i + struct.calcsize(fmt)
+
+
+def _float(v: float, compact: bool) -> bytes:
+    return struct.pack("<f", v)
+
+
+def _get_float(data: bytes, i: int, compact: bool) -> Tuple[float, int]:
+    return struct.unpack_from("<f", data, i)[0], i + 4
+
+
+def _text(s: str, max_len: int, compact: bool) -> bytes:
+    raw = s.encode("utf-8")
+    if len(raw) > max_len:
+        raise ValueError(f"String of {len(raw)} bytes exceeds {max_len}")
+    return (_varint(len(raw)) if compact else struct.pack("<Q", len(raw))) + raw
+
+
+def _get_text(data: bytes, i: int, max_len: int, compact: bool) -> Tuple[str, int]:
+    if compact:
+        n, i = _get_varint(data, i)
+    else:
+        n, i = struct.unpack_from("<Q", data, i)[0], i + 8
+    if n > max_len or i + n > len(data):
+        raise ValueError("String too long")
+    return data[i : i + n].decode("utf-8", errors="replace"), i + n
+
+
+def _int_list(v: List[int], max_len: int, compact: bool) -> bytes:
+    if len(v) > max_len:
+        raise ValueError(f"List of {len(v)} exceeds {max_len}")
+    count = _varint(len(v)) if compact else struct.pack("<Q", len(v))
+    return count + b"".join(_int(x, "<i", compact) for x in v)
+
+
+def _get_int_list(data: bytes, i: int, max_len: int, compact: bool) -> Tuple[List[int], int]:
+    if compact:
+        n, i = _get_varint(data, i)
+    else:
+        n, i = struct.unpack_from("<Q", data, i)[0], i + 8
+    if n > max_len:
+        raise ValueError("List too long")
+    out = []
+    for _ in range(n):
+        x, i = _get_int(data, i, "<i", compact)
+        out.append(x)
+    return out, i
+
+
+def _unit(s: str, compact: bool) -> bytes:
+    return struct.pack("<B", CURRENCIES.index(s)) if compact else _text(s, 8, False)
+
+
+def _get_unit(data: bytes, i: int, compact: bool) -> Tuple[str, int]:
+    if compact:
+        if i >= len(data) or data[i] >= len(CURRENCIES):
+            raise ValueError("Invalid currency")
+        return CURRENCIES[data[i]], i + 1
+    s, i = _get_text(data, i, 8, False)
+    if s not in CURRENCIES:
+        raise ValueError("Invalid currency")
+    return s, i
+
+
+# --- open ---
+OP_OPEN = 1
+OPEN_MAX_SIZE = 113
+OPEN_MAX_SIZE_COMPACT = 91
+
+
+def pack_open(user_name: str, password: str, balance: int, currency: str, compact: bool = False) -> bytes:
+    return b"".join((
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _int(balance, "<q", compact),
+        _unit(currency, compact),
+    ))
+
+
+def unpack_open(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    balance, i = _get_int(data, i, "<q", compact)
+    currency, i = _get_unit(data, i, compact)
+    return {"user_name": user_name, "password": password, "balance": balance, "currency": currency}
+
+
+# --- close ---
+OP_CLOSE = 2
+CLOSE_MAX_SIZE = 98
+CLOSE_MAX_SIZE_COMPACT = 85
+
+
+def pack_close(id: int, user_name: str, password: str, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+    ))
+
+
+def unpack_close(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    return {"id": id, "user_name": user_name, "password": password}
+
+
+# --- check_balance ---
+OP_CHECK_BALANCE = 3
+CHECK_BALANCE_MAX_SIZE = 109
+CHECK_BALANCE_MAX_SIZE_COMPACT = 86
+
+
+def pack_check_balance(id: int, user_name: str, password: str, currency: str, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _unit(currency, compact),
+    ))
+
+
+def unpack_check_balance(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    currency, i = _get_unit(data, i, compact)
+    return {"id": id, "user_name": user_name, "password": password, "currency": currency}
+
+
+# --- deposit ---
+OP_DEPOSIT = 4
+DEPOSIT_MAX_SIZE = 117
+DEPOSIT_MAX_SIZE_COMPACT = 96
+
+
+def pack_deposit(id: int, user_name: str, password: str, currency: str, amount: int, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _unit(currency, compact),
+        _int(amount, "<q", compact),
+    ))
+
+
+def unpack_deposit(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    currency, i = _get_unit(data, i, compact)
+    amount, i = _get_int(data, i, "<q", compact)
+    return {"id": id, "user_name": user_name, "password": password, "currency": currency, "amount": amount}
+
+
+# --- withdraw ---
+OP_WITHDRAW = 5
+WITHDRAW_MAX_SIZE = 117
+WITHDRAW_MAX_SIZE_COMPACT = 96
+
+
+def pack_withdraw(id: int, user_name: str, password: str, currency: str, amount: int, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _unit(currency, compact),
+        _int(amount, "<q", compact),
+    ))
+
+
+def unpack_withdraw(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    currency, i = _get_unit(data, i, compact)
+    amount, i = _get_int(data, i, "<q", compact)
+    return {"id": id, "user_name": user_name, "password": password, "currency": currency, "amount": amount}
+
+
+# --- transfer ---
+OP_TRANSFER = 6
+TRANSFER_MAX_SIZE = 121
+TRANSFER_MAX_SIZE_COMPACT = 101
+
+
+def pack_transfer(sender_id: int, user_name: str, password: str, currency: str, amount: int, receiver_id: int, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(sender_id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _unit(currency, compact),
+        _int(amount, "<q", compact),
+        _int(receiver_id, "<i", compact),
+    ))
+
+
+def unpack_transfer(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    sender_id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    currency, i = _get_unit(data, i, compact)
+    amount, i = _get_int(data, i, "<q", compact)
+    receiver_id, i = _get_int(data, i, "<i", compact)
+    return {"sender_id": sender_id, "user_name": user_name, "password": password, "currency": currency, "amount": amount, "receiver_id": receiver_id}
+
+
+# --- exchange ---
+OP_EXCHANGE = 7
+EXCHANGE_MAX_SIZE = 128
+EXCHANGE_MAX_SIZE_COMPACT = 97
+
+
+def pack_exchange(id: int, user_name: str, password: str, from_currency: str, to_currency: str, amount: int, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(id, "<i", compact),
+        _text(user_name, 39, compact),
+        _text(password, 39, compact),
+        _unit(from_currency, compact),
+        _unit(to_currency, compact),
+        _int(amount, "<q", compact),
+    ))
+
+
+def unpack_exchange(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    id, i = _get_int(data, i, "<i", compact)
+    user_name, i = _get_text(data, i, 39, compact)
+    password, i = _get_text(data, i, 39, compact)
+    from_currency, i = _get_unit(data, i, compact)
+    to_currency, i = _get_unit(data, i, compact)
+    amount, i = _get_int(data, i, "<q", compact)
+    return {"id": id, "user_name": user_name, "password": password, "from_currency": from_currency, "to_currency": to_currency, "amount": amount}
+
+
+# --- monitor ---
+OP_MONITOR = 8
+MONITOR_MAX_SIZE = 824
+MONITOR_MAX_SIZE_COMPACT = 1021
+
+
+def pack_monitor(duration: int, ranges: List[int], ops: int, min_amount: float, interval: int, multicast: int, compact: bool = False) -> bytes:
+    return b"".join((
+        _int(duration, "<q", compact),
+        _int_list(ranges, 198, compact),
+        _int(ops, "<i", compact),
+        _float(min_amount, compact),
+        _int(interval, "<i", compact),
+        _int(multicast, "<i", compact),
+    ))
+
+
+def unpack_monitor(data: bytes, compact: bool = False) -> dict:
+    i = 0
+    duration, i = _get_int(data, i, "<q", compact)
+    ranges, i = _get_int_list(data, i, 198, compact)
+    ops, i = _get_int(data, i, "<i", compact)
+    min_amount, i = _get_float(data, i, compact)
+    interval, i = _get_int(data, i, "<i", compact)
+    multicast, i = _get_int(data, i, "<i", compact)
+    return {"duration": duration, "ranges": ranges, "ops": ops, "min_amount": min_amount, "interval": interval, "multicast": multicast}
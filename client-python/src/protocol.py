@@ -1,22 +1,37 @@
 # Copyright (c) 2026. Distributed Bank client.
 # Wire format matches server: Request (id, op_code, payload[1200]), Response (id, status_code, payload[1200]).
 # Server serdes uses host byte order (no htonl); we use little-endian '<' to match typical server (x86/ARM).
-# String format: 8-byte length (size_t) + raw bytes (server serdes.h).
+# String format: 8-byte length (size_t) + raw bytes (server serdes.h), a varint length in wire v3.
+# Payload layouts live in messages.py, generated from the server schemas by distbank-schemagen.
 
 import struct
-from typing import Tuple
+from decimal import Decimal, InvalidOperation, ROUND_HALF_UP
+from typing import Dict, List, Sequence, Tuple, Union
+
+from . import messages
 
 PAYLOAD_SIZE = 1200  # rpc/protocol.h payload_size
 
-# --- Op codes (match server rpc/protocol.h) ---
-OP_OPEN = 1
-OP_CLOSE = 2
-OP_CHECK_BALANCE = 3
-OP_DEPOSIT = 4
-OP_WITHDRAW = 5
-OP_TRANSFER = 6
-OP_EXCHANGE = 7
-OP_MONITOR = 8
+# --- Wire version 2 (rpc/protocol.h wire_version): version byte, id, code, u16 payload length, payload ---
+WIRE_V2 = 2
+V2_HEADER = struct.Struct("<BiiH")
+V2_MAX_PAYLOAD = 8 + PAYLOAD_SIZE - V2_HEADER.size - 1
+
+# --- Wire version 3: v2 in the compact encoding of serdes.h ---
+# Header: version byte, zigzag varint id, one byte code, varint payload length.
+# Payload: varint integers (zigzag when signed), varint prefixed strings, one byte currency index, 4 byte floats.
+WIRE_V1 = 1
+WIRE_V3 = 3
+
+# --- Op codes (generated from server rpc/messages.h) ---
+OP_OPEN = messages.OP_OPEN
+OP_CLOSE = messages.OP_CLOSE
+OP_CHECK_BALANCE = messages.OP_CHECK_BALANCE
+OP_DEPOSIT = messages.OP_DEPOSIT
+OP_WITHDRAW = messages.OP_WITHDRAW
+OP_TRANSFER = messages.OP_TRANSFER
+OP_EXCHANGE = messages.OP_EXCHANGE
+OP_MONITOR = messages.OP_MONITOR
 
 # --- Status codes (match server rpc/protocol.h) ---
 STATUS_SUCCESS = 1
@@ -24,15 +39,43 @@ STATUS_FAIL = 2
 STATUS_ERROR = 3
 STATUS_CALLBACK = 4
 
-# --- Currency: server serializes as string (currency_to_str) ---
-CURRENCY_STRINGS = ["USD", "RMB", "SGD", "JPY", "BPD"]
+# --- Currency: a string in the fixed encoding, its index in CURRENCY_STRINGS when compact ---
+CURRENCY_STRINGS = messages.CURRENCIES
 CURRENCY_NAMES = {"usd": "USD", "rmb": "RMB", "sgd": "SGD", "jpy": "JPY", "bpd": "BPD"}
 
 
-def _pack_string(s: str) -> bytes:
-    """Length-prefixed string: 8-byte size_t (little-endian) + UTF-8 bytes. Matches server serdes.h."""
-    raw = s.encode("utf-8")
-    return struct.pack("<Q", len(raw)) + raw
+def _pack_varint(v: int) -> bytes:
+    """Unsigned varint: 7 bits a byte, low bits first."""
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _unpack_varint(data: bytes, offset: int) -> Tuple[int, int]:
+    """Decode a varint at offset, returns (value, next offset)."""
+    v = 0
+    shift = 0
+    while shift < 64:
+        if offset >= len(data):
+            raise ValueError("Varint truncated")
+        b = data[offset]
+        offset += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, offset
+        shift += 7
+    raise ValueError("Varint too long")
+
+
+def _zigzag(v: int) -> int:
+    return (v << 1) ^ (v >> 63)
+
+
+def _unzigzag(v: int) -> int:
+    return (v >> 1) ^ -(v & 1)
 
 
 def _pack_payload(content: bytes) -> bytes:
@@ -48,63 +91,201 @@ def pack_request(request_id: int, op_code: int, content: bytes) -> bytes:
     return struct.pack("<ii", request_id, op_code) + payload
 
 
-# --- Open: user_name, password, balance, currency (string) ---
-def pack_open_account(name: str, password: str, currency_str: str, initial_balance: float) -> bytes:
-    return _pack_string(name) + _pack_string(password) + struct.pack("<f", initial_balance) + _pack_string(currency_str)
+def pack_request_v2(request_id: int, op_code: int, content: bytes) -> bytes:
+    """Compact request: only the serialized payload is sent, the server answers in v2."""
+    if len(content) > V2_MAX_PAYLOAD:
+        raise ValueError(f"Payload content {len(content)} exceeds {V2_MAX_PAYLOAD}")
+    return V2_HEADER.pack(WIRE_V2, request_id, op_code, len(content)) + content
+
+
+def pack_request_v3(request_id: int, op_code: int, content: bytes) -> bytes:
+    """Compact request, content packed with compact=True; the server answers in v3."""
+    if len(content) > V2_MAX_PAYLOAD:
+        raise ValueError(f"Payload content {len(content)} exceeds {V2_MAX_PAYLOAD}")
+    return bytes([WIRE_V3]) + _pack_varint(_zigzag(request_id)) + bytes([op_code]) + _pack_varint(len(content)) + content
+
+
+def pack_frame(wire: int, request_id: int, op_code: int, content: bytes) -> bytes:
+    """Request in the given wire version (1, 2 or 3)."""
+    if wire == WIRE_V3:
+        return pack_request_v3(request_id, op_code, content)
+    if wire == WIRE_V2:
+        return pack_request_v2(request_id, op_code, content)
+    return pack_request(request_id, op_code, content)
+
+
+# --- Amounts: integers of minor units on the wire (cents, yen), SCALES digits per currency ---
+Amount = Union[Decimal, str, int, float]
+
+
+def parse_amount(text: str) -> Decimal:
+    """Decimal amount typed by the user, ValueError if it is not a number."""
+    try:
+        amount = Decimal(text.strip())
+    except InvalidOperation:
+        raise ValueError(f"Not an amount: {text!r}") from None
+    if not amount.is_finite():
+        raise ValueError(f"Not an amount: {text!r}")
+    return amount
+
+
+def to_minor_units(amount: Amount, currency_str: str) -> int:
+    """Minor units of an amount of a currency, halves rounded away from zero. floats
+    go through their shortest text so that 0.1 is 10 cents."""
+    scale = messages.SCALES[messages.CURRENCIES.index(currency_str)]
+    value = Decimal(str(amount)) if isinstance(amount, float) else Decimal(amount)
+    return int(value.scaleb(scale).quantize(Decimal(1), rounding=ROUND_HALF_UP))
+
+
+def from_minor_units(units: int, currency_str: str) -> Decimal:
+    scale = messages.SCALES[messages.CURRENCIES.index(currency_str)]
+    return Decimal(units).scaleb(-scale)
+
+
+# --- Payloads: layouts generated from the server's schemas (server-c/src/rpc/messages.h) ---
+def pack_open_account(name: str, password: str, currency_str: str, initial_balance: Amount, compact: bool = False) -> bytes:
+    return messages.pack_open(name, password, to_minor_units(initial_balance, currency_str), currency_str, compact)
 
 
-# --- Close: id, user_name, password ---
-def pack_close_account(account_id: int, name: str, password: str) -> bytes:
-    return struct.pack("<i", account_id) + _pack_string(name) + _pack_string(password)
+def pack_close_account(account_id: int, name: str, password: str, compact: bool = False) -> bytes:
+    return messages.pack_close(account_id, name, password, compact)
 
 
-# --- Check balance: id, user_name, password, cur_unit (string) ---
-def pack_check_balance(account_id: int, name: str, password: str, currency_str: str) -> bytes:
-    return struct.pack("<i", account_id) + _pack_string(name) + _pack_string(password) + _pack_string(currency_str)
+def pack_check_balance(account_id: int, name: str, password: str, currency_str: str, compact: bool = False) -> bytes:
+    return messages.pack_check_balance(account_id, name, password, currency_str, compact)
 
 
-# --- Deposit / Withdraw: id, user_name, password, cur_unit (string), amount ---
-def pack_deposit_or_withdraw(account_id: int, name: str, password: str, currency_str: str, amount: float) -> bytes:
-    return (
-        struct.pack("<i", account_id)
-        + _pack_string(name)
-        + _pack_string(password)
-        + _pack_string(currency_str)
-        + struct.pack("<f", amount)
+def pack_deposit_or_withdraw(
+    account_id: int, name: str, password: str, currency_str: str, amount: Amount, compact: bool = False
+) -> bytes:
+    # deposit and withdraw share a layout
+    return messages.pack_deposit(
+        account_id, name, password, currency_str, to_minor_units(amount, currency_str), compact
     )
 
 
-# --- Transfer: sender_id, user_name, password, cur_unit, amount, receiver_id ---
 def pack_transfer(
-    sender_id: int, name: str, password: str, currency_str: str, amount: float, receiver_id: int
+    sender_id: int,
+    name: str,
+    password: str,
+    currency_str: str,
+    amount: Amount,
+    receiver_id: int,
+    compact: bool = False,
 ) -> bytes:
-    return (
-        struct.pack("<i", sender_id)
-        + _pack_string(name)
-        + _pack_string(password)
-        + _pack_string(currency_str)
-        + struct.pack("<f", amount)
-        + struct.pack("<i", receiver_id)
+    return messages.pack_transfer(
+        sender_id, name, password, currency_str, to_minor_units(amount, currency_str), receiver_id, compact
     )
 
 
-# --- Exchange: id, user_name, password, from_cur (string), to_cur (string), amount_to_exchange ---
 def pack_exchange(
-    account_id: int, name: str, password: str, from_currency: str, to_currency: str, amount: float
+    account_id: int,
+    name: str,
+    password: str,
+    from_currency: str,
+    to_currency: str,
+    amount: Amount,
+    compact: bool = False,
+) -> bytes:
+    """Exchange into amount of to_currency, paid in from_currency."""
+    return messages.pack_exchange(
+        account_id, name, password, from_currency, to_currency, to_minor_units(amount, to_currency), compact
+    )
+
+
+# Ops a monitor window can filter on, by name.
+MONITOR_OPS = {
+    "open": OP_OPEN,
+    "close": OP_CLOSE,
+    "deposit": OP_DEPOSIT,
+    "withdraw": OP_WITHDRAW,
+    "transfer": OP_TRANSFER,
+    "exchange": OP_EXCHANGE,
+}
+
+
+def pack_monitor(
+    duration_ms: int,
+    accounts: Sequence[int] = (),
+    ops: Sequence[int] = (),
+    min_amount: float = 0.0,
+    interval_ms: int = 0,
+    multicast: bool = False,
+    compact: bool = False,
 ) -> bytes:
-    return (
-        struct.pack("<i", account_id)
-        + _pack_string(name)
-        + _pack_string(password)
-        + _pack_string(from_currency)
-        + _pack_string(to_currency)
-        + struct.pack("<f", amount)
+    """Monitor window receiving the callbacks of the given accounts and ops (all if
+    empty) that move at least min_amount. The accounts are sent as ranges (see
+    account_ranges), which may cover up to 4096 accounts. With an interval the
+    window receives balance deltas (see unpack_deltas) at most once per interval
+    instead. With multicast the server only answers with its multicast group (see
+    unpack_multicast)."""
+    mask = 0
+    for op in ops:
+        mask |= 1 << op
+    return messages.pack_monitor(
+        duration_ms, account_ranges(accounts), mask, min_amount, interval_ms, int(multicast), compact
     )
 
 
-# --- Monitor: int64_t duration (e.g. milliseconds) ---
-def pack_monitor(duration_ms: int) -> bytes:
-    return struct.pack("<q", duration_ms)
+def account_ranges(accounts: Sequence[int]) -> List[int]:
+    """First id, last id and step of each run of evenly spaced ids in accounts,
+    flattened as a monitor request carries them. The accounts a client opened on
+    one shard are spaced by the number of shards and make a single range."""
+    ids = sorted(set(accounts))
+    ranges: List[int] = []
+    i = 0
+    while i < len(ids):
+        j = i
+        step = ids[i + 1] - ids[i] if i + 1 < len(ids) else 1
+        while j + 1 < len(ids) and ids[j + 1] - ids[j] == step:
+            j += 1
+        ranges += [ids[i], ids[j], step]
+        i = j + 1
+    return ranges
+
+
+MULTICAST_TAG = 1
+
+
+def parse_multicast_group(msg: str) -> Tuple[str, int]:
+    """Group and port of a "multicast group: <addr>:<port>" monitor reply."""
+    group, port = msg.split("multicast group:", 1)[1].strip().rsplit(":", 1)
+    return group, int(port)
+
+
+def is_multicast_datagram(data: bytes) -> bool:
+    return len(data) > 9 and data[0] == MULTICAST_TAG
+
+
+def unpack_multicast(data: bytes) -> Tuple[int, str]:
+    """Sequence number and text of a multicast callback, a receiver that sees a
+    number skipped lost a datagram."""
+    seq = struct.unpack_from("<Q", data, 1)[0]
+    return seq, unpack_callback(data[9:])
+
+
+def is_delta_datagram(data: bytes) -> bool:
+    """Delta datagrams start with a zero byte, text callbacks never do."""
+    return len(data) > 0 and data[0] == 0
+
+
+def unpack_deltas(data: bytes) -> List[Tuple[int, Dict[str, Decimal]]]:
+    """Decode a delta datagram into (account id, {currency: balance}) pairs, an empty
+    dict meaning the account was closed."""
+    out = []
+    i = 1
+    while i < len(data):
+        raw, i = messages._get_varint(data, i)
+        account_id = (raw >> 1) ^ -(raw & 1)
+        held = data[i]
+        i += 1
+        balances = {}
+        for c, name in enumerate(messages.CURRENCIES):
+            if held & (1 << c):
+                raw, i = messages._get_varint(data, i)
+                balances[name] = from_minor_units((raw >> 1) ^ -(raw & 1), name)
+        out.append((account_id, balances))
+    return out
 
 
 # --- Response: id (4), status_code (4), payload (1200). Server may send larger buffer (1400). ---
@@ -118,6 +299,37 @@ def unpack_response(data: bytes) -> Tuple[int, int, bytes]:
     msg = payload_raw.split(b"\x00")[0].decode("utf-8", errors="replace")
     return resp_id, status, msg
 
+def unpack_response_v2(data: bytes) -> Tuple[int, int, bytes]:
+    """Unpack a v2 response: (response_id, status_code, payload_message)."""
+    if len(data) < V2_HEADER.size or data[0] != WIRE_V2:
+        raise ValueError("Not a v2 response")
+    _version, resp_id, status, n = V2_HEADER.unpack_from(data, 0)
+    payload_raw = data[V2_HEADER.size : V2_HEADER.size + n]
+    if len(payload_raw) < n:
+        raise ValueError("Response payload truncated")
+    return resp_id, status, payload_raw.decode("utf-8", errors="replace")
+
+def unpack_response_v3(data: bytes) -> Tuple[int, int, bytes]:
+    """Unpack a v3 response: (response_id, status_code, payload_message)."""
+    if len(data) < 4 or data[0] != WIRE_V3:
+        raise ValueError("Not a v3 response")
+    resp_id, i = _unpack_varint(data, 1)
+    status = data[i]
+    n, i = _unpack_varint(data, i + 1)
+    payload_raw = data[i : i + n]
+    if len(payload_raw) < n:
+        raise ValueError("Response payload truncated")
+    return _unzigzag(resp_id), status, payload_raw.decode("utf-8", errors="replace")
+
+
+def unpack_any(data: bytes) -> Tuple[int, int, bytes]:
+    """Unpack a response in whichever wire version it came, as the server answers in kind."""
+    if len(data) < 8 + PAYLOAD_SIZE and data and data[0] == WIRE_V3:
+        return unpack_response_v3(data)
+    if len(data) < 8 + PAYLOAD_SIZE and data and data[0] == WIRE_V2:
+        return unpack_response_v2(data)
+    return unpack_response(data)
+
 # --- Callback: no id, no status_code, payload (1400). ---
 def unpack_callback(data: bytes) -> str:
     """Unpack callback message from server."""
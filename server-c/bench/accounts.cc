@@ -0,0 +1,147 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <accounts.cc> file benchmarks the packed account record against the former
+ * layout keeping the balance in an unordered_map and the credentials in std::string.
+ *
+ * Both layouts hold the same accounts behind an id indexed array of pointers and run
+ * the same random mix of authenticated check balance and deposit operations, the heap
+ * footprint is measured by counting the bytes passed to operator new.
+ *
+ *   usage: bench_accounts [--accounts 100000] [--ops 10000000] */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/accounts.h"
+
+static size_t heap_bytes = 0;
+
+void* operator new(size_t n) {
+  heap_bytes += n;
+  if (void* p = std::malloc(n)) { return p; }
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t n, std::align_val_t al) {
+  heap_bytes += n;
+  size_t a = static_cast<size_t>(al);
+  if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) { return p; }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+/* The account record as it was before the packed layout */
+class MapAccount
+{
+ public:
+
+  MapAccount(int id, std::string name, std::string pass, currency cur, Money bal)
+      : id_(id), user_name_(name), password_(pass), balance_{} {
+    balance_[cur] = bal;
+  }
+
+  Money GetBalance(currency c) const {
+    auto iter = balance_.find(c);
+    if (iter == balance_.end()) { return Money(); }
+    return iter->second;
+  }
+
+  void Deposit(currency c, Money amount) {
+    auto iter = balance_.find(c);
+    if (iter == balance_.end()) {
+      balance_[c] = Money();
+      iter = balance_.find(c);
+    }
+    iter->second += amount;
+  }
+
+  std::string GetUserName() const { return user_name_; }
+
+  std::string GetPassword() const { return password_; }
+
+ private:
+  int id_;
+  std::string user_name_;
+  std::string password_;
+  std::unordered_map<currency, Money> balance_;
+};
+
+class Op
+{
+ public:
+  int id_;
+  currency cur_;
+  bool deposit_;
+};
+
+template<typename A>
+static void Run(const char* name, int n_accounts, const std::vector<Op>& ops,
+                const std::vector<std::string>& names, const std::string& password) {
+  size_t before = heap_bytes;
+  std::vector<A*> accounts;
+  accounts.reserve(n_accounts);
+  for (int i = 0; i < n_accounts; ++i) {
+    accounts.push_back(new A(i, names[i], password, currency::usd, Money(10000)));
+  }
+  size_t footprint = heap_bytes - before - n_accounts * sizeof(A*);
+
+  auto start = std::chrono::steady_clock::now();
+  double checksum = 0;
+  for (const Op& op : ops) {
+    A* account = accounts[op.id_];
+    // authenticate like the handlers do
+    if (names[op.id_] != account->GetUserName() || password != account->GetPassword()) { continue; }
+    if (op.deposit_) {
+      (void)account->Deposit(op.cur_, Money(100));
+    } else {
+      checksum += account->GetBalance(op.cur_).units_;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%-8s %8.1f ns/op %8.1f bytes/account  (checksum %.0f)\n", name,
+         seconds * 1e9 / ops.size(), static_cast<double>(footprint) / n_accounts, checksum);
+  for (A* account : accounts) { delete account; }
+}
+
+int main(int argc, char* argv[]) {
+  int n_accounts = 100000;
+  size_t n_ops = 10000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--accounts") == 0) {
+      n_accounts = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--ops") == 0) {
+      n_ops = strtoull(argv[i + 1], nullptr, 10);
+    }
+  }
+
+  std::vector<std::string> names;
+  for (int i = 0; i < n_accounts; ++i) {
+    names.push_back("user_with_a_name_" + std::to_string(i));
+  }
+  std::string password = "a_password_past_sso";
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick_id(0, n_accounts - 1);
+  std::uniform_int_distribution<int> pick_cur(0, static_cast<int>(n_currencies) - 1);
+  std::vector<Op> ops(n_ops);
+  for (Op& op : ops) {
+    op = Op{pick_id(rng), static_cast<currency>(pick_cur(rng)), (rng() & 3) == 0};
+  }
+
+  printf("%d accounts, %zu operations, 1 in 4 deposits\n", n_accounts, n_ops);
+  Run<MapAccount>("map", n_accounts, ops, names, password);
+  Run<Account>("packed", n_accounts, ops, names, password);
+  return 0;
+}
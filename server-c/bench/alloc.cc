@@ -0,0 +1,260 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <alloc.cc> file counts the heap allocations the server makes per rpc.
+ *
+ * An in process server group without gui is driven on loopback by one client sending
+ * a request and waiting for its response. After a warm up the calls to operator new
+ * made by the whole process are counted over a run of rpcs, the client itself only
+ * patches the id of prebuilt datagrams so every allocation counted is the server's.
+ * It exits with 1 if a counted rpc allocated, ctest runs it as alloc_steady_state
+ * and, with a write-ahead log in a fresh directory under the given one, as
+ * alloc_steady_state_wal.
+ *
+ *   usage: bench_alloc [--rpcs 100000] [--wire 1|2|3] [--transport socket|uring]
+ *                      [--wal <tmpdir>] */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <string>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "rpc/messages.h"
+#include "server/group.h"
+
+static std::atomic<size_t> alloc_calls = 0;
+static std::atomic<size_t> alloc_bytes = 0;
+
+/* reply cache of a shard, small enough for a warm up to fill it: from then on every
+ *   at most once rpc recycles the entry it evicts instead of growing the cache */
+static constexpr size_t dedup_memory = size_t(1) << 18;
+
+/* rpcs before counting, more than the reply cache holds */
+static constexpr long warm_up_rpcs = 4000;
+
+void* operator new(size_t n) {
+  alloc_calls.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+  if (void* p = std::malloc(n)) { return p; }
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t n, std::align_val_t al) {
+  alloc_calls.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+  size_t a = static_cast<size_t>(al);
+  if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) { return p; }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+/* Views discarding every update, bound so that the controller formats and publishes
+ *   as it would with a gui */
+class NullView : public HeaderViewInterface, public RpcViewInterface, public AccountViewInterface,
+                 public ConsoleViewInterface, public CallbackViewInterface
+{
+ public:
+
+  Controller* controller_ = nullptr;
+
+  void AddController(Controller* controller) override { controller_ = controller; }
+  void AddRpcRequest(const Event&) override {}
+  void AddRpcResponse(const Event&) override {}
+  void CreateAccount(const Event&) override {}
+  void DeleteAccount(const Event&) override {}
+  void UpdateBalance(const Event&) override {}
+  void WriteToConsole(std::string_view) override {}
+  void CreateCallback(const Event&) override {}
+  void DeleteCallback(const Event&) override {}
+};
+
+/* Blocking request / response over one socket */
+class Client
+{
+ public:
+
+  Client(int port, wire_version version) : version_(version), id_(1) {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    timeval tv{1, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    addr_ = sockaddr_in{};
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(port);
+    addr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  }
+
+  ~Client() { close(fd_); }
+
+  /* Serialize a request once, Call then only rewrites its id */
+  void Prepare(op_code op, const char* payload, size_t len) {
+    Request request(0, op, payload, len, version_);
+    out_len_ = request.Serialize(out_.data());
+    // the varint id of v3 changes length, Call rewrites the header in front of the payload
+    payload_at_ = out_len_ - len;
+    op_ = op;
+  }
+
+  /* Send the prepared request under a fresh id, returns the response length, 0 if
+   *   none came back */
+  size_t Call() {
+    int id = id_++;
+    if (version_ == wire_version::v3) {
+      std::array<char, 16> header;
+      Writer writer(header.data(), true);
+      *writer.Put(1) = static_cast<char>(version_);
+      ser(writer, id, op_, static_cast<uint16_t>(out_len_ - payload_at_));
+      std::memmove(out_.data() + writer.Pos(), out_.data() + payload_at_, out_len_ - payload_at_);
+      std::memcpy(out_.data(), header.data(), writer.Pos());
+      out_len_ += writer.Pos() - payload_at_;
+      payload_at_ = writer.Pos();
+    } else {
+      std::memcpy(out_.data() + (version_ == wire_version::v2 ? 1 : 0), &id, sizeof(id));
+    }
+    sendto(fd_, out_.data(), out_len_, 0, reinterpret_cast<sockaddr*>(&addr_), sizeof(addr_));
+    ssize_t n = recv(fd_, in_.data(), in_.size(), 0);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+  }
+
+  /* the message of the last response, null terminated in v1 only */
+  std::string_view Message() const {
+    Reader reader(in_.data(), in_.size(), version_ == wire_version::v3);
+    if (version_ == wire_version::v1) { return std::string_view(in_.data() + 2 * sizeof(int)); }
+    int id;
+    status_code code;
+    uint16_t len;
+    reader.Take(1);
+    des(reader, id, code, len);
+    return std::string_view(in_.data() + reader.Pos(), len);
+  }
+
+ private:
+
+  wire_version version_;
+
+  int fd_;
+
+  sockaddr_in addr_;
+
+  int id_;
+
+  std::array<char, in_buf_len> out_{};
+  size_t out_len_ = 0;
+  size_t payload_at_ = 0;
+  op_code op_ = op_code::open;
+
+  std::array<char, out_buf_len> in_{};
+
+};
+
+/* Count the allocations of rpcs calls after a warm up, returns their number */
+static size_t Measure(const char* name, Client& client, long rpcs) {
+  for (long i = 0; i < std::max(rpcs / 10, warm_up_rpcs); ++i) { client.Call(); }
+  size_t calls = alloc_calls.load();
+  size_t bytes = alloc_bytes.load();
+  long lost = 0;
+  for (long i = 0; i < rpcs; ++i) {
+    if (client.Call() == 0) { lost++; }
+  }
+  calls = alloc_calls.load() - calls;
+  bytes = alloc_bytes.load() - bytes;
+  printf("%-28s %10.4f allocs/rpc %10.1f B/rpc  (%zu allocs over %ld rpcs, %ld lost)\n", name,
+         static_cast<double>(calls) / rpcs, static_cast<double>(bytes) / rpcs, calls, rpcs, lost);
+  return calls;
+}
+
+/* Open the bench account and measure each op in both modes, returns the exit code */
+static int Run(const ServerConfig& config, wire_version version, long rpcs) {
+  NullView view;
+  ServerGroup group(config);
+  group.BindHeaderViewModel(&view);
+  group.BindRpcViewModel(&view);
+  group.BindConsoleViewModel(&view);
+  group.BindAccountViewModel(&view);
+  group.BindCallbackViewModel(&view);
+
+  Client client(config.port, version);
+  bool compact = version == wire_version::v3;
+  char payload[payload_size];
+  Writer open(payload, compact);
+  // encoded from the schemas, so the payloads follow them
+  size_t len = ser(open, OpenRequest{"bench", "bench", Money(100000000), currency::usd});
+  client.Prepare(op_code::open, payload, len);
+  int account_id = -1;
+  std::string message;
+  if (client.Call() != 0) { message = client.Message(); }
+  if (sscanf(message.c_str(), "account created: Account { id: %d", &account_id) != 1) {
+    fprintf(stderr, "cannot open the bench account\n");
+    return 1;
+  }
+  printf("wire v%d, %s transport, %s, %ld rpcs per run\n", static_cast<int>(version),
+         config.backend == transport::uring ? "uring" : "socket",
+         config.wal_dir.empty() ? "no log" : "write-ahead log", rpcs);
+
+  Writer check(payload, compact);
+  size_t check_len = ser(check, CheckBalanceRequest{account_id, "bench", "bench", currency::usd});
+  char deposit[payload_size];
+  Writer credit(deposit, compact);
+  size_t deposit_len = ser(credit, DepositRequest{account_id, "bench", "bench", currency::usd, Money(100)});
+
+  size_t allocs = 0;
+  for (mode m : {mode::at_least_once, mode::at_most_once}) {
+    view.controller_->ChangeMode(m);
+    bool most = m == mode::at_most_once;
+    client.Prepare(op_code::check_balance, payload, check_len);
+    allocs += Measure(most ? "check balance, at most once" : "check balance, at least once", client, rpcs);
+    client.Prepare(op_code::deposit, deposit, deposit_len);
+    allocs += Measure(most ? "deposit, at most once" : "deposit, at least once", client, rpcs);
+  }
+  if (allocs > 0) {
+    fprintf(stderr, "%zu allocations in steady state rpcs\n", allocs);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  long rpcs = 100000;
+  wire_version version = wire_version::v1;
+  transport backend = transport::socket;
+  const char* wal_parent = nullptr;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--rpcs") == 0) {
+      rpcs = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--wire") == 0) {
+      version = static_cast<wire_version>(std::clamp(atoi(argv[i + 1]), 1, 3));
+    } else if (strcmp(argv[i], "--transport") == 0) {
+      backend = strcmp(argv[i + 1], "uring") == 0 ? transport::uring : transport::socket;
+    } else if (strcmp(argv[i], "--wal") == 0) {
+      wal_parent = argv[i + 1];
+    }
+  }
+
+  ServerConfig config;
+  config.port = 18090;
+  config.backend = backend;
+  config.dedup_memory = dedup_memory;
+  if (wal_parent) {
+    // a fresh log, one left by an earlier run would be replayed first
+    std::string dir = std::string(wal_parent) + "/bench_alloc.XXXXXX";
+    if (!mkdtemp(dir.data())) {
+      perror("mkdtemp");
+      return 1;
+    }
+    config.wal_dir = dir;
+  }
+  int code = Run(config, version, rpcs);
+  if (wal_parent) { std::filesystem::remove_all(config.wal_dir); }
+  return code;
+}
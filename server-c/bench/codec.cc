@@ -0,0 +1,48 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <codec.cc> file compares the wire versions on the size of a request and the
+ * cost of decoding it.
+ *
+ * A deposit request is serialized in each version, then decoded in a loop the way a
+ * shard does: the datagram into a recycled request, the payload through a Reader into
+ * the handler's message.
+ *
+ *   usage: bench_codec [--ops 5000000] */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "rpc/messages.h"
+
+static void Measure(wire_version version, long ops) {
+  bool compact = version == wire_version::v3;
+  char payload[payload_size];
+  Writer writer(payload, compact);
+  size_t len = ser(writer, DepositRequest{1042, "alice", "secret", currency::sgd, Money(1250)});
+  char frame[v1_frame_size];
+  size_t frame_len = Request(70000, op_code::deposit, payload, len, version).Serialize(frame);
+
+  Request request;
+  long sink = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (long i = 0; i < ops; ++i) {
+    request.Deserialize(frame, frame_len);
+    auto [id, name, password, unit, amount] = decode<DepositRequest>(request);
+    sink += id + static_cast<long>(name.size()) + static_cast<int>(unit) + amount.units_;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+  printf("wire v%d  %5zu B/frame  %5zu B/payload  %7.1f ns/decode  (%ld)\n", static_cast<int>(version),
+         frame_len, len, ns / ops, sink);
+}
+
+int main(int argc, char* argv[]) {
+  long ops = 5000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--ops") == 0) { ops = atol(argv[i + 1]); }
+  }
+  for (wire_version version : {wire_version::v1, wire_version::v2, wire_version::v3}) { Measure(version, ops); }
+  return 0;
+}
@@ -0,0 +1,165 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <rates.cc> file benchmarks reading the exchange rate table while it is updated,
+ * against the same table behind a mutex.
+ *
+ * Reader threads convert amounts between random currencies and take a snapshot of
+ * the whole table every 64 conversions, first with the writer idle then with a writer
+ * replacing the table in a loop. the left-right table keeps its read cost under
+ * writes, the mutex table makes readers queue behind the writer. a last run calls
+ * convert() of the server alone while its table is replaced in a loop. readers are
+ * timed by their own cpu time, the writer shares their cores.
+ *
+ *   usage: bench_rates [--readers 2] [--reads 10000000] */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core/rates.h"
+
+/* The table as a mutex would guard it */
+class LockedRates
+{
+ public:
+
+  LockedRates() {
+    for (size_t from = 0; from < n_currencies; ++from) {
+      for (size_t to = 0; to < n_currencies; ++to) {
+        rates_[from * n_currencies + to] = exchange_table[from][to];
+      }
+    }
+    SetFactors();
+  }
+
+  Money Convert(Money amount, currency from, currency to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return apply_rate(amount, factors_[static_cast<size_t>(from) * n_currencies + static_cast<size_t>(to)]);
+  }
+
+  Rates Snapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rates_;
+  }
+
+  void Store(const Rates& rates) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rates_ = rates;
+    SetFactors();
+  }
+
+ private:
+  std::mutex mutex_;
+  Rates rates_;
+  std::array<int64_t, n_rates> factors_;
+
+  void SetFactors() {
+    for (size_t i = 0; i < n_rates; ++i) {
+      factors_[i] = rate_factor(rates_[i], static_cast<currency>(i / n_currencies),
+                                static_cast<currency>(i % n_currencies));
+    }
+  }
+};
+
+/* The table of the server, through the functions the shards call */
+class ServerRates
+{
+ public:
+
+  Money Convert(Money amount, currency from, currency to) { return convert(amount, from, to); }
+
+  Rates Snapshot() { return exchange_rates.Snapshot(); }
+
+  void Store(const Rates& rates) { exchange_rates.Store(rates); }
+};
+
+/* cpu time of the calling thread, the readers are timed apart from the writer sharing
+ *   their cores */
+static double ThreadSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+template<typename T>
+static void Run(const char* name, T& table, int n_readers, size_t n_reads, bool writing, bool snapshots = true) {
+  std::atomic<bool> done = false;
+  std::atomic<size_t> writes = 0;
+  std::thread writer;
+  if (writing) {
+    writer = std::thread([&]() {
+      Rates rates = table.Snapshot();
+      size_t n = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        // scale every rate a little and back, the table stays consistent
+        float scale = (n & 1) ? 1.0f / 1.01f : 1.01f;
+        for (float& rate : rates) { rate *= scale; }
+        table.Store(rates);
+        ++n;
+      }
+      writes = n;
+    });
+  }
+
+  std::vector<double> checksums(n_readers);
+  std::vector<double> cpu_seconds(n_readers);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < n_readers; ++r) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 rng(r);
+      double checksum = 0;
+      double start = ThreadSeconds();
+      for (size_t i = 0; i < n_reads; ++i) {
+        auto from = static_cast<currency>(rng() % n_currencies);
+        auto to = static_cast<currency>(rng() % n_currencies);
+        checksum += static_cast<double>(table.Convert(Money(10000), from, to).units_);
+        if (snapshots && (i & 63) == 0) { checksum += table.Snapshot()[i % n_rates]; }
+      }
+      cpu_seconds[r] = ThreadSeconds() - start;
+      checksums[r] = checksum;
+    });
+  }
+  for (auto& reader : readers) { reader.join(); }
+  done = true;
+  if (writer.joinable()) { writer.join(); }
+
+  double checksum = 0, seconds = 0;
+  for (int r = 0; r < n_readers; ++r) {
+    checksum += checksums[r];
+    seconds += cpu_seconds[r];
+  }
+  printf("%-10s %-12s %8.1f ns/read %10zu writes  (checksum %.0f)\n", name,
+         writing ? "busy writer" : "idle writer", seconds * 1e9 / (n_reads * n_readers),
+         writes.load(), checksum);
+}
+
+int main(int argc, char* argv[]) {
+  int n_readers = 2;
+  size_t n_reads = 10000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--readers") == 0) {
+      n_readers = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--reads") == 0) {
+      n_reads = strtoull(argv[i + 1], nullptr, 10);
+    }
+  }
+
+  printf("%d readers, %zu reads each, a snapshot every 64 reads but for convert()\n", n_readers, n_reads);
+  LockedRates locked;
+  Run("mutex", locked, n_readers, n_reads, false);
+  Run("mutex", locked, n_readers, n_reads, true);
+  // a table of its own, exchange_rates is the one of the server
+  static RateTable left_right;
+  Run("leftright", left_right, n_readers, n_reads, false);
+  Run("leftright", left_right, n_readers, n_reads, true);
+  ServerRates server;
+  Run("convert()", server, n_readers, n_reads, false, false);
+  Run("convert()", server, n_readers, n_reads, true, false);
+  return 0;
+}
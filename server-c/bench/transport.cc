@@ -0,0 +1,149 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <transport.cc> file benchmarks the transport backends of the server on loopback.
+ *
+ * Every configuration starts an in process server group without gui and drives it with
+ * client threads, each keeping a window of check balance requests in flight, then
+ * reports the completed requests per second.
+ *
+ *   usage: bench_transport [--seconds 2] [--clients 4] [--window 16] [--shards 1] [--wire 1|2|3] */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "server/group.h"
+
+/* Views discarding every update, keeps the controller from touching a gui */
+class NullView : public HeaderViewInterface, public RpcViewInterface, public AccountViewInterface,
+                 public ConsoleViewInterface, public CallbackViewInterface
+{
+ public:
+
+  Controller* controller_ = nullptr;
+
+  void AddController(Controller* controller) override { controller_ = controller; }
+  void AddRpcRequest(const Event&) override {}
+  void AddRpcResponse(const Event&) override {}
+  void CreateAccount(const Event&) override {}
+  void DeleteAccount(const Event&) override {}
+  void UpdateBalance(const Event&) override {}
+  void WriteToConsole(std::string_view) override {}
+  void CreateCallback(const Event&) override {}
+  void DeleteCallback(const Event&) override {}
+};
+
+class BenchOptions
+{
+ public:
+  double seconds = 2.0;
+  int clients = 4;
+  int window = 16;
+  int shards = 1;
+  wire_version version = wire_version::v1;
+};
+
+/* Drive the server on port until deadline, returns the number of responses received */
+static long RunClient(int port, int window, int client, wire_version version,
+                      std::chrono::steady_clock::time_point deadline) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  timeval tv{0, 10000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  // the account does not exist, the server answers with an error without side effects
+  char payload[payload_size];
+  Writer writer(payload, version == wire_version::v3);
+  size_t payload_len = ser(writer, 0, std::string_view("bench"), std::string_view("bench"), currency::usd);
+  std::array<char, in_buf_len> out{};
+  std::array<char, out_buf_len> in{};
+  int id = client << 24;
+  auto send_one = [&]() {
+    Request request(id++, op_code::check_balance, payload, payload_len, version);
+    size_t len = request.Serialize(out.data());
+    sendto(fd, out.data(), len, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  };
+
+  long done = 0;
+  for (int i = 0; i < window; ++i) { send_one(); }
+  while (std::chrono::steady_clock::now() < deadline) {
+    ssize_t n = recv(fd, in.data(), in.size(), 0);
+    if (n > 0) {
+      done++;
+      send_one();
+    } else {
+      // a datagram was lost, refill the window
+      for (int i = 0; i < window; ++i) { send_one(); }
+    }
+  }
+  close(fd);
+  return done;
+}
+
+static double Run(const char* name, const BenchOptions& opt, transport backend, size_t batch_size, int port) {
+  ServerConfig config;
+  config.port = port;
+  config.batch_size = batch_size;
+  config.shards = opt.shards;
+  config.backend = backend;
+
+  NullView view;
+  ServerGroup group(config);
+  group.BindHeaderViewModel(&view);
+  group.BindRpcViewModel(&view);
+  group.BindConsoleViewModel(&view);
+  group.BindAccountViewModel(&view);
+  group.BindCallbackViewModel(&view);
+  // at least once keeps the request history from growing during the run
+  view.controller_->ChangeMode(mode::at_least_once);
+
+  auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(opt.seconds));
+  std::atomic<long> total = 0;
+  std::vector<std::thread> clients;
+  for (int i = 0; i < opt.clients; ++i) {
+    clients.emplace_back([&, i]() { total += RunClient(port, opt.window, i, opt.version, deadline); });
+  }
+  for (auto& t : clients) { t.join(); }
+
+  double rate = total / opt.seconds;
+  printf("%-16s batch %-4zu %12.0f req/s\n", name, batch_size, rate);
+  return rate;
+}
+
+int main(int argc, char* argv[]) {
+  BenchOptions opt;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--seconds") == 0) {
+      opt.seconds = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--clients") == 0) {
+      opt.clients = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--window") == 0) {
+      opt.window = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--shards") == 0) {
+      opt.shards = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--wire") == 0) {
+      opt.version = static_cast<wire_version>(std::clamp(atoi(argv[i + 1]), 1, 3));
+    }
+  }
+  printf("%d clients, window %d, %d shards, wire v%d, %.1f s per run\n", opt.clients, opt.window, opt.shards,
+         static_cast<int>(opt.version), opt.seconds);
+  Run("socket", opt, transport::socket, 1, 18080);
+  Run("socket", opt, transport::socket, 32, 18081);
+  Run("uring", opt, transport::uring, 32, 18082);
+  return 0;
+}
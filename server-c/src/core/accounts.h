@@ -5,106 +5,192 @@
 #ifndef ACCOUNTS_H
 #define ACCOUNTS_H
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #include "../serdes.h"
 #include "currency.h"
+#include "money.h"
 
-class Account 
+/* max length of an account user name or password, both are stored inline */
+constexpr size_t account_text_max = 39;
+
+/* room for the text of an account, credentials and every balance included */
+constexpr size_t account_text_len = 512;
+
+/* Packed account record, two cache lines with no heap allocation
+ *
+ *   what every operation touches comes first: the id, the per currency balances
+ *   indexed by currency and the credential lengths, followed by the credential bytes */
+class alignas(64) Account
 {
  public:
 
-  Account() = default;
-  Account(int id, std::string name, std::string pass, currency cur, float bal) 
-      : id_(id), user_name_(name), password_(pass), balance_{} {
+  Account() : id_(0), held_(0), user_name_len_(0), password_len_(0), balance_{},
+    user_name_{}, password_{} {}
+
+  /* throws std::runtime_error if a credential is longer than account_text_max */
+  Account(int id, std::string_view name, std::string_view pass, currency cur, Money bal) : Account() {
+    id_ = id;
+    SetUserName(name);
+    SetPassword(pass);
     SetBalance(cur, bal);
   }
-  
+
   ~Account() = default;
 
-  inline size_t Serialize(char* out) {  
-    return ser(out, id_, user_name_, password_, balance_);
+  /* Same wire layout as the former map based record: id, user name, password, then
+   *   the number of currencies held followed by (currency, amount) pairs */
+  inline size_t Serialize(char* out) const {
+    size_t i = ser(out, id_, std::string(GetUserName()), std::string(GetPassword()));
+    size_t n = 0;
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (Holds(static_cast<currency>(c))) { ++n; }
+    }
+    i += serialize(out + i, n);
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (Holds(static_cast<currency>(c))) {
+        i += ser(out + i, static_cast<currency>(c), balance_[c]);
+      }
+    }
+    return i;
   }
 
-  inline size_t Deserialize(const char* in) {
-
-    return des(in, id_, user_name_, password_, balance_);
+  /* throws std::runtime_error if in is cut short or holds an invalid field */
+  inline size_t Deserialize(Reader& in) {
+    std::string_view user_name, password;
+    size_t n = 0;
+    size_t i = des(in, id_, user_name, password, n);
+    SetUserName(user_name);
+    SetPassword(password);
+    held_ = 0;
+    balance_.fill(Money());
+    for (size_t k = 0; k < n; ++k) {
+      currency c;
+      Money amount;
+      i += des(in, c, amount);
+      SetBalance(c, amount);
+    }
+    return i;
   }
 
-  std::string ToString() const {
-    std::string result = "Account { ";
-    result += "id: " + std::to_string(id_);
-    result += ", holder_name: " + user_name_;
-    result += ", password: " + password_;
-    result += ", balance: { ";
+  /* Write the text of ToString to out, truncated to n - 1 bytes and null
+   *   terminated, returns its length */
+  size_t Format(char* out, size_t n) const {
+    size_t len = 0;
+    auto put = [&](int r) { if (r > 0) { len = std::min(len + static_cast<size_t>(r), n - 1); } };
+    put(std::snprintf(out, n, "Account { id: %d, holder_name: %.*s, password: %.*s, balance: { ",
+      id_, static_cast<int>(user_name_len_), user_name_.data(), static_cast<int>(password_len_), password_.data()));
     bool first = true;
-    for (const auto& [cur, amount] : balance_) {
-      if (!first) result += ", ";
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (!Holds(static_cast<currency>(c))) { continue; }
+      put(std::snprintf(out + len, n - len, "%s%s: %s", first ? "" : ", ",
+        currency_name(static_cast<currency>(c)), MoneyText(balance_[c], static_cast<currency>(c)).text_));
       first = false;
-
-      result += currency_to_str(cur);
-      result += ": ";
-      result += std::to_string(amount);
     }
-    result += " } }";
-    return result;
+    put(std::snprintf(out + len, n - len, " } }"));
+    return len;
   }
 
-  inline float GetBalance(currency c) const {
-    auto iter = balance_.find(c);
-    if (iter == balance_.end()) { return 0.0; }
-    return iter->second;
+  std::string ToString() const {
+    char buf[account_text_len];
+    return std::string(buf, Format(buf, sizeof(buf)));
   }
 
-  inline void Deposit(currency c, float amount) {
-    auto iter = balance_.find(c);
-    if (iter == balance_.end()) { 
-      balance_[c] = 0.0; 
-      iter = balance_.find(c);
-    }
-    iter->second += amount;
+  inline Money GetBalance(currency c) const {
+    return balance_[static_cast<size_t>(c)];
   }
 
-  inline void Withdraw(currency c, float amount) {
-    auto iter = balance_.find(c);
-    if (iter == balance_.end()) { }
-    if (iter->second < amount) { }
-    iter->second -= amount;
+  /* Add amount to the balance of c, returns false and leaves it unchanged if the
+   *   sum overflows */
+  [[nodiscard]] inline bool Deposit(currency c, Money amount) {
+    int64_t sum;
+    if (__builtin_add_overflow(balance_[static_cast<size_t>(c)].units_, amount.units_, &sum)) { return false; }
+    held_ |= Bit(c);
+    balance_[static_cast<size_t>(c)] = Money(sum);
+    return true;
   }
 
+  /* callers check the balance first, returns false and leaves it unchanged if the
+   *   difference overflows */
+  [[nodiscard]] inline bool Withdraw(currency c, Money amount) {
+    int64_t difference;
+    if (__builtin_sub_overflow(balance_[static_cast<size_t>(c)].units_, amount.units_, &difference)) {
+      return false;
+    }
+    held_ |= Bit(c);
+    balance_[static_cast<size_t>(c)] = Money(difference);
+    return true;
+  }
+
+  /* whether the account ever held currency c */
+  inline bool Holds(currency c) const { return held_ & Bit(c); }
+
   /* Getters and Setters */
 
   inline int GetId() const { return id_; }
 
   inline void SetId(int id) { id_ = id; }
 
-  inline std::string GetUserName() const { return user_name_; }
+  inline std::string_view GetUserName() const { return {user_name_.data(), user_name_len_}; }
 
-  inline void SetUserName(const std::string& str) { user_name_ = str; }
+  inline void SetUserName(std::string_view str) { user_name_len_ = CopyText(user_name_, str); }
 
-  inline std::string GetPassword() const { return password_; }
+  inline std::string_view GetPassword() const { return {password_.data(), password_len_}; }
 
-  inline void SetPassword(const std::string& str) { password_ = str; }
+  inline void SetPassword(std::string_view str) { password_len_ = CopyText(password_, str); }
 
-  inline const std::unordered_map<currency, float>& GetBalance() const { return balance_; }
+  /* balances indexed by currency, zero for currencies not held */
+  inline const std::array<Money, n_currencies>& GetBalance() const { return balance_; }
+
+  /* bit c is set if the account holds currency c */
+  inline uint8_t GetHeld() const { return held_; }
+
+  inline void SetBalance(currency cur, Money amount) {
+    held_ |= Bit(cur);
+    balance_[static_cast<size_t>(cur)] = amount;
+  }
+
+ private:
 
-  inline void SetBalance(currency cur, float amount) { balance_[cur] = amount; }
-  
- private: 
- 
   /* the account number */
   int id_;
 
+  /* bit c is set if the account holds currency c */
+  uint8_t held_;
+
+  uint8_t user_name_len_;
+
+  uint8_t password_len_;
+
+  /* the balance in terms of each type of currency, in its minor units */
+  std::array<Money, n_currencies> balance_;
+
   /* the user name */
-  std::string user_name_;
+  std::array<char, account_text_max + 1> user_name_;
 
   /* the password */
-  std::string password_;
+  std::array<char, account_text_max + 1> password_;
 
-  /* the balance in terms of each type of currency */
-  std::unordered_map<currency, float> balance_;
+  static constexpr uint8_t Bit(currency c) { return static_cast<uint8_t>(1u << static_cast<size_t>(c)); }
+
+  static uint8_t CopyText(std::array<char, account_text_max + 1>& dst, std::string_view src) {
+    if (src.size() > account_text_max) {
+      throw std::runtime_error("credential longer than " + std::to_string(account_text_max) + " characters");
+    }
+    std::memcpy(dst.data(), src.data(), src.size());
+    dst[src.size()] = '\0';
+    return static_cast<uint8_t>(src.size());
+  }
 
 };
 
-#endif /* ACCOUNTS_H */
\ No newline at end of file
+static_assert(sizeof(Account) == 128, "account record should span exactly two cache lines");
+
+#endif /* ACCOUNTS_H */
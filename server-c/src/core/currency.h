@@ -6,7 +6,9 @@
 #ifndef CURRENCY_H
 #define CURRENCY_H
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <array>
 
@@ -14,7 +16,9 @@ enum class currency {
   usd = 0, rmb, sgd, jpy, bpd, count
 };
 
-inline std::optional<currency> str_to_currency(std::string str) {
+constexpr size_t n_currencies = static_cast<size_t>(currency::count);
+
+inline std::optional<currency> str_to_currency(std::string_view str) {
   if (str == "USD") return currency::usd;
   if (str == "RMB") return currency::rmb; 
   if (str == "SGD") return currency::sgd;
@@ -23,7 +27,8 @@ inline std::optional<currency> str_to_currency(std::string str) {
   return std::nullopt;
 }
 
-inline std::string currency_to_str(currency c) {
+/* name of a currency as a static string, for formatting without allocation */
+constexpr const char* currency_name(currency c) {
   switch (c) {
     case currency::usd: return "USD";
     case currency::rmb: return "RMB";
@@ -34,6 +39,11 @@ inline std::string currency_to_str(currency c) {
   }
 }
 
+inline std::string currency_to_str(currency c) {
+  return currency_name(c);
+}
+
+/* the rates the bank starts with, see exchange_rates in rates.h */
 inline constexpr float exchange_table[(int)currency::count][(int)currency::count] = {
     {1.0000,  7.2300,  1.3400,  150.50,  0.7900},
     {0.1383,  1.0000,  0.1853,  20.810,  0.1093},
@@ -42,8 +52,4 @@ inline constexpr float exchange_table[(int)currency::count][(int)currency::count
     {1.2658,  9.1491,  1.6960,  192.30,  1.0000}
 };
 
-inline float convert(float amount_to_exchange, currency from, currency to) {
-    return amount_to_exchange / exchange_table[(int)from][int(to)];
-}
-
 #endif /* CURRENCY_H */
\ No newline at end of file
@@ -0,0 +1,105 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <money.h> file implements fixed point amounts of money. */
+
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cmath>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "currency.h"
+
+/* decimal digits of the minor unit of a currency, cents for most, yen have none */
+constexpr int currency_scale(currency c) {
+  return c == currency::jpy ? 0 : 2;
+}
+
+/* minor units in one unit of a currency */
+constexpr int64_t currency_unit(currency c) {
+  int64_t unit = 1;
+  for (int i = 0; i < currency_scale(c); ++i) { unit *= 10; }
+  return unit;
+}
+
+/* Amount of money as a count of minor units of its currency
+ *
+ *   the currency is kept alongside (the balance slot, the field of the request), so
+ *   an amount is a plain int64 that adds, subtracts and compares exactly. decimals
+ *   only appear at the edges: the text of a reply and the legacy float records */
+class Money
+{
+ public:
+
+  int64_t units_;
+
+  constexpr Money() : units_(0) {}
+
+  constexpr explicit Money(int64_t units) : units_(units) {}
+
+  /* largest amount a request may move or open an account with, 10^18 minor units,
+   *   well inside int64 */
+  static constexpr int64_t max_units = 1000000000000000000;
+
+  /* whether a request amount is within 0 and max_units */
+  constexpr bool Valid() const { return units_ >= 0 && units_ <= max_units; }
+
+  /* Amount nearest to value units of currency c, halves away from zero */
+  static Money FromDecimal(double value, currency c) {
+    return Money(std::llround(value * static_cast<double>(currency_unit(c))));
+  }
+
+  /* Smallest amount of currency c not below value units */
+  static Money AtLeast(double value, currency c) {
+    return Money(static_cast<int64_t>(std::ceil(value * static_cast<double>(currency_unit(c)))));
+  }
+
+  double ToDecimal(currency c) const {
+    return static_cast<double>(units_) / static_cast<double>(currency_unit(c));
+  }
+
+  /* Write the amount in units of currency c, e.g. "-12.05", to out, truncated to
+   *   n - 1 bytes and null terminated, returns its length */
+  size_t Format(char* out, size_t n, currency c) const {
+    uint64_t magnitude = units_ < 0 ? 0 - static_cast<uint64_t>(units_) : static_cast<uint64_t>(units_);
+    uint64_t unit = static_cast<uint64_t>(currency_unit(c));
+    int r = currency_scale(c) == 0
+      ? std::snprintf(out, n, "%s%llu", units_ < 0 ? "-" : "", static_cast<unsigned long long>(magnitude))
+      : std::snprintf(out, n, "%s%llu.%0*llu", units_ < 0 ? "-" : "",
+          static_cast<unsigned long long>(magnitude / unit), currency_scale(c),
+          static_cast<unsigned long long>(magnitude % unit));
+    if (r < 0) { return 0; }
+    return static_cast<size_t>(r) < n ? static_cast<size_t>(r) : n - 1;
+  }
+
+  constexpr Money& operator+=(Money m) { units_ += m.units_; return *this; }
+
+  constexpr Money& operator-=(Money m) { units_ -= m.units_; return *this; }
+
+  friend constexpr Money operator+(Money a, Money b) { return Money(a.units_ + b.units_); }
+
+  friend constexpr Money operator-(Money a, Money b) { return Money(a.units_ - b.units_); }
+
+  friend constexpr bool operator==(Money a, Money b) = default;
+
+  friend constexpr auto operator<=>(Money a, Money b) = default;
+
+};
+
+/* Text of an amount living as long as the expression using it, for printf like
+ *   formatting: Text("%s", MoneyText(m, c).text_) */
+class MoneyText
+{
+ public:
+
+  MoneyText(Money m, currency c) { m.Format(text_, sizeof(text_), c); }
+
+  /* sign, 19 digits, the point and the terminator */
+  char text_[32];
+
+};
+
+#endif /* MONEY_H */
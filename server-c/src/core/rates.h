@@ -0,0 +1,212 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <rates.h> file implements the exchange rate table updated at run time. */
+
+#ifndef RATES_H
+#define RATES_H
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "currency.h"
+#include "money.h"
+
+/* number of rates, one per ordered pair of currencies */
+constexpr size_t n_rates = n_currencies * n_currencies;
+
+using Rates = std::array<float, n_rates>;
+
+/* rates are kept for conversion as a factor of 2^rate_shift */
+constexpr int rate_shift = 32;
+
+/* bounds of a rate, a factor then fits 63 bits and a product with any amount 127 */
+constexpr float rate_min = 1e-6f;
+constexpr float rate_max = 1e6f;
+
+/* Minor units of from that one minor unit of to is worth at rate (units of to one
+ *   unit of from is worth), times 2^rate_shift and rounded */
+inline int64_t rate_factor(float rate, currency from, currency to) {
+  double minor = static_cast<double>(currency_unit(from)) / static_cast<double>(currency_unit(to));
+  return std::llround(std::ldexp(minor / rate, rate_shift));
+}
+
+/* Amount of from worth amount of to at a rate factor: a 128 bit product shifted
+ *   back, the dropped bits rounding halves away from zero. saturates where no int64
+ *   holds the result */
+inline Money apply_rate(Money amount, int64_t factor) {
+  __int128 product = static_cast<__int128>(amount.units_) * factor;
+  __int128 half = static_cast<__int128>(1) << (rate_shift - 1);
+  __int128 magnitude = ((product < 0 ? -product : product) + half) >> rate_shift;
+  if (magnitude > std::numeric_limits<int64_t>::max()) {
+    return Money(product < 0 ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max());
+  }
+  return Money(static_cast<int64_t>(product < 0 ? -magnitude : magnitude));
+}
+
+/* Exchange rates read by every shard and replaced while they serve
+ *
+ *   two copies of the table, readers use the one named by reading_ while a writer
+ *   fills the other, then flips reading_ and brings the first copy up to date once
+ *   no reader can still be in it (left-right). a single rate is one atomic load of
+ *   the table in use, as every rate and factor is atomic on its own. a snapshot of
+ *   the whole table also marks itself in one of two reader counts, which the writer
+ *   drains before it touches the copy they may be reading. readers never wait nor
+ *   retry, whatever the writers do: both are a fixed number of steps. writers are
+ *   rare, serialized among themselves by a mutex, and wait for the snapshots in
+ *   progress. next to every rate is its fixed point factor, conversions of amounts
+ *   use integers only */
+class RateTable
+{
+ public:
+
+  RateTable() : reading_(0), version_(0), readers_{} {
+    Rates rates;
+    for (size_t from = 0; from < n_currencies; ++from) {
+      for (size_t to = 0; to < n_currencies; ++to) {
+        rates[from * n_currencies + to] = exchange_table[from][to];
+      }
+    }
+    Fill(tables_[0], rates);
+    Fill(tables_[1], rates);
+  }
+
+  RateTable(const RateTable&) = delete;
+  RateTable& operator=(const RateTable&) = delete;
+
+  /* units of to one unit of from is worth, as exchange_table */
+  float Rate(currency from, currency to) const {
+    return tables_[reading_.load(std::memory_order_acquire)].rates_[Index(from, to)].load(std::memory_order_relaxed);
+  }
+
+  /* Amount of from to pay for amount of to, see apply_rate */
+  Money Convert(Money amount, currency from, currency to) const {
+    const Table& table = tables_[reading_.load(std::memory_order_acquire)];
+    return apply_rate(amount, table.factors_[Index(from, to)].load(std::memory_order_relaxed));
+  }
+
+  /* Every rate of one table */
+  Rates Snapshot() const {
+    // counted under the version announced now, the writer waits for it before
+    // writing the copy read below
+    uint32_t version = version_.load();
+    readers_[version].fetch_add(1);
+    const Table& table = tables_[reading_.load()];
+    Rates out;
+    for (size_t i = 0; i < n_rates; ++i) { out[i] = table.rates_[i].load(std::memory_order_relaxed); }
+    readers_[version].fetch_sub(1, std::memory_order_release);
+    return out;
+  }
+
+  /* Replace every rate */
+  void Store(const Rates& rates) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    uint32_t reading = reading_.load(std::memory_order_relaxed);
+    Fill(tables_[reading ^ 1], rates);
+    reading_.store(reading ^ 1);
+    // new snapshots count under the other version, wait for those that may have
+    // seen the old copy, then bring it up to date
+    uint32_t version = version_.load(std::memory_order_relaxed);
+    Drain(version ^ 1);
+    version_.store(version ^ 1);
+    Drain(version);
+    Fill(tables_[reading], rates);
+  }
+
+  /* Update the rates from a file of "FROM TO RATE" lines, e.g. "USD SGD 1.34", blank
+   *   lines and lines from # ignored, pairs not listed keep their rate. the table is
+   *   left unchanged and std::runtime_error thrown if the file cannot be read or a
+   *   line is malformed. returns the number of rates read */
+  size_t Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) { throw std::runtime_error("cannot read rates file " + path); }
+    Rates rates = Snapshot();
+    size_t n = 0;
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+      std::istringstream fields(line.substr(0, line.find('#')));
+      std::string from, to, extra;
+      float rate;
+      if (!(fields >> from)) { continue; }
+      auto from_cur = str_to_currency(from);
+      if (!(fields >> to >> rate) || (fields >> extra)) {
+        throw std::runtime_error(path + ":" + std::to_string(number) + ": expected FROM TO RATE");
+      }
+      auto to_cur = str_to_currency(to);
+      if (!from_cur || !to_cur) {
+        throw std::runtime_error(path + ":" + std::to_string(number) + ": unknown currency");
+      }
+      if (!std::isfinite(rate) || rate < rate_min || rate > rate_max) {
+        throw std::runtime_error(path + ":" + std::to_string(number) + ": rate out of 1e-6 to 1e6");
+      }
+      if (*from_cur == *to_cur && rate != 1) {
+        throw std::runtime_error(path + ":" + std::to_string(number) + ": a currency is worth itself");
+      }
+      rates[Index(*from_cur, *to_cur)] = rate;
+      ++n;
+    }
+    Store(rates);
+    return n;
+  }
+
+ private:
+
+  /* one copy of the rates */
+  class Table
+  {
+   public:
+    std::array<std::atomic<float>, n_rates> rates_;
+    /* the rates as used by Convert */
+    std::array<std::atomic<int64_t>, n_rates> factors_;
+  };
+
+  std::array<Table, 2> tables_;
+
+  /* copy of tables_ the readers use */
+  std::atomic<uint32_t> reading_;
+
+  /* reader count a snapshot starting now marks itself in */
+  std::atomic<uint32_t> version_;
+
+  /* snapshots in progress under each version, apart from the lines the readers only
+   *   load */
+  alignas(64) mutable std::array<std::atomic<uint32_t>, 2> readers_;
+
+  std::mutex write_mutex_;
+
+  static void Fill(Table& table, const Rates& rates) {
+    for (size_t i = 0; i < n_rates; ++i) {
+      table.rates_[i].store(rates[i], std::memory_order_relaxed);
+      table.factors_[i].store(rate_factor(rates[i], static_cast<currency>(i / n_currencies),
+                                          static_cast<currency>(i % n_currencies)), std::memory_order_relaxed);
+    }
+  }
+
+  /* Wait until no snapshot counts under version */
+  void Drain(uint32_t version) const {
+    while (readers_[version].load(std::memory_order_acquire) != 0) { std::this_thread::yield(); }
+  }
+
+  static size_t Index(currency from, currency to) {
+    return static_cast<size_t>(from) * n_currencies + static_cast<size_t>(to);
+  }
+
+};
+
+/* the rates of the bank, exchange_table until updated */
+inline RateTable exchange_rates;
+
+inline Money convert(Money amount_to_exchange, currency from, currency to) {
+  return exchange_rates.Convert(amount_to_exchange, from, to);
+}
+
+#endif /* RATES_H */
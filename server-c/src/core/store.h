@@ -0,0 +1,184 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <store.h> file implements the account store of one shard. */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "accounts.h"
+#include "currency.h"
+
+/* Slab of account records indexed directly by account id
+ *
+ *   a store owns the ids offset, offset + stride, offset + 2 * stride, ..., the id of
+ *   slot s being offset + s * stride, so finding an account is a division and two
+ *   array indexing, no hashing. records live in chunks of 2^chunk_bits slots that are
+ *   never moved or freed before the store, pointers stay valid until the account is
+ *   erased. chunks are either allocated or adopted from a mapped snapshot. an erased
+ *   slot stays tombstoned in the live bitmap and is never handed out again: a closed
+ *   account number may still be named by a cross shard credit in flight, a monitor
+ *   filter or a remembered reply, none of which must reach a newer account */
+class AccountStore
+{
+ public:
+
+  static constexpr size_t chunk_bits = 12;
+  static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+
+  AccountStore(int offset = 0, int stride = 1) : offset_(offset), stride_(stride), next_slot_(0), size_(0) {}
+
+  AccountStore(const AccountStore&) = delete;
+  AccountStore& operator=(const AccountStore&) = delete;
+
+  /* Create an account under the next id never handed out, throws std::runtime_error
+   *   (from Account) without using up an id if a credential is too long, or if the
+   *   ids are exhausted */
+  Account& Create(std::string_view user_name, std::string_view password, currency cur, Money balance) {
+    Account account(0, user_name, password, cur, balance);
+    if (next_slot_ > static_cast<size_t>((std::numeric_limits<int>::max() - offset_) / stride_)) {
+      throw std::runtime_error("no account number left");
+    }
+    size_t slot = next_slot_++;
+    if ((slot >> chunk_bits) == chunks_.size()) { AddChunk(); }
+    live_[slot / 64] |= uint64_t(1) << (slot % 64);
+    ++size_;
+    Account& record = At(slot);
+    record = account;
+    record.SetId(IdOf(slot));
+    return record;
+  }
+
+  /* Put account under its own id, replacing any live account there, used to
+   *   rebuild the store on recovery. returns null if the id is not owned by the store */
+  Account* Insert(const Account& account) {
+    int id = account.GetId();
+    if (id < offset_ || (id - offset_) % stride_ != 0) { return nullptr; }
+    size_t slot = static_cast<size_t>((id - offset_) / stride_);
+    while ((slot >> chunk_bits) >= chunks_.size()) { AddChunk(); }
+    next_slot_ = std::max(next_slot_, slot + 1);
+    if (!IsLive(slot)) {
+      live_[slot / 64] |= uint64_t(1) << (slot % 64);
+      ++size_;
+    }
+    At(slot) = account;
+    return &At(slot);
+  }
+
+  /* Live account of id, nullptr if there is none */
+  Account* Find(int id) {
+    size_t slot;
+    if (!SlotOf(id, slot) || !IsLive(slot)) { return nullptr; }
+    return &At(slot);
+  }
+
+  const Account* Find(int id) const {
+    return const_cast<AccountStore*>(this)->Find(id);
+  }
+
+  /* Tombstone the account of id, returns false if there is none */
+  bool Erase(int id) {
+    size_t slot;
+    if (!SlotOf(id, slot) || !IsLive(slot)) { return false; }
+    live_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    At(slot) = Account();
+    --size_;
+    return true;
+  }
+
+  /* number of live accounts */
+  size_t Size() const { return size_; }
+
+  /* Raw layout, for snapshots */
+
+  /* slots handed out so far, live or not */
+  size_t Slots() const { return next_slot_; }
+
+  size_t Chunks() const { return chunks_.size(); }
+
+  const Account* Chunk(size_t k) const { return chunks_[k]; }
+
+  /* live bitmap, chunk_size / 64 words per chunk */
+  const std::vector<uint64_t>& Live() const { return live_; }
+
+  /* Take over n_chunks full chunks laid out back to back from base and their live
+   *   bitmap, n_slots of them handed out. base is typically a private mapping of a
+   *   snapshot which mapping keeps alive, records are then only paged in when touched.
+   *   the store must be empty */
+  void Adopt(Account* base, size_t n_chunks, size_t n_slots, const uint64_t* live, 
+             std::shared_ptr<void> mapping) {
+    mapping_ = std::move(mapping);
+    for (size_t k = 0; k < n_chunks; ++k) {
+      chunks_.push_back(base + k * chunk_size);
+    }
+    live_.assign(live, live + n_chunks * chunk_size / 64);
+    next_slot_ = n_slots;
+    size_ = 0;
+    for (uint64_t word : live_) { size_ += std::popcount(word); }
+  }
+
+  /* Call f on every live account in id order, walking the chunks front to back and
+   *   skipping 64 dead slots at a time */
+  template<typename F>
+  void ForEach(F&& f) {
+    for (size_t w = 0; w < live_.size(); ++w) {
+      uint64_t bits = live_[w];
+      while (bits) {
+        size_t slot = w * 64 + std::countr_zero(bits);
+        bits &= bits - 1;
+        f(At(slot));
+      }
+    }
+  }
+
+ private:
+
+  int offset_;
+
+  int stride_;
+
+  std::vector<Account*> chunks_;
+
+  /* chunks allocated by the store, the adopted ones are owned by mapping_ */
+  std::vector<std::unique_ptr<Account[]>> owned_;
+
+  std::shared_ptr<void> mapping_;
+
+  /* bit s is set if slot s holds a live account */
+  std::vector<uint64_t> live_;
+
+  /* first slot never handed out */
+  size_t next_slot_;
+
+  size_t size_;
+
+  void AddChunk() {
+    owned_.push_back(std::make_unique<Account[]>(chunk_size));
+    chunks_.push_back(owned_.back().get());
+    live_.resize(live_.size() + chunk_size / 64, 0);
+  }
+
+  Account& At(size_t slot) { return chunks_[slot >> chunk_bits][slot & (chunk_size - 1)]; }
+
+  bool IsLive(size_t slot) const { return live_[slot / 64] & (uint64_t(1) << (slot % 64)); }
+
+  int IdOf(size_t slot) const { return offset_ + static_cast<int>(slot) * stride_; }
+
+  bool SlotOf(int id, size_t& slot) const {
+    if (id < offset_ || (id - offset_) % stride_ != 0) { return false; }
+    slot = static_cast<size_t>((id - offset_) / stride_);
+    return slot < next_slot_;
+  }
+
+};
+
+#endif /* STORE_H */
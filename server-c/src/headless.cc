@@ -0,0 +1,50 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The entry point of the headless server, runs the shards without any gui until
+ * SIGINT or SIGTERM. Only the console is bound, to stderr, and the main thread
+ * drains it once per frame while it waits for the signal. Every other view update
+ * is dropped by the controller. */
+
+#include <csignal>
+#include <iostream>
+#include <memory>
+
+#include <pthread.h>
+
+#include "server/config.h"
+#include "server/group.h"
+
+class StderrConsole : public ConsoleViewInterface
+{
+ public:
+  void WriteToConsole(std::string_view str) override {
+    std::cerr << str << '\n';
+  }
+};
+
+int main(int argc, char* argv[]) {
+
+  ServerConfig config = ParseServerConfig(argc, argv);
+
+  // block the stop signals before the shards start so that only sigwait sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  StderrConsole console;
+  std::unique_ptr<ServerGroup> server = std::make_unique<ServerGroup>(config);
+  server->BindConsoleViewModel(&console);
+  std::cerr << "listening on port " << config.port << " with " << config.shards << " shard(s)" << std::endl;
+
+  timespec frame{0, event_drain_interval_ms * 1000000L};
+  int sig = -1;
+  while (sig < 0) {
+    server->DrainEvents();
+    sig = sigtimedwait(&signals, nullptr, &frame);
+  }
+  std::cerr << "stopping on signal " << sig << std::endl;
+  server.reset();
+  return 0;
+}
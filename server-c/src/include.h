@@ -11,7 +11,12 @@
 #include "rpc/include.h"
 
 #include "server/callback.h"
+#include "server/config.h"
+#include "server/events.h"
+#include "server/mpsc.h"
+#include "server/uring.h"
 #include "server/server.h"
 #include "server/controller.h"
+#include "server/group.h"
 
 #include "qt/include.h"
\ No newline at end of file
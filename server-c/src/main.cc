@@ -8,18 +8,28 @@
 #include <thread>
 
 #include <QApplication>
+#include <QTimer>
 
 int main(int argc, char* argv[]) {
 
+  ServerConfig config = ParseServerConfig(argc, argv);
+
   QApplication app(argc, argv);
   MainWindow main_window;
+  main_window.GetRpcPanel()->SetCapacity(config.rpc_log_capacity);
+  main_window.GetRpcConsole()->SetCapacity(config.rpc_log_capacity);
 
-  std::unique_ptr<Server> server = std::make_unique<Server>(8080);
+  std::unique_ptr<ServerGroup> server = std::make_unique<ServerGroup>(config);
   server->BindHeaderViewModel(main_window.GetHeader());
   server->BindRpcViewModel(main_window.GetRpcPanel());
   server->BindConsoleViewModel(main_window.GetRpcConsole());
   server->BindAccountViewModel(main_window.GetAccountPanel());
   server->BindCallbackViewModel(main_window.GetCallbackPanel());
+
+  // the shards only publish events, apply them to the panels once per frame
+  QTimer drain_timer;
+  QObject::connect(&drain_timer, &QTimer::timeout, [&server]() { server->DrainEvents(); });
+  drain_timer.start(event_drain_interval_ms);
   
   main_window.show();
   return app.exec();
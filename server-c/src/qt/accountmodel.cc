@@ -0,0 +1,138 @@
+/* Copyright 2026 (c), Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "accountmodel.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "../core/currency.h"
+
+AccountTableModel::AccountTableModel(QObject* parent)
+  : QAbstractTableModel(parent), dirty_first_(INT_MAX), dirty_last_(-1), appended_(false) {}
+
+int AccountTableModel::rowCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : static_cast<int>(rows_.size());
+}
+
+int AccountTableModel::columnCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : n_columns;
+}
+
+QVariant AccountTableModel::data(const QModelIndex& index, int role) const {
+  if (!index.isValid() || index.row() >= static_cast<int>(rows_.size())) {
+    return QVariant();
+  }
+  if (role == Qt::TextAlignmentRole) {
+    return QVariant(Qt::AlignCenter);
+  }
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  const AccountRow& row = rows_[index.row()];
+  switch (index.column()) {
+    case col_id: return row.id_;
+    case col_user_name: return QString::fromUtf8(row.user_name_);
+    case col_password: return QString::fromUtf8(row.password_);
+    case col_balance: {
+      // one line per row keeps every row the same height, so the view never measures
+      QString balance;
+      for (size_t c = 0; c < n_currencies; ++c) {
+        if (row.held_ & (1u << c)) {
+          if (!balance.isEmpty()) { balance += "  "; }
+          balance += QString::fromUtf8(MoneyText(row.balance_[c], static_cast<currency>(c)).text_) + " "
+            + QString::fromStdString(currency_to_str(static_cast<currency>(c)));
+        }
+      }
+      return balance;
+    }
+    default: return QVariant();
+  }
+}
+
+QVariant AccountTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+    return QAbstractTableModel::headerData(section, orientation, role);
+  }
+  switch (section) {
+    case col_id: return QString("Account number");
+    case col_user_name: return QString("User name");
+    case col_password: return QString("Password");
+    case col_balance: return QString("Balance");
+    default: return QVariant();
+  }
+}
+
+/* Apply account events */
+
+static void CopySnapshot(AccountRow& row, const Event& e) {
+  row.id_ = e.account_id_;
+  row.held_ = e.held_;
+  std::memcpy(row.balance_, e.balance_, sizeof(row.balance_));
+}
+
+void AccountTableModel::Insert(const Event& e) {
+  auto it = index_.find(e.account_id_);
+  if (it != index_.end()) {
+    AccountRow& row = rows_[it->second];
+    CopySnapshot(row, e);
+    std::memcpy(row.user_name_, e.user_name_, sizeof(row.user_name_));
+    std::memcpy(row.password_, e.password_, sizeof(row.password_));
+    emit dataChanged(index(it->second, 0), index(it->second, n_columns - 1));
+    return;
+  }
+  int n = static_cast<int>(rows_.size());
+  beginInsertRows(QModelIndex(), n, n);
+  AccountRow& row = rows_.emplace_back();
+  CopySnapshot(row, e);
+  std::memcpy(row.user_name_, e.user_name_, sizeof(row.user_name_));
+  std::memcpy(row.password_, e.password_, sizeof(row.password_));
+  index_.emplace(e.account_id_, n);
+  endInsertRows();
+  appended_ = true;
+}
+
+void AccountTableModel::Remove(const Event& e) {
+  auto it = index_.find(e.account_id_);
+  if (it == index_.end()) {
+    return;
+  }
+  int row = it->second;
+  int last = static_cast<int>(rows_.size()) - 1;
+  index_.erase(it);
+  if (row != last) {
+    rows_[row] = rows_[last];
+    index_[rows_[row].id_] = row;
+    emit dataChanged(index(row, 0), index(row, n_columns - 1));
+  }
+  beginRemoveRows(QModelIndex(), last, last);
+  rows_.pop_back();
+  endRemoveRows();
+}
+
+void AccountTableModel::UpdateBalance(const Event& e) {
+  auto it = index_.find(e.account_id_);
+  if (it == index_.end()) {
+    return;
+  }
+  CopySnapshot(rows_[it->second], e);
+  MarkDirty(it->second);
+}
+
+void AccountTableModel::MarkDirty(int row) {
+  dirty_first_ = std::min(dirty_first_, row);
+  dirty_last_ = std::max(dirty_last_, row);
+}
+
+bool AccountTableModel::Flush() {
+  // rows removed after being marked may have shrunk the table
+  int last = std::min(dirty_last_, static_cast<int>(rows_.size()) - 1);
+  if (dirty_first_ <= last) {
+    emit dataChanged(index(dirty_first_, col_balance), index(last, col_balance), {Qt::DisplayRole});
+  }
+  dirty_first_ = INT_MAX;
+  dirty_last_ = -1;
+  bool appended = appended_;
+  appended_ = false;
+  return appended;
+}
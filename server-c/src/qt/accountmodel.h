@@ -0,0 +1,81 @@
+/* Copyright 2026 (c), Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <accountmodel.h> file defines the table model behind the account panel.
+ *
+ * Accounts are kept as fixed size snapshots in one contiguous array with a hash index
+ * from account id to row, so creating, deleting and updating an account costs O(1)
+ * whatever the number of rows. Cells are only formatted when the view asks for them,
+ * i.e. for the rows on screen. */
+
+#ifndef GUI_ACCOUNTMODEL_H
+#define GUI_ACCOUNTMODEL_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <QAbstractTableModel>
+
+#include "../server/events.h"
+
+/* Snapshot of one account row, same fields as the account events */
+class AccountRow
+{
+ public:
+  int id_;
+  uint8_t held_;
+  Money balance_[n_currencies];
+  char user_name_[event_text_len];
+  char password_[event_text_len];
+};
+
+class AccountTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+ public:
+
+  enum column { col_id = 0, col_user_name, col_password, col_balance, n_columns };
+
+  explicit AccountTableModel(QObject* parent = nullptr);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  /* Apply account events, an event for an unknown id is ignored except for creation,
+   *   creating an existing id overwrites its row */
+
+  void Insert(const Event& e);
+
+  /* the last row is moved into the hole, so rows are not kept in creation order */
+  void Remove(const Event& e);
+
+  /* only marks the row, the view is told once per batch by Flush */
+  void UpdateBalance(const Event& e);
+
+  /* Notify the view of the balance updates since the last flush, returns whether
+   *   rows were appended since the last flush */
+  bool Flush();
+
+ private:
+
+  std::vector<AccountRow> rows_;
+
+  std::unordered_map<int, int> index_;
+
+  /* range of rows with a pending balance update, empty if first > last */
+  int dirty_first_;
+  int dirty_last_;
+
+  bool appended_;
+
+  void MarkDirty(int row);
+
+};
+
+#endif /* GUI_ACCOUNTMODEL_H */
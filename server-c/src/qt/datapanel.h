@@ -1,6 +1,6 @@
 /* Copyright 2026 (c), Yao Zeran, Zhang Chenzhi, Zhang Senyao
  *
- * The <datapanel.h> file defines qt panel widget which shows demo data */
+ * The <datapanel.h> file defines qt panel widget which shows accounts and callbacks */
 
 #ifndef DATAPANEL_H
 #define DATAPANEL_H
@@ -10,6 +10,7 @@
 #include <QStandardItemModel>
 
 #include "../core/accounts.h"
+#include "accountmodel.h"
 #include "../server/controller.h"
 
 class AccountPanel : public QWidget, public AccountViewInterface
@@ -20,28 +21,19 @@ class AccountPanel : public QWidget, public AccountViewInterface
 
   AccountPanel(QWidget* parent);
 
-  void CreateAccount(const Account& account) override;
+  void CreateAccount(const Event& e) override;
 
-  void DeleteAccount(const Account& account) override;
+  void DeleteAccount(const Event& e) override;
 
-  void HandleDeposit(const Account& account) override;
+  void UpdateBalance(const Event& e) override;
 
-  void HandleWithdraw(const Account& account) override;
-
-  void HandleTransfer(const Account& recv_account, const Account& send_account) override;
-
-  void HandleExchange(const Account& account) override;
+  void EndBatch() override;
  
  private: 
 
   QTableView* table_;
 
-  QStandardItemModel* accounts_;
-
-  void CreateAccount(const QString& id, const QString& user_name, 
-    const QString& password, const QString& balance_);
-
-  void HandleAccountBalanceUpdate(const Account& account);
+  AccountTableModel* accounts_;
 
 };
 
@@ -53,9 +45,9 @@ class CallbackPanel : public QWidget, public CallbackViewInterface
 
   CallbackPanel(QWidget* parent);
 
-  void CreateCallback(const CallbackData& callback) override;
+  void CreateCallback(const Event& e) override;
 
-  void DeleteCallback(const CallbackData& callback) override;
+  void DeleteCallback(const Event& e) override;
 
  private:
 
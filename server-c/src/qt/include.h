@@ -8,6 +8,8 @@
 #include "delegate.h"
 
 #include "header.h"
+#include "accountmodel.h"
+#include "rpcmodel.h"
 #include "rpcpanel.h"
 #include "datapanel.h"
 
@@ -0,0 +1,112 @@
+/* Copyright 2026 (c), Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "rpcmodel.h"
+
+#include <arpa/inet.h>
+
+#include <QBrush>
+#include <QDateTime>
+
+#include "../rpc/protocol.h"
+
+RpcLogModel::RpcLogModel(size_t capacity, QObject* parent)
+  : QAbstractTableModel(parent), ring_(capacity > 0 ? capacity : 1), head_(0), size_(0) {}
+
+int RpcLogModel::rowCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : static_cast<int>(size_);
+}
+
+int RpcLogModel::columnCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : n_columns;
+}
+
+QVariant RpcLogModel::data(const QModelIndex& index, int role) const {
+  if (!index.isValid() || index.row() >= static_cast<int>(size_)) {
+    return QVariant();
+  }
+  const RpcEntry& entry = At(index.row());
+  if (role == Qt::TextAlignmentRole) {
+    return QVariant(Qt::AlignCenter);
+  }
+  if (role == Qt::ForegroundRole && index.column() == col_type) {
+    return entry.response_ ? QBrush(Qt::magenta) : QBrush(Qt::blue);
+  }
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  switch (index.column()) {
+    case col_time: {
+      return QDateTime::fromMSecsSinceEpoch(entry.time_).toString("ddd MMM d hh:mm:ss yyyy");
+    }
+    case col_type: return entry.response_ ? QString("POST") : QString("RECV");
+    case col_ip: {
+      in_addr addr{};
+      addr.s_addr = entry.ip_;
+      char buf[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+      return QString(buf);
+    }
+    case col_id: return entry.rpc_id_;
+    case col_code: {
+      std::string code = entry.response_
+        ? status_code_to_str(static_cast<status_code>(entry.code_))
+        : op_code_to_str(static_cast<op_code>(entry.code_));
+      return QString::fromStdString(code);
+    }
+    default: return QVariant();
+  }
+}
+
+QVariant RpcLogModel::headerData(int section, Qt::Orientation orientation, int role) const {
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+    return QAbstractTableModel::headerData(section, orientation, role);
+  }
+  switch (section) {
+    case col_time: return QString("Timestamp");
+    case col_type: return QString("Type");
+    case col_ip: return QString("Ip");
+    case col_id: return QString("Id");
+    case col_code: return QString("Code");
+    default: return QVariant();
+  }
+}
+
+void RpcLogModel::SetCapacity(size_t capacity) {
+  beginResetModel();
+  ring_.assign(capacity > 0 ? capacity : 1, RpcEntry{});
+  ring_.shrink_to_fit();
+  head_ = 0;
+  size_ = 0;
+  pending_.clear();
+  endResetModel();
+}
+
+void RpcLogModel::Append(const Event& e) {
+  pending_.push_back(RpcEntry{e.time_, e.ip_, e.rpc_id_, e.code_,
+    e.kind_ == Event::kind::rpc_response});
+}
+
+bool RpcLogModel::Flush() {
+  if (pending_.empty()) {
+    return false;
+  }
+  size_t capacity = ring_.size();
+  // only the newest capacity rpcs of the batch can survive it
+  size_t skip = pending_.size() > capacity ? pending_.size() - capacity : 0;
+  size_t n = pending_.size() - skip;
+  size_t evict = size_ + n > capacity ? size_ + n - capacity : 0;
+  if (evict > 0) {
+    beginRemoveRows(QModelIndex(), 0, static_cast<int>(evict) - 1);
+    head_ = (head_ + evict) % capacity;
+    size_ -= evict;
+    endRemoveRows();
+  }
+  beginInsertRows(QModelIndex(), static_cast<int>(size_), static_cast<int>(size_ + n) - 1);
+  for (size_t i = skip; i < pending_.size(); ++i) {
+    ring_[(head_ + size_) % capacity] = pending_[i];
+    ++size_;
+  }
+  endInsertRows();
+  pending_.clear();
+  return true;
+}
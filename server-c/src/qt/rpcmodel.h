@@ -0,0 +1,73 @@
+/* Copyright 2026 (c), Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <rpcmodel.h> file defines the table model behind the rpc panel.
+ *
+ * The log is a ring of fixed capacity allocated once, when it is full every new rpc
+ * replaces the oldest one, so a long running server keeps a constant footprint. */
+
+#ifndef GUI_RPCMODEL_H
+#define GUI_RPCMODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QAbstractTableModel>
+
+#include "../server/events.h"
+
+/* One logged rpc, copied from its event */
+class RpcEntry
+{
+ public:
+  int64_t time_;
+  uint32_t ip_;
+  int rpc_id_;
+  int code_;
+  /* request received or response posted */
+  bool response_;
+};
+
+class RpcLogModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+ public:
+
+  enum column { col_time = 0, col_type, col_ip, col_id, col_code, n_columns };
+
+  RpcLogModel(size_t capacity, QObject* parent = nullptr);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  /* Drop the log and keep at most capacity rpcs from now on */
+  void SetCapacity(size_t capacity);
+
+  /* Stage an rpc, it becomes visible on the next Flush */
+  void Append(const Event& e);
+
+  /* Move the staged rpcs into the ring evicting the oldest ones, the view is told
+   *   with one removal and one insertion, returns whether anything was appended */
+  bool Flush();
+
+ private:
+
+  std::vector<RpcEntry> ring_;
+
+  /* slot of the oldest entry and number of entries in the ring */
+  size_t head_;
+  size_t size_;
+
+  std::vector<RpcEntry> pending_;
+
+  const RpcEntry& At(int row) const { return ring_[(head_ + row) % ring_.size()]; }
+
+};
+
+#endif /* GUI_RPCMODEL_H */
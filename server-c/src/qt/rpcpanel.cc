@@ -5,60 +5,38 @@
 #include <QVBoxLayout>
 #include <QHeaderView>
 
-#include "../rpc/protocol.h"
+#include "../server/config.h"
 #include "delegate.h"
 
-#include <iostream>
-
 RpcPanel::RpcPanel(QWidget* parent) : QWidget(parent) {
   QVBoxLayout* rpc_layout = new QVBoxLayout(this);
   table_view_ = new QTableView(this);
-  rpc_log_ = new QStandardItemModel(0, 5, this);
-  rpc_log_->setHorizontalHeaderLabels({"Timestamp", "Type", "Ip", "Id", "Code"});
+  rpc_log_ = new RpcLogModel(ServerConfig{}.rpc_log_capacity, this);
   table_view_->setModel(rpc_log_);
   table_view_->setEditTriggers(QAbstractItemView::NoEditTriggers);
   table_view_->setItemDelegate(new PaddingDelegate(this));
-  table_view_->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+  // fixed row heights and column widths, the view only formats the rows on screen
+  table_view_->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+  table_view_->horizontalHeader()->setStretchLastSection(true);
+  table_view_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  table_view_->verticalHeader()->setDefaultSectionSize(table_view_->fontMetrics().height() + 10);
   table_view_->verticalHeader()->setVisible(false);
   rpc_layout->addWidget(table_view_);
   setLayout(rpc_layout);
 }
 
-void RpcPanel::AddRpcRequest(const std::string& t, const std::string& ip, const Request& req) {
-  QString t_ = QString::fromStdString(t);
-  QString ip_ = QString::fromStdString(ip);
-  QString id_ = QString::number(req.GetId());
-  QString op_code_ = QString::fromStdString(op_code_to_str(req.GetOpCode()));
-  AddRpcEntry(t_, "RECV", ip_, id_, op_code_);
+void RpcPanel::AddRpcRequest(const Event& e) {
+  rpc_log_->Append(e);
 }
 
-void RpcPanel::AddRpcResponse(const std::string& t, const std::string& ip, const Response& response) {
-  QString t_ = QString::fromStdString(t);
-  QString ip_ = QString::fromStdString(ip);
-  QString id_ = QString::number(response.GetId());
-  QString status_code_ = QString::fromStdString(status_code_to_str(response.GetStatusCode()));
-  AddRpcEntry(t_, "POST", ip_, id_, status_code_); 
+void RpcPanel::AddRpcResponse(const Event& e) {
+  rpc_log_->Append(e);
 }
 
-void RpcPanel::AddRpcEntry(const QString& timestamp, const QString& rpc_type, 
-    const QString& ip, const QString& id, const QString& op_code) {
-  QMetaObject::invokeMethod(this, [this, timestamp, rpc_type, ip, id, op_code]() {
-    auto MakeItem = [](const QString& text) {
-      QStandardItem* item = new QStandardItem(text);
-      item->setTextAlignment(Qt::AlignCenter);
-      return item;
-    };
-    QList<QStandardItem*> row;
-    row << MakeItem(timestamp);
-    QStandardItem* rpc_item = MakeItem(rpc_type);
-    rpc_item->setForeground(rpc_type == "RECV" ? QBrush(Qt::blue) : QBrush(Qt::magenta));
-    row << (rpc_item);
-    row << MakeItem(ip);
-    row << MakeItem(id);
-    row << MakeItem(op_code);
-    rpc_log_->appendRow(row);
+void RpcPanel::EndBatch() {
+  if (rpc_log_->Flush()) {
     table_view_->scrollToBottom();
-  }, Qt::QueuedConnection);
+  }
 }
 
 
@@ -68,6 +46,7 @@ RpcConsole::RpcConsole(QWidget* parent) : QWidget(parent) {
     // 2. Initialize the text edit
     consoleOutput = new QPlainTextEdit(this);
     consoleOutput->setReadOnly(true); // Prevent user from typing directly
+    SetCapacity(ServerConfig{}.rpc_log_capacity);
     // 3. Optional: Make it look like a real console
     // consoleOutput->setStyleSheet(
     //     "background-color: black; "
@@ -78,12 +57,17 @@ RpcConsole::RpcConsole(QWidget* parent) : QWidget(parent) {
     setLayout(layout);
 }
 
-void RpcConsole::WriteToConsole(const std::string& str) {
-  QMetaObject::invokeMethod(this, [this, str]() {
-    // Convert std::string to QString and append
-    // appendPlainText adds a newline automatically
-    consoleOutput->appendPlainText(QString::fromStdString(str));
-    // 4. Auto-scroll to the bottom
-    consoleOutput->ensureCursorVisible();
-  }, Qt::QueuedConnection); 
-}
\ No newline at end of file
+void RpcConsole::WriteToConsole(std::string_view view) {
+  // called by the frame drain on the gui thread, appendPlainText adds the newline
+  consoleOutput->appendPlainText(QString::fromUtf8(view.data(), static_cast<int>(view.size())));
+}
+
+void RpcConsole::EndBatch() {
+  // scroll to the bottom once per frame rather than per line
+  consoleOutput->ensureCursorVisible();
+}
+
+void RpcConsole::SetCapacity(size_t capacity) {
+  // the document drops its first blocks once it holds more than this many
+  consoleOutput->setMaximumBlockCount(static_cast<int>(capacity));
+}
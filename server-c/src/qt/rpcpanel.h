@@ -8,10 +8,10 @@
 #include <QWidget>
 #include <QTableView>
 #include <QPlainTextEdit>
-#include <QStandardItemModel>
 
 #include "../rpc/request.h"
 #include "../server/controller.h"
+#include "rpcmodel.h"
 
 
 class RpcPanel: public QWidget, public RpcViewInterface
@@ -23,19 +23,21 @@ class RpcPanel: public QWidget, public RpcViewInterface
 
   RpcPanel(QWidget* parent);
 
-  void AddRpcRequest(const std::string& t, const std::string& ip, const Request& req) override;
+  void AddRpcRequest(const Event& e) override;
 
-  void AddRpcResponse(const std::string& t, const std::string& ip, const Response& resp) override;
+  void AddRpcResponse(const Event& e) override;
+
+  void EndBatch() override;
+
+  /* Keep at most capacity rpcs, drops the current log */
+  void SetCapacity(size_t capacity) { rpc_log_->SetCapacity(capacity); }
 
 
  private:
 
   QTableView* table_view_;
 
-  QStandardItemModel* rpc_log_; 
-
-  void AddRpcEntry(const QString& timestamp, const QString& rpc_type, 
-    const QString& ip, const QString& id, const QString& op_code);
+  RpcLogModel* rpc_log_; 
 
 };
 
@@ -47,7 +49,11 @@ class RpcConsole : public QWidget, public ConsoleViewInterface
   
   RpcConsole(QWidget* parent);
 
-  void WriteToConsole(const std::string& str) override;
+  void WriteToConsole(std::string_view str) override;
+  void EndBatch() override;
+
+  /* Keep at most capacity lines, older ones are dropped */
+  void SetCapacity(size_t capacity);
 
  private:
   
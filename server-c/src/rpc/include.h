@@ -8,5 +8,6 @@
 #include "protocol.h"
 #include "request.h"
 #include "response.h"
+#include "messages.h"
 
 #endif /* RPC_INCLUDE_H */
\ No newline at end of file
@@ -0,0 +1,312 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <messages.h> file declares the payload of every request as a schema. */
+
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../serdes.h"
+#include "../core/accounts.h"
+#include "protocol.h"
+#include "request.h"
+
+/* Message schemas
+ *
+ *   a message is a class of public fields, its schema the ordered list of those
+ *   fields (name, member, and for strings and lists the longest length accepted)
+ *   given by a specialization of message_fields. ser and des encode and decode a
+ *   message from its schema in either encoding of serdes.h, the longest encoding of
+ *   a message is known at compile time, and distbank-schemagen emits the client
+ *   codecs from the same schemas so that the layouts are written down once. */
+
+template<typename M, typename T>
+class Field
+{
+ public:
+  const char* name_;
+  T M::* member_;
+  /* longest string or list accepted, strings and lists only */
+  size_t max_len_;
+};
+
+template<typename M, typename T>
+constexpr Field<M, T> field(const char* name, T M::* member, size_t max_len = 0) {
+  return Field<M, T>{name, member, max_len};
+}
+
+/* schema of message M, a tuple of Field */
+template<typename M>
+inline constexpr auto message_fields = nullptr;
+
+template<typename M>
+concept Message = !std::is_same_v<std::remove_cv_t<decltype(message_fields<M>)>, std::nullptr_t>;
+
+template<typename T>
+constexpr bool is_list = false;
+
+template<typename T>
+constexpr bool is_list<std::vector<T>> = true;
+
+constexpr size_t varint_size(uint64_t v) {
+  size_t n = 1;
+  for (; v >= 0x80; v >>= 7) { ++n; }
+  return n;
+}
+
+constexpr size_t max_currency_name() {
+  size_t n = 0;
+  for (size_t c = 0; c < n_currencies; ++c) {
+    n = std::max(n, std::char_traits<char>::length(currency_name(static_cast<currency>(c))));
+  }
+  return n;
+}
+
+/* Longest encoding of a field of type T */
+template<typename T>
+constexpr size_t max_field_size(size_t max_len, bool compact) {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    return (compact ? varint_size(max_len) : sizeof(size_t)) + max_len;
+  } else if constexpr (is_list<T>) {
+    return (compact ? varint_size(max_len) : sizeof(size_t)) +
+      max_len * max_field_size<typename T::value_type>(0, compact);
+  } else if constexpr (std::is_same_v<T, currency>) {
+    return compact ? 1 : sizeof(size_t) + max_currency_name();
+  } else if constexpr (std::is_same_v<T, Money>) {
+    return max_field_size<int64_t>(0, compact);
+  } else if constexpr (std::is_integral_v<T>) {
+    return compact ? varint_size(std::numeric_limits<std::make_unsigned_t<T>>::max()) : sizeof(T);
+  } else {
+    static_assert(std::is_floating_point_v<T>, "unsupported field type");
+    return sizeof(T);
+  }
+}
+
+/* Longest payload of message M */
+template<Message M>
+constexpr size_t max_message_size(bool compact) {
+  return std::apply([&](const auto&... f) {
+    return (max_field_size<std::remove_cvref_t<decltype(std::declval<M&>().*f.member_)>>(f.max_len_, compact) + ...);
+  }, message_fields<M>);
+}
+
+template<typename M, typename T>
+inline void deserialize_field(Reader& in, M& m, const Field<M, T>& f) {
+  deserialize(in, m.*f.member_);
+  if constexpr (std::is_same_v<T, std::string_view> || is_list<T>) {
+    if ((m.*f.member_).size() > f.max_len_) {
+      throw std::runtime_error(std::string("invalid serialized data: ") + f.name_ + " too long");
+    }
+  }
+}
+
+template<Message M>
+inline size_t deserialize(Reader& in, M& m) {
+  size_t start = in.Pos();
+  std::apply([&](const auto&... f) { (deserialize_field(in, m, f), ...); }, message_fields<M>);
+  return in.Pos() - start;
+}
+
+template<Message M>
+inline size_t serialize(Writer& out, const M& m) {
+  size_t start = out.Pos();
+  std::apply([&](const auto&... f) { (serialize(out, m.*f.member_), ...); }, message_fields<M>);
+  return out.Pos() - start;
+}
+
+/* Decode the payload of request as message M, throws std::runtime_error if malformed */
+template<Message M>
+inline M decode(const Request& request) {
+  M m{};
+  Reader in = request.GetReader();
+  deserialize(in, m);
+  return m;
+}
+
+/* Requests, in the order of their fields on the wire, amounts in minor units of the
+ *   currency of the request (cents, yen) */
+
+class OpenRequest
+{
+ public:
+  static constexpr op_code code = op_code::open;
+  std::string_view user_name_;
+  std::string_view password_;
+  Money balance_;
+  currency currency_;
+};
+
+template<>
+inline constexpr auto message_fields<OpenRequest> = std::make_tuple(
+  field("user_name", &OpenRequest::user_name_, account_text_max),
+  field("password", &OpenRequest::password_, account_text_max),
+  field("balance", &OpenRequest::balance_),
+  field("currency", &OpenRequest::currency_));
+
+class CloseRequest
+{
+ public:
+  static constexpr op_code code = op_code::close;
+  int id_;
+  std::string_view user_name_;
+  std::string_view password_;
+};
+
+template<>
+inline constexpr auto message_fields<CloseRequest> = std::make_tuple(
+  field("id", &CloseRequest::id_),
+  field("user_name", &CloseRequest::user_name_, account_text_max),
+  field("password", &CloseRequest::password_, account_text_max));
+
+class CheckBalanceRequest
+{
+ public:
+  static constexpr op_code code = op_code::check_balance;
+  int id_;
+  std::string_view user_name_;
+  std::string_view password_;
+  currency currency_;
+};
+
+template<>
+inline constexpr auto message_fields<CheckBalanceRequest> = std::make_tuple(
+  field("id", &CheckBalanceRequest::id_),
+  field("user_name", &CheckBalanceRequest::user_name_, account_text_max),
+  field("password", &CheckBalanceRequest::password_, account_text_max),
+  field("currency", &CheckBalanceRequest::currency_));
+
+/* deposit and withdraw share a layout */
+class DepositRequest
+{
+ public:
+  static constexpr op_code code = op_code::deposit;
+  int id_;
+  std::string_view user_name_;
+  std::string_view password_;
+  currency currency_;
+  Money amount_;
+};
+
+template<>
+inline constexpr auto message_fields<DepositRequest> = std::make_tuple(
+  field("id", &DepositRequest::id_),
+  field("user_name", &DepositRequest::user_name_, account_text_max),
+  field("password", &DepositRequest::password_, account_text_max),
+  field("currency", &DepositRequest::currency_),
+  field("amount", &DepositRequest::amount_));
+
+class WithdrawRequest
+{
+ public:
+  static constexpr op_code code = op_code::withdraw;
+  int id_;
+  std::string_view user_name_;
+  std::string_view password_;
+  currency currency_;
+  Money amount_;
+};
+
+template<>
+inline constexpr auto message_fields<WithdrawRequest> = std::make_tuple(
+  field("id", &WithdrawRequest::id_),
+  field("user_name", &WithdrawRequest::user_name_, account_text_max),
+  field("password", &WithdrawRequest::password_, account_text_max),
+  field("currency", &WithdrawRequest::currency_),
+  field("amount", &WithdrawRequest::amount_));
+
+class TransferRequest
+{
+ public:
+  static constexpr op_code code = op_code::transfer;
+  int sender_id_;
+  std::string_view user_name_;
+  std::string_view password_;
+  currency currency_;
+  Money amount_;
+  int receiver_id_;
+};
+
+template<>
+inline constexpr auto message_fields<TransferRequest> = std::make_tuple(
+  field("sender_id", &TransferRequest::sender_id_),
+  field("user_name", &TransferRequest::user_name_, account_text_max),
+  field("password", &TransferRequest::password_, account_text_max),
+  field("currency", &TransferRequest::currency_),
+  field("amount", &TransferRequest::amount_),
+  field("receiver_id", &TransferRequest::receiver_id_));
+
+class ExchangeRequest
+{
+ public:
+  static constexpr op_code code = op_code::exchange;
+  int id_;
+  std::string_view user_name_;
+  std::string_view password_;
+  currency from_currency_;
+  currency to_currency_;
+  Money amount_;
+};
+
+template<>
+inline constexpr auto message_fields<ExchangeRequest> = std::make_tuple(
+  field("id", &ExchangeRequest::id_),
+  field("user_name", &ExchangeRequest::user_name_, account_text_max),
+  field("password", &ExchangeRequest::password_, account_text_max),
+  field("from_currency", &ExchangeRequest::from_currency_),
+  field("to_currency", &ExchangeRequest::to_currency_),
+  field("amount", &ExchangeRequest::amount_));
+
+/* most account ranges of a monitor window, and most accounts they may cover */
+constexpr size_t monitor_max_ranges = 66;
+constexpr size_t monitor_max_accounts = 4096;
+
+/* duration of the monitor window in ms and the callbacks it receives: those of the
+ *   accounts in ranges, triples of a first id, a last id and the step between two ids
+ *   (every account if none), e.g. the accounts a client opened on one shard form a
+ *   single range stepped by the number of shards, of the ops whose bit 1 << op code is set
+ *   in ops (every op if 0) and moving at least min_amount. with an interval in ms the
+ *   window receives, at most once per interval, the new balances of the accounts
+ *   changed meanwhile packed as deltas, instead of a text per change. multicast set
+ *   asks for the multicast group publishing every text instead of a window */
+class MonitorRequest
+{
+ public:
+  static constexpr op_code code = op_code::monitor;
+  int64_t duration_;
+  std::vector<int> ranges_;
+  int ops_;
+  float min_amount_;
+  int interval_;
+  int multicast_;
+};
+
+template<>
+inline constexpr auto message_fields<MonitorRequest> = std::make_tuple(
+  field("duration", &MonitorRequest::duration_),
+  field("ranges", &MonitorRequest::ranges_, 3 * monitor_max_ranges),
+  field("ops", &MonitorRequest::ops_),
+  field("min_amount", &MonitorRequest::min_amount_),
+  field("interval", &MonitorRequest::interval_),
+  field("multicast", &MonitorRequest::multicast_));
+
+/* every request, for code generation */
+using request_messages = std::tuple<OpenRequest, CloseRequest, CheckBalanceRequest, DepositRequest,
+                                    WithdrawRequest, TransferRequest, ExchangeRequest, MonitorRequest>;
+
+/* a request always fits a v2 frame, and a v3 one whose header is never longer */
+static_assert([]<size_t... I>(std::index_sequence<I...>) {
+  return ((max_message_size<std::tuple_element_t<I, request_messages>>(false) <= v2_max_payload &&
+           max_message_size<std::tuple_element_t<I, request_messages>>(true) <= v2_max_payload) && ...);
+}(std::make_index_sequence<std::tuple_size_v<request_messages>>{}));
+
+#endif /* MESSAGES_H */
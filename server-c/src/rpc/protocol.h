@@ -5,12 +5,58 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <optional>
 
 /* udp payload size */
 constexpr int payload_size = 1200;
 
+/* rpc wire format version
+ *
+ *   v1: int id, int code, payload zero padded to payload_size bytes,
+ *     recognised by its length since every v1 datagram is a full frame
+ *   v2: version byte, int id, int code, uint16 payload length, payload,
+ *     only the serialized bytes are sent
+ *   v3: as v2 in the compact encoding of serdes.h, the header being the version
+ *     byte, a varint id, a one byte code and a varint payload length, and the
+ *     payload fields varints, one byte enums and varint prefixed strings
+ *
+ *   a server answers in the version of the request */
+enum class wire_version : uint8_t {
+  v1 = 1, v2 = 2, v3 = 3
+};
+
+constexpr size_t v1_frame_size = 2 * sizeof(int) + payload_size;
+constexpr size_t v2_header_size = 1 + 2 * sizeof(int) + sizeof(uint16_t);
+/* a v2 frame is always shorter than a v1 frame, the one length v1 frames take */
+constexpr size_t v2_max_payload = v1_frame_size - v2_header_size - 1;
+/* shortest v3 header, every field taking a single byte */
+constexpr size_t v3_min_header_size = 4;
+
+/* zero bytes kept after a decoded payload, a handler decoding a truncated payload
+ *   reads zeros as it would from the zero padded v1 payload */
+constexpr size_t payload_slack = 64;
+
+/* Wire version of a datagram of len bytes
+ *
+ *   a v1 frame is always v1_frame_size bytes, as every v1 client pads it, and a shorter
+ *   datagram is v2 or v3 by its first byte. a short datagram without either marker is
+ *   reported as v1 and rejected by the decoders, so a v1 frame cut short can never be
+ *   taken for a v2 or v3 frame whose id happens to start with 2 or 3 */
+inline wire_version detect_wire_version(const char* in, size_t len) {
+  if (len < v1_frame_size && len >= v2_header_size &&
+      static_cast<uint8_t>(in[0]) == static_cast<uint8_t>(wire_version::v2)) {
+    return wire_version::v2;
+  }
+  if (len < v1_frame_size && len >= v3_min_header_size &&
+      static_cast<uint8_t>(in[0]) == static_cast<uint8_t>(wire_version::v3)) {
+    return wire_version::v3;
+  }
+  return wire_version::v1;
+}
+
 /* rpc operation code */
 enum class op_code {
   open = 1, close, check_balance, deposit, withdraw, transfer, exchange, monitor
@@ -30,7 +76,7 @@ inline std::optional<op_code> int_to_op_code(int i) {
   }
 }
 
-inline int op_code_to_int(op_code c) {
+constexpr int op_code_to_int(op_code c) {
   switch (c) {
     case op_code::open: return 1;
     case op_code::close: return 2;
@@ -7,7 +7,9 @@
 
 #include <cstdint>
 #include <cstddef>
-#include <array>
+#include <algorithm>
+#include <string>
+#include <string_view>
 
 #include "../serdes.h"
 #include "protocol.h"
@@ -16,19 +18,55 @@ class Request
 {
  public:
 
-  constexpr Request() = default;
-  constexpr Request(int id, op_code op, uint8_t* in)
-      : id_(id), op_code_(op), payload_{} {
-    memcpy(payload_.data(), in, payload_size - 1);
-    payload_[payload_size - 1] = '\0';
+  Request() = default;
+  Request(int id, op_code op, const char* in, size_t len, wire_version version = wire_version::v1)
+      : id_(id), op_code_(op), payload_{}, version_(version) {
+    SetPayload(in, len);
   }
 
-  inline size_t Serialize(char* out) {
-    return ser(out, id_, op_code_, payload_);
+  /* Serialize the request in its wire version, returns the number of bytes written */
+  inline size_t Serialize(char* out) const {
+    size_t len = Size();
+    if (version_ == wire_version::v1) {
+      size_t i = ser(out, id_, op_code_);
+      std::memcpy(out + i, payload_.data(), len);
+      std::memset(out + i + len, 0, payload_size - len);
+      return v1_frame_size;
+    }
+    Writer writer(out, version_ == wire_version::v3);
+    *writer.Put(1) = static_cast<char>(version_);
+    ser(writer, id_, op_code_, static_cast<uint16_t>(len));
+    std::memcpy(writer.Put(len), payload_.data(), len);
+    return writer.Pos();
   }
 
-  inline size_t Deserialize(const char* in) {
-    return des(in, id_, op_code_, payload_);
+  /* Deserialize a datagram of len bytes in either wire version, the version is kept
+   *   so that the response goes out in the same one. throws std::runtime_error if it
+   *   is malformed, a v1 frame shorter than v1_frame_size included */
+  inline size_t Deserialize(const char* in, size_t len) {
+    version_ = detect_wire_version(in, len);
+    Reader reader(in, len, version_ == wire_version::v3);
+    if (version_ == wire_version::v1) {
+      // a short frame carries no marker to tell it from v2 or v3, it is not accepted
+      if (len < v1_frame_size) {
+        throw std::runtime_error("invalid frame: " + std::to_string(len) + " bytes, v1 frames take " +
+          std::to_string(v1_frame_size));
+      }
+      size_t i = des(reader, id_, op_code_);
+      size_t frame = std::min(len - i, static_cast<size_t>(payload_size));
+      size_t n = frame;
+      // the zero padding of a v1 payload is not kept
+      while (n > 0 && in[i + n - 1] == '\0') { n--; }
+      SetPayload(in + i, n);
+      // the padding can still be read, as zeros
+      readable_ = std::min(frame, payload_.size());
+      return len;
+    }
+    uint16_t n;
+    reader.Take(1);
+    des(reader, id_, op_code_, n);
+    SetPayload(reader.Take(n), n);
+    return reader.Pos();
   }
 
   inline int GetId() const { return id_; } 
@@ -37,15 +75,34 @@ class Request
 
   inline const char* GetPayload() const { return payload_.data(); }
 
+  /* Reader over the payload as received, in the encoding of its wire version */
+  inline Reader GetReader() const { return Reader(payload_.data(), readable_, version_ == wire_version::v3); }
+
+  /* number of meaningful payload bytes */
+  inline size_t Size() const { return payload_.size() - payload_slack; }
+
+  inline wire_version GetVersion() const { return version_; }
+
  private:
 
   /* the request id */
   int id_;
   /* the operation code sepecified in the request */
   op_code op_code_;
-  /* the data needed */
-  std::array<char, payload_size> payload_;
+  /* the data needed, followed by payload_slack zero bytes */
+  std::string payload_;
+  /* bytes of payload_ that came with the datagram */
+  size_t readable_ = 0;
+  /* wire version the request arrived in */
+  wire_version version_;
+
+  inline void SetPayload(const char* in, size_t len) {
+    len = std::min(len, version_ == wire_version::v1 ? static_cast<size_t>(payload_size) : v2_max_payload);
+    payload_.assign(in, len);
+    payload_.append(payload_slack, '\0');
+    readable_ = len;
+  }
 
 };
 
-#endif /* REQUEST_H */
\ No newline at end of file
+#endif /* REQUEST_H */
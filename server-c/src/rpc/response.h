@@ -6,7 +6,8 @@
 #define RESPONSE_H
 
 #include <string>
-#include <array>
+#include <string_view>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
@@ -18,19 +19,47 @@ class Response
  public:
 
   Response() = default;
-  constexpr Response(status_code status_code, std::string str)
-      : status_code_(status_code), payload_{} {
-    size_t len = str.size();
-    memcpy(payload_.data(), str.data(), len);
-    payload_[len] = '\0';
+  Response(status_code status_code, std::string str)
+      : status_code_(status_code), payload_(std::move(str)) {}
+
+  /* Serialize the response in its wire version, returns the number of bytes written
+   *
+   *   v1 keeps the full frame with a null terminated, zero padded message,
+   *   v2 and v3 write the message bytes only */
+  inline size_t Serialize(char* out) const {
+    if (version_ == wire_version::v1) {
+      size_t len = std::min(payload_.size(), static_cast<size_t>(payload_size - 1));
+      size_t i = ser(out, id_, status_code_);
+      std::memcpy(out + i, payload_.data(), len);
+      std::memset(out + i + len, 0, payload_size - len);
+      return v1_frame_size;
+    }
+    size_t len = std::min(payload_.size(), v2_max_payload);
+    Writer writer(out, version_ == wire_version::v3);
+    *writer.Put(1) = static_cast<char>(version_);
+    ser(writer, id_, status_code_, static_cast<uint16_t>(len));
+    std::memcpy(writer.Put(len), payload_.data(), len);
+    return writer.Pos();
   }
 
-  inline size_t Serialize(char* out) {
-    return ser(out, id_, status_code_, payload_);
-  }
-
-  inline size_t Deserialize(const char* in) {
-    return des(in, id_, status_code_, payload_);
+  inline size_t Deserialize(const char* in, size_t len) {
+    version_ = detect_wire_version(in, len);
+    Reader reader(in, len, version_ == wire_version::v3);
+    if (version_ == wire_version::v1) {
+      if (len < v1_frame_size) {
+        throw std::runtime_error("invalid frame: " + std::to_string(len) + " bytes, v1 frames take " +
+          std::to_string(v1_frame_size));
+      }
+      size_t i = des(reader, id_, status_code_);
+      const char* msg = in + i;
+      payload_.assign(msg, strnlen(msg, std::min(len - i, static_cast<size_t>(payload_size))));
+      return len;
+    }
+    uint16_t n;
+    reader.Take(1);
+    des(reader, id_, status_code_, n);
+    payload_.assign(reader.Take(n), n);
+    return reader.Pos();
   }
 
   inline int GetId() const { return id_; }
@@ -39,22 +68,22 @@ class Response
   inline status_code GetStatusCode() const { return status_code_; }
   inline void SetStatusCode(status_code c) { status_code_ = c; }
 
-  inline char* GetPayload() { return payload_.data(); }
-  inline void SetPayload(const std::string& data) { 
-    if (data.size() > payload_size) {}
-    size_t len = data.size();
-    std::memcpy(payload_.data(), data.data(), len);
-    payload_[len] = '\0';
-  }
+  inline const std::string& GetPayload() const { return payload_; }
+  inline void SetPayload(std::string_view data) { payload_.assign(data); }
+
+  inline wire_version GetVersion() const { return version_; }
+  inline void SetVersion(wire_version v) { version_ = v; }
 
  private: 
 
   int id_;
   status_code status_code_;
-  std::array<char, payload_size> payload_;
+  std::string payload_;
+  /* wire version of the request this response answers */
+  wire_version version_ = wire_version::v1;
 
 };
 
 
 
-#endif /* RESPONSE_H */
\ No newline at end of file
+#endif /* RESPONSE_H */
@@ -4,15 +4,22 @@
 #define SERDES_H
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
 #include <cstring>
 #include <memory>
 #include <array>
 #include <unordered_map>
+#include <span>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <stdexcept>
+#include <vector>
 
 #include "core/currency.h"
+#include "core/money.h"
 #include "rpc/protocol.h"
 
 /* Impl for arithmetic types */
@@ -109,6 +116,16 @@ inline size_t deserialize(const char* in, currency& c) {
   return i;
 }
 
+/* Impl for money, its minor units */
+
+inline size_t serialize(char* out, const Money& m) {
+  return serialize(out, m.units_);
+}
+
+inline size_t deserialize(const char* in, Money& m) {
+  return deserialize(in, m.units_);
+}
+
 /* Impl for std::array */
 
 template<typename T, size_t N>
@@ -158,6 +175,306 @@ inline size_t deserialize(const char* in, std::unordered_map<K, V>& map) {
   return i;
 }
 
+/* Bounds checked decoding
+ *
+ *   a Reader walks a received buffer of known length, every field is checked to lie
+ *   within it before it is read, and strings are decoded as views into the buffer,
+ *   so decoding a request allocates nothing and never reads past its datagram. the
+ *   views are valid as long as the buffer
+ *
+ *   Readers and Writers also speak the compact encoding of wire v3: integers are
+ *   varints (7 bits a byte, low bits first, signed ones zigzag mapped so that small
+ *   negatives stay short), string lengths unsigned varints, op codes, status codes and
+ *   currencies a single byte. floats keep their 4 bytes, money is an integer */
+
+class Reader
+{
+ public:
+
+  Reader(const char* data, size_t len, bool compact = false)
+      : data_(data), len_(len), pos_(0), compact_(compact) {}
+  explicit Reader(std::string_view buf, bool compact = false) : Reader(buf.data(), buf.size(), compact) {}
+
+  /* The next n bytes, throws std::runtime_error if fewer are left */
+  inline const char* Take(size_t n) {
+    if (n > len_ - pos_) {
+      throw std::runtime_error("invalid serialized data: truncated");
+    }
+    const char* p = data_ + pos_;
+    pos_ += n;
+    return p;
+  }
+
+  /* An unsigned varint of at most 10 bytes */
+  inline uint64_t Varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = static_cast<uint8_t>(*Take(1));
+      v |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) { return v; }
+    }
+    throw std::runtime_error("invalid serialized data: varint");
+  }
+
+  /* bytes read so far */
+  inline size_t Pos() const { return pos_; }
+
+  /* bytes left to read */
+  inline size_t Left() const { return len_ - pos_; }
+
+  inline bool Compact() const { return compact_; }
+
+ private:
+
+  const char* data_;
+
+  size_t len_;
+
+  size_t pos_;
+
+  bool compact_;
+
+};
+
+class Writer
+{
+ public:
+
+  explicit Writer(char* out, bool compact = false) : out_(out), pos_(0), compact_(compact) {}
+
+  /* Room for the next n bytes, the caller makes sure the buffer is large enough */
+  inline char* Put(size_t n) {
+    char* p = out_ + pos_;
+    pos_ += n;
+    return p;
+  }
+
+  inline void Varint(uint64_t v) {
+    while (v >= 0x80) {
+      *Put(1) = static_cast<char>(v | 0x80);
+      v >>= 7;
+    }
+    *Put(1) = static_cast<char>(v);
+  }
+
+  /* bytes written so far */
+  inline size_t Pos() const { return pos_; }
+
+  inline bool Compact() const { return compact_; }
+
+ private:
+
+  char* out_;
+
+  size_t pos_;
+
+  bool compact_;
+
+};
+
+inline uint64_t zigzag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type
+deserialize(Reader& in, T& obj) {
+  size_t start = in.Pos();
+  if constexpr (std::is_integral<T>::value) {
+    if (in.Compact()) {
+      // a value out of the range of T is malformed, not truncated silently
+      if constexpr (std::is_signed<T>::value) {
+        int64_t v = unzigzag(in.Varint());
+        if (v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max()) {
+          throw std::runtime_error("invalid serialized data: integer out of range");
+        }
+        obj = static_cast<T>(v);
+      } else {
+        uint64_t v = in.Varint();
+        if (v > std::numeric_limits<T>::max()) {
+          throw std::runtime_error("invalid serialized data: integer out of range");
+        }
+        obj = static_cast<T>(v);
+      }
+      return in.Pos() - start;
+    }
+  }
+  return deserialize(in.Take(sizeof(obj)), obj);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type
+serialize(Writer& out, const T& obj) {
+  if constexpr (std::is_integral<T>::value) {
+    if (out.Compact()) {
+      size_t start = out.Pos();
+      if constexpr (std::is_signed<T>::value) {
+        out.Varint(zigzag(obj));
+      } else {
+        out.Varint(obj);
+      }
+      return out.Pos() - start;
+    }
+  }
+  return serialize(out.Put(sizeof(obj)), obj);
+}
+
+inline size_t deserialize(Reader& in, std::string_view& str) {
+  size_t start = in.Pos();
+  size_t s;
+  deserialize(in, s); // size tag of the str
+  str = std::string_view(in.Take(s), s);
+  return in.Pos() - start;
+}
+
+inline size_t serialize(Writer& out, std::string_view str) {
+  size_t start = out.Pos();
+  serialize(out, str.size());
+  std::memcpy(out.Put(str.size()), str.data(), str.size());
+  return out.Pos() - start;
+}
+
+inline size_t deserialize(Reader& in, std::span<const char>& bytes) {
+  std::string_view view;
+  size_t i = deserialize(in, view);
+  bytes = std::span<const char>(view.data(), view.size());
+  return i;
+}
+
+inline size_t deserialize(Reader& in, std::string& str) {
+  std::string_view view;
+  size_t i = deserialize(in, view);
+  str.assign(view);
+  return i;
+}
+
+/* A list is its element count then the elements */
+template<typename T>
+inline size_t deserialize(Reader& in, std::vector<T>& list) {
+  size_t start = in.Pos();
+  size_t n;
+  deserialize(in, n);
+  // every element takes a byte at least, a count past the data is malformed and
+  // must not size the allocation
+  if (n > in.Left()) {
+    throw std::runtime_error("invalid serialized data: truncated");
+  }
+  list.resize(n);
+  for (T& elem : list) { deserialize(in, elem); }
+  return in.Pos() - start;
+}
+
+template<typename T>
+inline size_t serialize(Writer& out, const std::vector<T>& list) {
+  size_t start = out.Pos();
+  serialize(out, list.size());
+  for (const T& elem : list) { serialize(out, elem); }
+  return out.Pos() - start;
+}
+
+/* An array is its elements, its size is known to both sides */
+template<typename T, size_t N>
+inline size_t deserialize(Reader& in, std::array<T, N>& arr) {
+  size_t start = in.Pos();
+  for (T& elem : arr) { deserialize(in, elem); }
+  return in.Pos() - start;
+}
+
+/* Compact enums are one byte holding the value of the enumerator */
+
+inline int deserialize_enum(Reader& in) {
+  if (in.Compact()) {
+    return static_cast<uint8_t>(*in.Take(1));
+  }
+  int v;
+  deserialize(in.Take(sizeof(v)), v);
+  return v;
+}
+
+inline void serialize_enum(Writer& out, int v) {
+  if (out.Compact()) {
+    *out.Put(1) = static_cast<char>(v);
+    return;
+  }
+  serialize(out.Put(sizeof(v)), v);
+}
+
+inline size_t deserialize(Reader& in, op_code& c) {
+  size_t start = in.Pos();
+  std::optional<op_code> r = int_to_op_code(deserialize_enum(in));
+  if (!r) {
+    throw std::runtime_error("invalid serialized data: operation code");
+  }
+  c = *r;
+  return in.Pos() - start;
+}
+
+inline size_t serialize(Writer& out, const op_code& c) {
+  size_t start = out.Pos();
+  serialize_enum(out, static_cast<int>(c));
+  return out.Pos() - start;
+}
+
+inline size_t deserialize(Reader& in, status_code& c) {
+  size_t start = in.Pos();
+  std::optional<status_code> r = int_to_status_code(deserialize_enum(in));
+  if (!r) {
+    throw std::runtime_error("invalid serialized data: status code");
+  }
+  c = *r;
+  return in.Pos() - start;
+}
+
+inline size_t serialize(Writer& out, const status_code& c) {
+  size_t start = out.Pos();
+  serialize_enum(out, static_cast<int>(c));
+  return out.Pos() - start;
+}
+
+/* a currency is its name (e.g. "USD") in the fixed encoding, its index when compact */
+inline size_t deserialize(Reader& in, currency& c) {
+  size_t start = in.Pos();
+  if (in.Compact()) {
+    uint8_t v = static_cast<uint8_t>(*in.Take(1));
+    if (v >= n_currencies) {
+      throw std::runtime_error("invalid serialized data: currency");
+    }
+    c = static_cast<currency>(v);
+    return in.Pos() - start;
+  }
+  std::string_view str;
+  deserialize(in, str);
+  std::optional<currency> r = str_to_currency(str);
+  if (!r) {
+    throw std::runtime_error("invalid serialized data: currency");
+  }
+  c = *r;
+  return in.Pos() - start;
+}
+
+inline size_t serialize(Writer& out, const currency& c) {
+  size_t start = out.Pos();
+  if (out.Compact()) {
+    *out.Put(1) = static_cast<char>(c);
+  } else {
+    serialize(out, std::string_view(currency_name(c)));
+  }
+  return out.Pos() - start;
+}
+
+/* money is an int64 of minor units, a zigzag varint when compact */
+inline size_t deserialize(Reader& in, Money& m) {
+  return deserialize(in, m.units_);
+}
+
+inline size_t serialize(Writer& out, const Money& m) {
+  return serialize(out, m.units_);
+}
+
 /* Variadic helper */
 
 template<typename T>
@@ -186,4 +503,20 @@ inline size_t des(const char* in, T&& first, Types&&... types) {
   return i;
 }
 
+/* Decode fields in order from in, returns the number of bytes read */
+template<typename... Types>
+inline size_t des(Reader& in, Types&... types) {
+  size_t start = in.Pos();
+  (deserialize(in, types), ...);
+  return in.Pos() - start;
+}
+
+/* Encode fields in order to out, returns the number of bytes written */
+template<typename... Types>
+inline size_t ser(Writer& out, const Types&... types) {
+  size_t start = out.Pos();
+  (serialize(out, types), ...);
+  return out.Pos() - start;
+}
+
 #endif /* SERDES_H */
\ No newline at end of file
@@ -1,10 +1,19 @@
 #ifndef CALLBACK_H
 #define CALLBACK_H
 
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 #include <netinet/in.h>
 
+#include "../core/accounts.h"
+#include "../rpc/protocol.h"
+#include "../serdes.h"
+
 class CallbackData
 {
  public:
@@ -16,12 +25,6 @@ class CallbackData
 
   ~CallbackData() {}
 
-  bool IsActive() {
-    auto now = std::chrono::steady_clock::now();
-    if (now < start_ + dur_) { return true; }
-    return false;
-  }
-
   const sockaddr_in& GetClientAddr() const { return client_addr_; }
 
   socklen_t GetClientAddrLen() const { return client_addr_len_; }
@@ -40,4 +43,85 @@ class CallbackData
 
 };
 
+/* What a callback is about, matched against the filter of every monitor window */
+class CallbackTopic
+{
+ public:
+  op_code op_;
+  /* account the op ran on, and the receiver of a transfer, -1 if none */
+  int account_;
+  int peer_;
+  /* amount moved and its currency, 0 if none */
+  currency cur_;
+  Money amount_;
+};
+
+/* The callbacks a monitor window receives, see MonitorRequest */
+class MonitorFilter
+{
+ public:
+  /* every account if empty */
+  std::vector<int> accounts_;
+  /* bit 1 << op code set for each op wanted, every op if 0 */
+  uint32_t ops_ = 0;
+  /* least amount moved, in each currency */
+  std::array<Money, n_currencies> min_amount_{};
+
+  MonitorFilter() = default;
+
+  /* min_amount in units of any currency, e.g. 2.5 is 250 cents or 3 yen */
+  MonitorFilter(std::vector<int> accounts, uint32_t ops, double min_amount)
+      : accounts_(std::move(accounts)), ops_(ops) {
+    for (size_t c = 0; c < n_currencies; ++c) {
+      min_amount_[c] = Money::AtLeast(min_amount, static_cast<currency>(c));
+    }
+  }
+
+  /* Whether topic passes the op and amount filters, accounts are matched by the
+   *   index of the fan-out */
+  bool Accepts(const CallbackTopic& topic) const {
+    if (ops_ != 0 && !(ops_ & (1u << op_code_to_int(topic.op_)))) { return false; }
+    return topic.amount_ >= min_amount_[static_cast<size_t>(topic.cur_)];
+  }
+};
+
+/* The new balances of an account, sent to the monitor windows taking deltas
+ *
+ *   encoded as the zigzag varint id, a byte of the currencies held (bit c for
+ *   currency c, none once the account is closed) and the balance of each in minor
+ *   units as a zigzag varint, in the order of the currencies */
+class BalanceDelta
+{
+ public:
+  int id_;
+  uint8_t held_;
+  std::array<Money, n_currencies> balances_;
+
+  /* longest encoding */
+  static constexpr size_t max_size = 5 + 1 + n_currencies * 10;
+
+  static BalanceDelta Of(const Account& account) {
+    BalanceDelta d{account.GetId(), 0, {}};
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (!account.Holds(static_cast<currency>(c))) { continue; }
+      d.held_ |= static_cast<uint8_t>(1u << c);
+      d.balances_[c] = account.GetBalance(static_cast<currency>(c));
+    }
+    return d;
+  }
+
+  static BalanceDelta Closed(int id) { return BalanceDelta{id, 0, {}}; }
+
+  /* Write the encoding to out, returns its length */
+  size_t Encode(char* out) const {
+    Writer w(out, true);
+    serialize(w, id_);
+    *w.Put(1) = static_cast<char>(held_);
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (held_ & (1u << c)) { serialize(w, balances_[c]); }
+    }
+    return w.Pos();
+  }
+};
+
 #endif /* CALLBACK_H */
\ No newline at end of file
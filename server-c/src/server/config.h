@@ -0,0 +1,148 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <config.h> file defines the start up options of the server. */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/* how the listening loop talks to the socket
+ *
+ *   socket: blocking recvfrom / recvmmsg and sendto / sendmmsg
+ *   uring:  completion driven io_uring loop with multishot recvmsg into provided
+ *     buffers (linux only, falls back to socket if the kernel lacks support) */
+enum class transport {
+  socket = 1, uring = 2
+};
+
+class ServerConfig
+{
+ public:
+
+  /* udp port the server listens on */
+  int port = 8080;
+
+  /* max number of datagrams received by one recvmmsg and posted by one sendmmsg,
+   *   1 keeps the plain recvfrom / sendto loop */
+  size_t batch_size = 1;
+
+  /* number of listener threads, each bound to the port with SO_REUSEPORT, 
+   *   pinned to its own core and owning the account ids congruent to its index */
+  int shards = 1;
+
+  /* transport backend of the listening loop */
+  transport backend = transport::socket;
+
+  /* max number of rpcs (and console lines) kept by the gui, older ones are dropped */
+  size_t rpc_log_capacity = 10000;
+
+  /* record only one rpc in rpc_log_sample in the gui log, chosen by client address
+   *   and rpc id so that a request and its response are kept or dropped together */
+  int rpc_log_sample = 1;
+
+  /* directory of the per shard write-ahead logs, empty to keep accounts in memory
+   *   only. the logs are replayed on start, so the number of shards must not change
+   *   between runs */
+  std::string wal_dir;
+
+  /* seconds between two snapshots of every shard into the log directory, 0 to only
+   *   take one on stop. a snapshot lets the next start map the accounts instead of
+   *   replaying the whole log */
+  int snapshot_interval = 60;
+
+  /* bytes of replies a shard keeps for at most once semantics, the least recently
+   *   used are dropped beyond it, and seconds a reply is kept after the last retry */
+  size_t dedup_memory = size_t(64) << 20;
+  int dedup_ttl = 600;
+
+  /* multicast group (e.g. 239.255.0.1) and port to which every monitor callback is
+   *   also published once, with a sequence number, empty to disable. a monitor
+   *   request asking for multicast is answered with the group to join */
+  std::string multicast_group;
+  int multicast_port = 8090;
+
+  /* address of the interface multicast is sent from, e.g. 127.0.0.1 to stay on
+   *   loopback, empty for the one of the default route, and the hops it may cross */
+  std::string multicast_interface;
+  int multicast_ttl = 1;
+
+  /* file of exchange rates (see RateTable::Load) read on start and again whenever
+   *   it changes, checked every rates_poll seconds, empty to keep the built in rates */
+  std::string rates_file;
+  int rates_poll = 1;
+
+};
+
+/* Parse server options from command line arguments, unknown arguments are ignored
+ *   so that toolkit specific arguments (e.g. qt) can be passed along
+ *
+ *   --port <n>         udp port
+ *   --batch-size <n>   datagrams per recvmmsg / sendmmsg
+ *   --shards <n>       listener threads partitioning the accounts
+ *   --transport <t>    socket or uring
+ *   --rpc-log <n>      rpcs kept by the gui log
+ *   --rpc-sample <n>   log one rpc in n
+ *   --wal <dir>        write-ahead log directory
+ *   --snapshot-interval <s>  seconds between snapshots
+ *   --dedup-mb <n>     mb of replies kept per shard for at most once
+ *   --dedup-ttl <s>    seconds a reply is kept
+ *   --multicast <addr> multicast group of the monitor callbacks
+ *   --multicast-port <n>     port of the multicast group
+ *   --multicast-if <addr>    interface multicast is sent from
+ *   --multicast-ttl <n>      hops of multicast datagrams
+ *   --rates <file>     exchange rates file, reloaded when it changes
+ *   --rates-poll <s>   seconds between two checks of the rates file */
+inline ServerConfig ParseServerConfig(int argc, char* argv[]) {
+  ServerConfig config{};
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--port") == 0) {
+      config.port = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--batch-size") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.batch_size = n > 0 ? static_cast<size_t>(n) : 1;
+    } else if (std::strcmp(argv[i], "--shards") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.shards = n > 0 ? n : 1;
+    } else if (std::strcmp(argv[i], "--transport") == 0) {
+      config.backend = std::strcmp(argv[++i], "uring") == 0 ? transport::uring : transport::socket;
+    } else if (std::strcmp(argv[i], "--rpc-log") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.rpc_log_capacity = n > 0 ? static_cast<size_t>(n) : 1;
+    } else if (std::strcmp(argv[i], "--rpc-sample") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.rpc_log_sample = n > 0 ? n : 1;
+    } else if (std::strcmp(argv[i], "--wal") == 0) {
+      config.wal_dir = argv[++i];
+    } else if (std::strcmp(argv[i], "--snapshot-interval") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.snapshot_interval = n > 0 ? n : 0;
+    } else if (std::strcmp(argv[i], "--dedup-mb") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.dedup_memory = static_cast<size_t>(n > 0 ? n : 1) << 20;
+    } else if (std::strcmp(argv[i], "--dedup-ttl") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.dedup_ttl = n > 0 ? n : 1;
+    } else if (std::strcmp(argv[i], "--multicast") == 0) {
+      config.multicast_group = argv[++i];
+    } else if (std::strcmp(argv[i], "--multicast-port") == 0) {
+      config.multicast_port = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--multicast-if") == 0) {
+      config.multicast_interface = argv[++i];
+    } else if (std::strcmp(argv[i], "--multicast-ttl") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.multicast_ttl = n > 0 ? n : 1;
+    } else if (std::strcmp(argv[i], "--rates") == 0) {
+      config.rates_file = argv[++i];
+    } else if (std::strcmp(argv[i], "--rates-poll") == 0) {
+      int n = std::atoi(argv[++i]);
+      config.rates_poll = n > 0 ? n : 1;
+    }
+  }
+  return config;
+}
+
+#endif /* CONFIG_H */
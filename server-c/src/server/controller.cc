@@ -1,21 +1,10 @@
 #include "controller.h"
 
-#include <iostream>
 #include <utility>
 #include <chrono>
 
 #include "../core/accounts.h"
 
-static constexpr std::string GetCurrentTimeStamp() {
-  auto now = std::chrono::system_clock::now();
-  std::time_t now_t = std::chrono::system_clock::to_time_t(now);
-  std::string time_str = std::ctime(&now_t);
-  if (!time_str.empty() && time_str.back() == '\n') {
-    time_str.pop_back();
-  }
-  return time_str;
-}
-
 /* Binders */
 
 void Controller::BindHeaderViewModel(HeaderViewInterface* view) {
@@ -23,19 +12,19 @@ void Controller::BindHeaderViewModel(HeaderViewInterface* view) {
 }
 
 void Controller::BindRpcViewModel(RpcViewInterface* view) {
-  rpc_view_ = view;
+  rpc_view_.store(view, std::memory_order_release);
 }
 
 void Controller::BindConsoleViewModel(ConsoleViewInterface* view) {
-  console_view_ = view;
+  console_view_.store(view, std::memory_order_release);
 }
 
 void Controller::BindAccountViewModel(AccountViewInterface* view) {
-  account_view_ = view;
+  account_view_.store(view, std::memory_order_release);
 }
 
 void Controller::BindCallbackViewModel(CallbackViewInterface* view) {
-  callback_view_ = view;
+  callback_view_.store(view, std::memory_order_release);
 }
 
 void Controller::BindChangeModeCallback(std::function<void(mode)> cb) {
@@ -56,58 +45,195 @@ void Controller::ChangeLostRate(int r) {
   change_lost_rate_cb(r);
 }
 
+/* Event bus */
+
+void Controller::Publish(const Event& e) {
+  if (!events_.TryPush(e)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Controller::PublishBalance(const Account& account) {
+  if (!account_view_.load(std::memory_order_acquire)) { return; }
+  Event e = Event::Make(Event::kind::balance);
+  e.SetAccount(account);
+  Publish(e);
+}
+
+size_t Controller::DrainEvents(size_t max) {
+  batch_.clear();
+  Event e;
+  while (batch_.size() < max && events_.TryPop(e)) {
+    batch_.push_back(e);
+  }
+
+  // balance events are full snapshots, only the last one per account is applied
+  last_balance_.clear();
+  for (size_t i = 0; i < batch_.size(); ++i) {
+    if (batch_[i].kind_ == Event::kind::balance) {
+      last_balance_[batch_[i].account_id_] = i;
+    }
+  }
+
+  RpcViewInterface* rpc_view = rpc_view_.load(std::memory_order_acquire);
+  AccountViewInterface* account_view = account_view_.load(std::memory_order_acquire);
+  CallbackViewInterface* callback_view = callback_view_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < batch_.size(); ++i) {
+    const Event& ev = batch_[i];
+    switch (ev.kind_) {
+      case Event::kind::rpc_request: {
+        if (rpc_view) { rpc_view->AddRpcRequest(ev); }
+        break;
+      }
+      case Event::kind::rpc_response: {
+        if (rpc_view) { rpc_view->AddRpcResponse(ev); }
+        break;
+      }
+      case Event::kind::account_created: {
+        if (account_view) { account_view->CreateAccount(ev); }
+        break;
+      }
+      case Event::kind::account_deleted: {
+        if (account_view) { account_view->DeleteAccount(ev); }
+        break;
+      }
+      case Event::kind::balance: {
+        if (account_view && last_balance_[ev.account_id_] == i) { account_view->UpdateBalance(ev); }
+        break;
+      }
+      case Event::kind::callback_created: {
+        if (callback_view) { callback_view->CreateCallback(ev); }
+        break;
+      }
+      case Event::kind::callback_deleted: {
+        if (callback_view) { callback_view->DeleteCallback(ev); }
+        break;
+      }
+    }
+  }
+  if (!batch_.empty()) {
+    if (rpc_view) { rpc_view->EndBatch(); }
+    if (account_view) { account_view->EndBatch(); }
+    if (callback_view) { callback_view->EndBatch(); }
+  }
+
+  ConsoleViewInterface* console_view = console_view_.load(std::memory_order_acquire);
+  if (console_view) {
+    ConsoleLine line;
+    size_t n_lines = 0;
+    while (n_lines < console_capacity && console_.TryPop(line)) {
+      console_view->WriteToConsole(line.View());
+      n_lines++;
+    }
+    size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+      console_view->WriteToConsole(std::to_string(dropped) + " gui events dropped, the event bus was full");
+      n_lines++;
+    }
+    dropped = console_dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+      console_view->WriteToConsole(std::to_string(dropped) + " console lines dropped, the console was full");
+      n_lines++;
+    }
+    if (n_lines > 0) { console_view->EndBatch(); }
+  }
+  return batch_.size();
+}
+
 /* Rpc view */
 
-void Controller::ReceiveRpcRequest(const std::string& ip, const Request& req) {
-  std::string time_stamp = GetCurrentTimeStamp();
-  rpc_view_->AddRpcRequest(time_stamp, ip, req);
+bool Controller::SampleRpc(const sockaddr_in& client_addr, int id) const {
+  int n = rpc_sample_.load(std::memory_order_relaxed);
+  if (n == 1) { return true; }
+  uint32_t h = client_addr.sin_addr.s_addr ^ (static_cast<uint32_t>(client_addr.sin_port) << 16)
+    ^ static_cast<uint32_t>(id);
+  h *= 2654435761u;
+  return (h >> 8) % static_cast<uint32_t>(n) == 0;
+}
+
+void Controller::ReceiveRpcRequest(const sockaddr_in& client_addr, const Request& req) {
+  if (!rpc_view_.load(std::memory_order_acquire)) { return; }
+  if (!SampleRpc(client_addr, req.GetId())) { return; }
+  Event e = Event::Make(Event::kind::rpc_request);
+  e.SetClient(client_addr);
+  e.rpc_id_ = req.GetId();
+  e.code_ = static_cast<int>(req.GetOpCode());
+  Publish(e);
 }
 
-void Controller::PostRpcResponse(const std::string& ip, const Response& resp) {
-  std::string time_stamp = GetCurrentTimeStamp();
-  rpc_view_->AddRpcResponse(time_stamp, ip, resp);
+void Controller::PostRpcResponse(const sockaddr_in& client_addr, const Response& resp) {
+  PostRpcResponse(client_addr, resp.GetId(), resp.GetStatusCode());
+}
+
+void Controller::PostRpcResponse(const sockaddr_in& client_addr, int id, status_code code) {
+  if (!rpc_view_.load(std::memory_order_acquire)) { return; }
+  if (!SampleRpc(client_addr, id)) { return; }
+  Event e = Event::Make(Event::kind::rpc_response);
+  e.SetClient(client_addr);
+  e.rpc_id_ = id;
+  e.code_ = static_cast<int>(code);
+  Publish(e);
 }
 
 /* Console view */
 
-void Controller::WriteToConsole(const std::string& msg) {
-  console_view_->WriteToConsole(msg);
+void Controller::WriteToConsole(std::string_view msg) {
+  if (!console_view_.load(std::memory_order_acquire)) { return; }
+  if (!console_.TryPush(ConsoleLine::Make(msg))) {
+    console_dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 /* Account view */
 
 void Controller::CreateAccount(const Account& account) {
-  account_view_->CreateAccount(account);
-  std::cout << account.ToString() << " created. " << std::endl;
+  if (account_view_.load(std::memory_order_acquire)) {
+    Event e = Event::Make(Event::kind::account_created);
+    e.SetAccount(account);
+    e.SetCredentials(account.GetUserName(), account.GetPassword());
+    Publish(e);
+  }
 }
 
 void Controller::DeleteAccount(const Account& account) {
-  account_view_->DeleteAccount(account);
-  std::cout << account.ToString() << " deleted. " << std::endl; 
+  if (account_view_.load(std::memory_order_acquire)) {
+    Event e = Event::Make(Event::kind::account_deleted);
+    e.account_id_ = account.GetId();
+    Publish(e);
+  }
 }
 
 void Controller::Deposit(const Account& account) {
-  account_view_->HandleDeposit(account);
+  PublishBalance(account);
 }
 
 void Controller::Withdraw(const Account& account) {
-  account_view_->HandleWithdraw(account);
+  PublishBalance(account);
 }
 
 void Controller::Transfer(const Account& recv_account, const Account& send_account) {
-  account_view_->HandleTransfer(recv_account, send_account);
+  PublishBalance(recv_account);
+  PublishBalance(send_account);
 }
 
 void Controller::Exchange(const Account& account) {
-  account_view_->HandleExchange(account);
+  PublishBalance(account);
 }
 
 /* Callback view */
 
 void Controller::CreateCallback(const CallbackData& cb) {
-  callback_view_->CreateCallback(cb);
+  if (!callback_view_.load(std::memory_order_acquire)) { return; }
+  Event e = Event::Make(Event::kind::callback_created);
+  e.SetClient(cb.GetClientAddr());
+  e.duration_ms_ = cb.GetDuration().count();
+  Publish(e);
 }
 
 void Controller::DeleteCallback(const CallbackData& cb) {
-  callback_view_->DeleteCallback(cb);
-}
\ No newline at end of file
+  if (!callback_view_.load(std::memory_order_acquire)) { return; }
+  Event e = Event::Make(Event::kind::callback_deleted);
+  e.SetClient(cb.GetClientAddr());
+  e.duration_ms_ = cb.GetDuration().count();
+  Publish(e);
+}
@@ -2,12 +2,21 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include <atomic>
 #include <memory>
 #include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
 
 #include "../core/accounts.h"
 #include "../rpc/include.h"
 #include "../server/callback.h"
+#include "../server/events.h"
+#include "../server/mpsc.h"
 
 class Controller;
 
@@ -17,44 +26,49 @@ class HeaderViewInterface
   virtual void AddController(Controller* controller) = 0;
 };
 
+/* The rpc, account and callback views are fed from the event bus, their methods run
+ *   on the thread calling Controller::DrainEvents, EndBatch follows every batch */
+
 class RpcViewInterface
 {
  public:
-  virtual void AddRpcRequest(const std::string& t, const std::string& ip, 
-    const Request& req) = 0;
-  virtual void AddRpcResponse(const std::string& t, const std::string& ip, 
-    const Response& resp) = 0;
+  virtual void AddRpcRequest(const Event& e) = 0;
+  virtual void AddRpcResponse(const Event& e) = 0;
+  virtual void EndBatch() {}
 };
 
 class AccountViewInterface
 {
  public:
-  virtual void CreateAccount(const Account& account) = 0;
-  virtual void DeleteAccount(const Account& account) = 0;
-  virtual void HandleDeposit(const Account& account) = 0;
-  virtual void HandleWithdraw(const Account& account) = 0;
-  virtual void HandleTransfer(const Account& recv_account, const Account& send_account) = 0;
-  virtual void HandleExchange(const Account& account) = 0;
+  virtual void CreateAccount(const Event& e) = 0;
+  virtual void DeleteAccount(const Event& e) = 0;
+  virtual void UpdateBalance(const Event& e) = 0;
+  virtual void EndBatch() {}
 };
 
+/* The console is fed from its own ring of lines on the same thread */
+
 class ConsoleViewInterface
 {
  public:
-  virtual void WriteToConsole(const std::string& str) = 0;
+  virtual void WriteToConsole(std::string_view str) = 0;
+  virtual void EndBatch() {}
 };
 
 class CallbackViewInterface
 {
  public:
-  virtual void CreateCallback(const CallbackData& callback) = 0;
-  virtual void DeleteCallback(const CallbackData& callback) = 0;
+  virtual void CreateCallback(const Event& e) = 0;
+  virtual void DeleteCallback(const Event& e) = 0;
+  virtual void EndBatch() {}
 };
 
 class Controller
 {
  public:
 
-  Controller() = default;
+  Controller() : events_(event_bus_capacity), dropped_(0), console_(console_capacity), console_dropped_(0),
+                 rpc_sample_(1) {}
 
   ~Controller() {};
 
@@ -70,13 +84,19 @@ class Controller
 
   void BindCallbackViewModel(CallbackViewInterface* callback_view);
 
-  /* Update view models */
+  /* Update view models, called from the shards
+   *
+   *   these only publish an event or a console line, which is dropped if no view of
+   *   its kind is bound or if its ring is full, a shard never waits for the gui */
+
+  void ReceiveRpcRequest(const sockaddr_in& client_addr, const Request& req);
 
-  void ReceiveRpcRequest(const std::string& ip, const Request& req);
+  void PostRpcResponse(const sockaddr_in& client_addr, const Response& resp);
 
-  void PostRpcResponse(const std::string& ip, const Response& resp);
+  /* a response replayed from its id and status code alone */
+  void PostRpcResponse(const sockaddr_in& client_addr, int id, status_code code);
 
-  void WriteToConsole(const std::string& str);
+  void WriteToConsole(std::string_view str);
 
   void CreateAccount(const Account& account);
 
@@ -94,6 +114,14 @@ class Controller
 
   void DeleteCallback(const CallbackData& callback);
 
+  /* Apply up to max published events and the pending console lines to the bound
+   *   views, must only be called by one thread (the gui thread), returns the number
+   *   of events taken off the bus */
+  size_t DrainEvents(size_t max = event_drain_batch);
+
+  /* Publish only one rpc in n to the rpc view, see ServerConfig::rpc_log_sample */
+  void SetRpcSampling(int n) { rpc_sample_.store(n > 0 ? n : 1, std::memory_order_relaxed); }
+
   /* Update server mode */
 
   void BindChangeModeCallback(std::function<void(mode)> callback);
@@ -106,13 +134,37 @@ class Controller
 
  private:
 
-  RpcViewInterface* rpc_view_;
+  /* views are bound while the shards already run, hence atomic */
+
+  std::atomic<RpcViewInterface*> rpc_view_ = nullptr;
+
+  std::atomic<ConsoleViewInterface*> console_view_ = nullptr;
+
+  std::atomic<AccountViewInterface*> account_view_ = nullptr;
+
+  std::atomic<CallbackViewInterface*> callback_view_ = nullptr;
+
+  /* event bus from the shards to the gui */
+  MpscQueue<Event> events_;
+  /* events lost to a full bus since the last drain */
+  std::atomic<size_t> dropped_;
+  /* scratch of the draining thread */
+  std::vector<Event> batch_;
+  std::unordered_map<int, size_t> last_balance_;
+
+  /* console lines from the shards to the gui, and the lines lost to a full ring */
+  MpscQueue<ConsoleLine> console_;
+  std::atomic<size_t> console_dropped_;
+
+  std::atomic<int> rpc_sample_;
 
-  ConsoleViewInterface* console_view_;
+  /* whether the rpc of id from client_addr is logged, same answer for its request
+   *   and its response */
+  bool SampleRpc(const sockaddr_in& client_addr, int id) const;
 
-  AccountViewInterface* account_view_;
+  void Publish(const Event& e);
 
-  CallbackViewInterface* callback_view_;
+  void PublishBalance(const Account& account);
 
   /* server callbacks */
 
@@ -122,4 +174,4 @@ class Controller
 
 };
 
-#endif /* CONTROLLER_H */
\ No newline at end of file
+#endif /* CONTROLLER_H */
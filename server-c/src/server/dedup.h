@@ -0,0 +1,288 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <dedup.h> file implements the at-most-once reply cache of a shard. */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/* a request as seen by the server: the client's address and its request id, two
+ *   clients picking the same id are told apart */
+class DedupKey
+{
+ public:
+  uint32_t ip_;
+  uint16_t port_;
+  int id_;
+
+  bool operator==(const DedupKey&) const = default;
+};
+
+/* Bounded table of the replies sent to recent requests
+ *
+ *   entries live in a pool with stable indices, found through a flat open addressing
+ *   table of indices (linear probing, backward shift deletion, kept at most half full).
+ *   each entry holds the serialized reply, inline when short, so replaying it is a
+ *   copy. completed entries are chained from most to least recently used; the least
+ *   recently used are evicted once idle for longer than the ttl, or to stay under the
+ *   memory cap. an entry reserved for a request still being served stays off the chain
+ *   until it is completed: evicting it would let a retry run the request twice */
+class DedupCache
+{
+ public:
+
+  class Entry
+  {
+   public:
+    DedupKey key_;
+    /* status code of the reply, kept for the rpc log */
+    int code_;
+    /* last lookup, in ms of a steady clock */
+    int64_t time_;
+    /* lru chain, none at both ends and while not done */
+    uint32_t prev_;
+    uint32_t next_;
+    /* bytes stored, and length of the reply on the wire, the rest being zeros */
+    uint16_t len_;
+    uint16_t frame_len_;
+    /* false while the request is still being served, e.g. by another shard */
+    bool done_;
+    /* reply bytes when longer than inline_ */
+    std::unique_ptr<char[]> overflow_;
+    char inline_[80];
+
+    const char* Data() const { return overflow_ ? overflow_.get() : inline_; }
+  };
+
+  static_assert(sizeof(Entry) == 128, "an entry spans two cache lines");
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  /* memory_cap bounds the bytes used by entries, table and overflown replies, which
+   *   only the pinned entries may exceed, ttl_ms is how long a completed entry is kept
+   *   after its last lookup */
+  DedupCache(size_t memory_cap, int64_t ttl_ms)
+      : memory_cap_(memory_cap), ttl_ms_(ttl_ms), slots_(initial_slots, 0), mask_(initial_slots - 1),
+      head_(none), tail_(none), size_(0), bytes_(0) {}
+
+  DedupCache(const DedupCache&) = delete;
+  DedupCache& operator=(const DedupCache&) = delete;
+
+  /* Entry of key, marked as just used, nullptr if there is none. the pointer is valid
+   *   until the next insertion */
+  Entry* Find(const DedupKey& key, int64_t now) {
+    Expire(now);
+    uint32_t e = Lookup(key);
+    if (e == none) { return nullptr; }
+    Touch(e, now);
+    return &entries_[e];
+  }
+
+  /* Record that key is being served, its reply is not known yet. the entry is
+   *   pinned until Complete */
+  void Reserve(const DedupKey& key, int64_t now) {
+    Entry& entry = Acquire(key, now);
+    if (entry.done_) {
+      Unlink(static_cast<uint32_t>(&entry - entries_.data()));
+      entry.done_ = false;
+    }
+  }
+
+  /* Store the reply to key, reserved or not, len bytes of a frame_len bytes reply
+   *   whose tail is zeros. returns the entry, valid until the next insertion */
+  const Entry& Complete(const DedupKey& key, int code, const char* data, size_t len, size_t frame_len,
+                        int64_t now) {
+    Entry& entry = Acquire(key, now);
+    if (entry.overflow_) {
+      bytes_ -= entry.len_;
+      entry.overflow_.reset();
+    }
+    if (len > sizeof(entry.inline_)) {
+      entry.overflow_ = std::make_unique<char[]>(len);
+      bytes_ += len;
+    }
+    std::memcpy(entry.overflow_ ? entry.overflow_.get() : entry.inline_, data, len);
+    entry.code_ = code;
+    entry.len_ = static_cast<uint16_t>(len);
+    entry.frame_len_ = static_cast<uint16_t>(frame_len);
+    uint32_t e = static_cast<uint32_t>(&entry - entries_.data());
+    if (!entry.done_) {
+      entry.done_ = true;
+      Link(e);
+    }
+    Shrink(e);
+    return entries_[e];
+  }
+
+  /* number of entries */
+  size_t Size() const { return size_; }
+
+  /* bytes charged against the memory cap */
+  size_t Bytes() const { return bytes_; }
+
+  /* Call f on every completed entry, from least to most recently used, allocates
+   *   nothing */
+  template<typename F>
+  void ForEach(F&& f) const {
+    for (uint32_t e = tail_; e != none; e = entries_[e].prev_) {
+      if (entries_[e].done_) { f(entries_[e]); }
+    }
+  }
+
+ private:
+
+  static constexpr size_t initial_slots = 1024;
+
+  /* an entry costs its record and two table slots, as the table is at most half full */
+  static constexpr size_t entry_cost = sizeof(Entry) + 2 * sizeof(uint32_t);
+
+  size_t memory_cap_;
+
+  int64_t ttl_ms_;
+
+  std::vector<Entry> entries_;
+
+  /* unused indices of entries_ */
+  std::vector<uint32_t> free_;
+
+  /* entry index + 1, 0 for an empty slot */
+  std::vector<uint32_t> slots_;
+
+  size_t mask_;
+
+  /* most and least recently used */
+  uint32_t head_;
+  uint32_t tail_;
+
+  size_t size_;
+
+  size_t bytes_;
+
+  static size_t Hash(const DedupKey& key) {
+    uint64_t h = (static_cast<uint64_t>(key.ip_) << 16 | key.port_) ^
+      static_cast<uint64_t>(static_cast<uint32_t>(key.id_)) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 29;
+    return static_cast<size_t>(h);
+  }
+
+  uint32_t Lookup(const DedupKey& key) const {
+    for (size_t s = Hash(key) & mask_; slots_[s] != 0; s = (s + 1) & mask_) {
+      if (entries_[slots_[s] - 1].key_ == key) { return slots_[s] - 1; }
+    }
+    return none;
+  }
+
+  /* Entry of key, created pinned and not done if missing */
+  Entry& Acquire(const DedupKey& key, int64_t now) {
+    Expire(now);
+    uint32_t e = Lookup(key);
+    if (e != none) {
+      Touch(e, now);
+      return entries_[e];
+    }
+    // make room before taking an index, eviction only frees indices
+    while (tail_ != none && bytes_ + entry_cost > memory_cap_) { Evict(tail_); }
+    if ((size_ + 1) * 2 > slots_.size()) { Grow(); }
+    if (!free_.empty()) {
+      e = free_.back();
+      free_.pop_back();
+    } else {
+      e = static_cast<uint32_t>(entries_.size());
+      entries_.emplace_back();
+    }
+    Entry& entry = entries_[e];
+    entry.key_ = key;
+    entry.code_ = 0;
+    entry.len_ = 0;
+    entry.frame_len_ = 0;
+    entry.done_ = false;
+    size_t s = Hash(key) & mask_;
+    while (slots_[s] != 0) { s = (s + 1) & mask_; }
+    slots_[s] = e + 1;
+    ++size_;
+    bytes_ += entry_cost;
+    entry.prev_ = none;
+    entry.next_ = none;
+    entry.time_ = now;
+    return entry;
+  }
+
+  /* Evict least recently used entries other than keep until under the cap */
+  void Shrink(uint32_t keep) {
+    while (bytes_ > memory_cap_ && tail_ != none && tail_ != keep) { Evict(tail_); }
+  }
+
+  /* Drop the entries idle for longer than the ttl, oldest first */
+  void Expire(int64_t now) {
+    while (tail_ != none && now - entries_[tail_].time_ > ttl_ms_) { Evict(tail_); }
+  }
+
+  void Evict(uint32_t e) {
+    Entry& entry = entries_[e];
+    Unlink(e);
+    // backward shift: pull later entries of the probe run into the hole
+    size_t hole = Hash(entry.key_) & mask_;
+    while (slots_[hole] != e + 1) { hole = (hole + 1) & mask_; }
+    for (size_t s = (hole + 1) & mask_; slots_[s] != 0; s = (s + 1) & mask_) {
+      size_t home = Hash(entries_[slots_[s] - 1].key_) & mask_;
+      // move the slot unless its home lies cyclically in (hole, s]
+      if (((s - home) & mask_) >= ((s - hole) & mask_)) {
+        slots_[hole] = slots_[s];
+        hole = s;
+      }
+    }
+    slots_[hole] = 0;
+    if (entry.overflow_) {
+      bytes_ -= entry.len_;
+      entry.overflow_.reset();
+    }
+    bytes_ -= entry_cost;
+    --size_;
+    free_.push_back(e);
+  }
+
+  void Grow() {
+    std::vector<uint32_t> slots(slots_.size() * 2, 0);
+    mask_ = slots.size() - 1;
+    for (uint32_t v : slots_) {
+      if (v == 0) { continue; }
+      size_t s = Hash(entries_[v - 1].key_) & mask_;
+      while (slots[s] != 0) { s = (s + 1) & mask_; }
+      slots[s] = v;
+    }
+    slots_.swap(slots);
+  }
+
+  void Touch(uint32_t e, int64_t now) {
+    entries_[e].time_ = now;
+    if (head_ == e || !entries_[e].done_) { return; }
+    Unlink(e);
+    Link(e);
+  }
+
+  void Link(uint32_t e) {
+    entries_[e].prev_ = none;
+    entries_[e].next_ = head_;
+    if (head_ != none) { entries_[head_].prev_ = e; }
+    head_ = e;
+    if (tail_ == none) { tail_ = e; }
+  }
+
+  void Unlink(uint32_t e) {
+    Entry& entry = entries_[e];
+    if (entry.prev_ != none) { entries_[entry.prev_].next_ = entry.next_; } else { head_ = entry.next_; }
+    if (entry.next_ != none) { entries_[entry.next_].prev_ = entry.prev_; } else { tail_ = entry.prev_; }
+    entry.prev_ = none;
+    entry.next_ = none;
+  }
+
+};
+
+#endif /* DEDUP_H */
@@ -0,0 +1,131 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <events.h> file defines the events the server publishes to the gui.
+ *
+ * Handlers on the shard threads only push an event into a bounded lock-free ring,
+ * the gui drains the ring at a fixed frame rate and applies a whole batch at once. */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string_view>
+
+#include <netinet/in.h>
+
+#include "../core/accounts.h"
+#include "../core/currency.h"
+#include "../core/money.h"
+
+/* capacity of the ring between the shards and the gui */
+constexpr size_t event_bus_capacity = 1 << 14;
+/* interval at which the gui drains the ring */
+constexpr int event_drain_interval_ms = 33;
+/* max number of events applied per frame, the rest wait for the next one */
+constexpr size_t event_drain_batch = 4096;
+
+/* capacity of the ring of console lines, and the longest line it keeps */
+constexpr size_t console_capacity = 1 << 10;
+constexpr size_t console_line_len = 256;
+
+/* fixed size of the account name and password carried by an event, room for
+ *   the longest credential an account accepts */
+constexpr size_t event_text_len = account_text_max + 1;
+
+/* Plain data snapshot of something the gui shows, copied by value through the ring
+ *
+ *   rpc_request, rpc_response: time_, client address, rpc_id_ and code_
+ *     (operation code or status code)
+ *   account_created:           account_id_, balance, user_name_ and password_
+ *   account_deleted:           account_id_
+ *   balance:                   account_id_ and balance after a deposit, withdraw,
+ *     exchange or either side of a transfer, only the last one per account counts
+ *   callback_created, callback_deleted: client address and duration_ms_ */
+class Event
+{
+ public:
+
+  enum class kind : uint8_t {
+    rpc_request, rpc_response, account_created, account_deleted, balance,
+    callback_created, callback_deleted
+  };
+
+  kind kind_;
+
+  /* milliseconds since the unix epoch */
+  int64_t time_;
+
+  /* client address, network byte order */
+  uint32_t ip_;
+  uint16_t port_;
+
+  int rpc_id_;
+  int code_;
+
+  int account_id_;
+  /* bit c is set if the account holds currency c */
+  uint8_t held_;
+  Money balance_[n_currencies];
+  char user_name_[event_text_len];
+  char password_[event_text_len];
+
+  int64_t duration_ms_;
+
+  static Event Make(kind k) {
+    Event e{};
+    e.kind_ = k;
+    e.time_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+    return e;
+  }
+
+  void SetClient(const sockaddr_in& addr) {
+    ip_ = addr.sin_addr.s_addr;
+    port_ = addr.sin_port;
+  }
+
+  void SetAccount(const Account& account) {
+    account_id_ = account.GetId();
+    held_ = account.GetHeld();
+    std::copy(account.GetBalance().begin(), account.GetBalance().end(), balance_);
+  }
+
+  void SetCredentials(std::string_view user_name, std::string_view password) {
+    CopyText(user_name_, user_name);
+    CopyText(password_, password);
+  }
+
+ private:
+
+  static void CopyText(char (&dst)[event_text_len], std::string_view src) {
+    size_t n = std::min(src.size(), event_text_len - 1);
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+  }
+
+};
+
+/* A console line copied by value through its own ring, longer lines are cut */
+class ConsoleLine
+{
+ public:
+
+  uint16_t len_;
+  char text_[console_line_len];
+
+  static ConsoleLine Make(std::string_view str) {
+    ConsoleLine line;
+    line.len_ = static_cast<uint16_t>(std::min(str.size(), console_line_len));
+    std::memcpy(line.text_, str.data(), line.len_);
+    return line;
+  }
+
+  std::string_view View() const { return std::string_view(text_, len_); }
+
+};
+
+#endif /* EVENTS_H */
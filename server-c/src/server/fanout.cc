@@ -0,0 +1,400 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "fanout.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+/* a window per client address */
+static uint64_t address_key(const sockaddr_in& addr) {
+  return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+}
+
+/* marks the timer sending the deltas of a window, the other closing it */
+static constexpr uint64_t send_timer = 1ull << 63;
+
+static std::chrono::steady_clock::time_point window_end(const CallbackData& cb) {
+  return cb.GetStart() + cb.GetDuration();
+}
+
+Fanout::Fanout(Controller& controller, const ServerConfig& config)
+    : controller_(controller), sockfd_(-1), multicast_(false), multicast_addr_{}, multicast_if_{INADDR_ANY},
+    multicast_ttl_(config.multicast_ttl), multicast_seq_(0), stopping_(false), queue_(fanout_capacity),
+    dropped_(0), delta_windows_(0), sleeping_(false), epoch_(std::chrono::steady_clock::now()), wheel_(0),
+    tick_(0), stamp_(0), out_(fanout_batch), n_msgs_(0) {
+  batch_.reserve(fanout_batch);
+  if (config.multicast_group.empty()) { return; }
+  multicast_addr_.sin_family = AF_INET;
+  multicast_addr_.sin_port = htons(static_cast<uint16_t>(config.multicast_port));
+  if (inet_pton(AF_INET, config.multicast_group.c_str(), &multicast_addr_.sin_addr) != 1 ||
+      !IN_MULTICAST(ntohl(multicast_addr_.sin_addr.s_addr))) {
+    fprintf(stderr, "not a multicast group: %s\n", config.multicast_group.c_str());
+    return;
+  }
+  if (!config.multicast_interface.empty() &&
+      inet_pton(AF_INET, config.multicast_interface.c_str(), &multicast_if_) != 1) {
+    fprintf(stderr, "not an interface address: %s\n", config.multicast_interface.c_str());
+    return;
+  }
+  multicast_ = true;
+  multicast_name_ = config.multicast_group + ":" + std::to_string(config.multicast_port);
+}
+
+Fanout::~Fanout() {
+  Stop();
+}
+
+void Fanout::Start(int sockfd) {
+  sockfd_ = sockfd;
+  if (multicast_) {
+    // looped back so that receivers on this host, and loopback tests, get it too
+    unsigned char loop = 1;
+    if (setsockopt(sockfd_, IPPROTO_IP, IP_MULTICAST_TTL, &multicast_ttl_, sizeof(multicast_ttl_)) < 0 ||
+        setsockopt(sockfd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+        setsockopt(sockfd_, IPPROTO_IP, IP_MULTICAST_IF, &multicast_if_, sizeof(multicast_if_)) < 0) {
+      perror("setsockopt multicast");
+    }
+  }
+  thread_ = std::thread(&Fanout::Run, this);
+}
+
+void Fanout::Stop() {
+  if (!thread_.joinable()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+bool Fanout::Subscribe(const CallbackData& cb, MonitorFilter filter, std::chrono::milliseconds interval) {
+  // an account listed twice would be matched twice
+  std::sort(filter.accounts_.begin(), filter.accounts_.end());
+  filter.accounts_.erase(std::unique(filter.accounts_.begin(), filter.accounts_.end()), filter.accounts_.end());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = live_.try_emplace(address_key(cb.GetClientAddr()), window_end(cb));
+    if (!inserted) {
+      // the previous window may be over and not yet closed by the thread
+      if (std::chrono::steady_clock::now() < it->second) { return false; }
+      it->second = window_end(cb);
+    }
+    subscribed_.push_back(Window{cb, std::move(filter), TimerWheel<uint64_t>::none, 0, interval.count(), 0, {}, {},
+                                 TimerWheel<uint64_t>::none});
+  }
+  cv_.notify_one();
+  return true;
+}
+
+bool Fanout::Notify(const CallbackTopic& topic, std::string_view msg) {
+  Item item;
+  item.kind_ = Item::kind::text;
+  item.topic_ = topic;
+  size_t len = std::min(msg.size(), out_buf_len - 1);
+  std::memcpy(item.text_.data(), msg.data(), len);
+  item.text_[len] = '\0';
+  item.len_ = static_cast<uint16_t>(len + 1);
+  return Push(item);
+}
+
+bool Fanout::Update(const CallbackTopic& topic, const BalanceDelta& delta) {
+  if (delta_windows_.load(std::memory_order_relaxed) == 0) { return true; }
+  Item item;
+  item.kind_ = Item::kind::delta;
+  item.topic_ = topic;
+  item.delta_ = delta;
+  item.len_ = 0;
+  return Push(item);
+}
+
+bool Fanout::Push(const Item& item) {
+  if (!queue_.TryPush(item)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // pairs with the fence of the thread going to sleep, either it sees the item or
+  // this sees it sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+  return true;
+}
+
+void Fanout::Run() {
+  for (;;) {
+    Open();
+    Expire(std::chrono::steady_clock::now());
+    Item item;
+    while (batch_.size() < fanout_batch && queue_.TryPop(item)) { batch_.push_back(item); }
+    if (!batch_.empty()) {
+      Deliver();
+      continue;
+    }
+    if (size_t dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+      char line[96];
+      snprintf(line, sizeof(line), "%zu monitor callbacks dropped, the fan-out queue was full", dropped);
+      controller_.WriteToConsole(line);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopping_) { return; }
+    if (!subscribed_.empty()) { continue; }
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (queue_.Empty()) {
+      // sleep until the next window is due to close or send, or for good if none is open
+      int64_t next = wheel_.NextTick();
+      if (next == std::numeric_limits<int64_t>::max()) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, epoch_ + std::chrono::milliseconds(next));
+      }
+    }
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+}
+
+void Fanout::Open() {
+  std::vector<Window> subscribed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribed.swap(subscribed_);
+  }
+  for (Window& window : subscribed) {
+    const CallbackData& cb = window.cb_;
+    uint64_t key = address_key(cb.GetClientAddr());
+    // the window closes at the first tick at or past its end
+    auto end = std::chrono::ceil<std::chrono::milliseconds>(window_end(cb) - epoch_);
+    window.timer_ = wheel_.Add(end.count(), key);
+    if (window.interval_ > 0) { delta_windows_.fetch_add(1, std::memory_order_relaxed); }
+    uint32_t pos;
+    if (auto it = index_.find(key); it != index_.end()) {
+      // a window over but not yet closed, replaced in place, its deltas are dropped
+      pos = static_cast<uint32_t>(it->second);
+      Window& old = windows_[pos];
+      wheel_.Cancel(old.timer_);
+      if (old.send_timer_ != TimerWheel<uint64_t>::none) { wheel_.Cancel(old.send_timer_); }
+      if (old.interval_ > 0) { delta_windows_.fetch_sub(1, std::memory_order_relaxed); }
+      Unindex(old, pos);
+      controller_.DeleteCallback(old.cb_);
+      old = std::move(window);
+    } else {
+      pos = static_cast<uint32_t>(windows_.size());
+      index_.emplace(key, pos);
+      windows_.push_back(std::move(window));
+    }
+    Index(windows_[pos], pos);
+    // published from here so that the view sees a replaced window go before the new one
+    controller_.CreateCallback(windows_[pos].cb_);
+  }
+}
+
+void Fanout::Expire(std::chrono::steady_clock::time_point now) {
+  tick_ = std::chrono::floor<std::chrono::milliseconds>(now - epoch_).count();
+  wheel_.Advance(tick_, [&](uint64_t key) {
+    if (!(key & send_timer)) {
+      Close(key);
+      return;
+    }
+    Window& window = windows_[index_.at(key & ~send_timer)];
+    window.send_timer_ = TimerWheel<uint64_t>::none;
+    window.due_ = tick_ + window.interval_;
+    AddDeltas(window);
+  });
+  Flush();
+}
+
+void Fanout::Close(uint64_t key) {
+  auto it = index_.find(key);
+  uint32_t pos = static_cast<uint32_t>(it->second);
+  index_.erase(it);
+  Window& window = windows_[pos];
+  // what was kept goes out with the window, and before the message headers pointing
+  // at window addresses are invalidated by the move below
+  AddDeltas(window);
+  Flush();
+  if (window.send_timer_ != TimerWheel<uint64_t>::none) { wheel_.Cancel(window.send_timer_); }
+  if (window.interval_ > 0) { delta_windows_.fetch_sub(1, std::memory_order_relaxed); }
+  Unindex(window, pos);
+  CallbackData cb = window.cb_;
+  uint32_t last = static_cast<uint32_t>(windows_.size() - 1);
+  if (pos != last) {
+    Unindex(windows_[last], last);
+    windows_[pos] = std::move(windows_[last]);
+    Index(windows_[pos], pos);
+    index_[address_key(windows_[pos].cb_.GetClientAddr())] = pos;
+  }
+  windows_.pop_back();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // unless the address subscribed again meanwhile
+    if (auto live = live_.find(key); live != live_.end() && live->second == window_end(cb)) { live_.erase(live); }
+  }
+  controller_.DeleteCallback(cb);
+  controller_.WriteToConsole("monitor window closed");
+}
+
+void Fanout::Index(const Window& window, uint32_t pos) {
+  if (window.filter_.accounts_.empty()) {
+    every_account_.push_back(pos);
+    return;
+  }
+  for (int account : window.filter_.accounts_) { by_account_[account].push_back(pos); }
+}
+
+void Fanout::Unindex(const Window& window, uint32_t pos) {
+  // order within a list does not matter, entries are removed by swapping the last in
+  auto drop = [pos](std::vector<uint32_t>& positions) {
+    auto it = std::find(positions.begin(), positions.end(), pos);
+    *it = positions.back();
+    positions.pop_back();
+  };
+  if (window.filter_.accounts_.empty()) {
+    drop(every_account_);
+    return;
+  }
+  for (int account : window.filter_.accounts_) {
+    auto it = by_account_.find(account);
+    drop(it->second);
+    if (it->second.empty()) { by_account_.erase(it); }
+  }
+}
+
+void Fanout::Deliver() {
+  std::array<bool, fanout_batch> sent{};
+  for (size_t i = 0; i < batch_.size(); ++i) {
+    const Item& item = batch_[i];
+    const CallbackTopic& topic = item.topic_;
+    // deltas are kept here and sent by the timer of each window
+    // a transfer between two accounts of a window reaches it once
+    ++stamp_;
+    size_t matched = 0;
+    Match(item, every_account_, matched);
+    if (auto it = by_account_.find(topic.account_); it != by_account_.end()) { Match(item, it->second, matched); }
+    if (topic.peer_ != topic.account_) {
+      if (auto it = by_account_.find(topic.peer_); it != by_account_.end()) { Match(item, it->second, matched); }
+    }
+    if (multicast_ && item.kind_ == Item::kind::text) {
+      AddMulticast(item);
+      ++matched;
+    }
+    sent[i] = item.kind_ == Item::kind::text && matched > 0;
+  }
+  Flush();
+  // the console shows each callback sent once, not once per window
+  for (size_t i = 0; i < batch_.size(); ++i) {
+    if (!sent[i]) { continue; }
+    char line[out_buf_len + 32];
+    int n = snprintf(line, sizeof(line), "monitor callback send: %s", batch_[i].text_.data());
+    controller_.WriteToConsole(std::string_view(line, std::min<size_t>(n, sizeof(line) - 1)));
+  }
+  batch_.clear();
+}
+
+void Fanout::Match(const Item& item, const std::vector<uint32_t>& positions, size_t& matched) {
+  for (uint32_t pos : positions) {
+    Window& window = windows_[pos];
+    if (window.stamp_ == stamp_) { continue; }
+    window.stamp_ = stamp_;
+    // a window takes either texts or deltas
+    if ((window.interval_ > 0) != (item.kind_ == Item::kind::delta)) { continue; }
+    if (!window.filter_.Accepts(item.topic_)) { continue; }
+    if (item.kind_ == Item::kind::delta) {
+      Keep(pos, item.delta_);
+    } else {
+      Add(item.text_.data(), item.len_, window.cb_.GetClientAddr(), window.cb_.GetClientAddrLen());
+    }
+    ++matched;
+  }
+}
+
+void Fanout::Keep(uint32_t pos, const BalanceDelta& delta) {
+  Window& window = windows_[pos];
+  auto [it, inserted] = window.delta_pos_.try_emplace(delta.id_, static_cast<uint32_t>(window.deltas_.size()));
+  if (!inserted) {
+    // only the last balances of an account matter
+    window.deltas_[it->second] = delta;
+    return;
+  }
+  window.deltas_.push_back(delta);
+  if (window.send_timer_ == TimerWheel<uint64_t>::none) {
+    uint64_t key = address_key(window.cb_.GetClientAddr()) | send_timer;
+    window.send_timer_ = wheel_.Add(std::max(window.due_, tick_ + 1), key);
+  }
+}
+
+void Fanout::AddDeltas(Window& window) {
+  char* buf = nullptr;
+  size_t len = 0;
+  for (const BalanceDelta& delta : window.deltas_) {
+    if (buf && len + BalanceDelta::max_size > delta_datagram_max) {
+      Add(buf, len, window.cb_.GetClientAddr(), window.cb_.GetClientAddrLen());
+      buf = nullptr;
+    }
+    if (!buf) {
+      // the buffer of the next message header, free until it is flushed
+      buf = out_[n_msgs_].data();
+      buf[0] = '\0';
+      len = 1;
+    }
+    len += delta.Encode(buf + len);
+  }
+  if (buf) { Add(buf, len, window.cb_.GetClientAddr(), window.cb_.GetClientAddrLen()); }
+  window.deltas_.clear();
+  window.delta_pos_.clear();
+}
+
+void Fanout::AddMulticast(const Item& item) {
+  char* buf = out_[n_msgs_].data();
+  Writer out(buf);
+  *out.Put(1) = static_cast<char>(multicast_tag);
+  serialize(out, multicast_seq_++);
+  // the text keeps its terminator if it has to be cut
+  size_t len = std::min<size_t>(item.len_, delta_datagram_max - multicast_header_size);
+  std::memcpy(out.Put(len), item.text_.data(), len);
+  buf[out.Pos() - 1] = '\0';
+  Add(buf, out.Pos(), multicast_addr_, sizeof(multicast_addr_));
+}
+
+void Fanout::Add(const char* data, size_t len, const sockaddr_in& addr, socklen_t addr_len) {
+#ifdef __linux__
+  iovec& iov = iovs_[n_msgs_];
+  iov.iov_base = const_cast<char*>(data);
+  iov.iov_len = len;
+  msghdr& hdr = msgs_[n_msgs_].msg_hdr;
+  hdr = msghdr{};
+  hdr.msg_name = const_cast<sockaddr_in*>(&addr);
+  hdr.msg_namelen = addr_len;
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  if (++n_msgs_ == fanout_batch) { Flush(); }
+#else
+  if (sendto(sockfd_, data, len, 0, reinterpret_cast<const sockaddr*>(&addr), addr_len) < 0) {
+    perror("sendto");
+  }
+#endif
+}
+
+void Fanout::Flush() {
+#ifdef __linux__
+  size_t sent = 0;
+  while (sent < n_msgs_) {
+    int n = sendmmsg(sockfd_, msgs_.data() + sent, n_msgs_ - sent, 0);
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      perror("sendmmsg");
+      // skip the datagram that failed, e.g. an unreachable window
+      ++sent;
+      continue;
+    }
+    sent += static_cast<size_t>(n);
+  }
+#endif
+  n_msgs_ = 0;
+}
@@ -0,0 +1,235 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <fanout.h> file implements the delivery of monitor callbacks. */
+
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "callback.h"
+#include "config.h"
+#include "controller.h"
+#include "mpsc.h"
+#include "server.h"
+#include "timer.h"
+
+/* capacity of the queue of callbacks waiting for the fan-out thread */
+constexpr size_t fanout_capacity = 1024;
+
+/* max number of datagrams per sendmmsg */
+constexpr size_t fanout_batch = 64;
+
+/* longest datagram of deltas, under an ethernet mtu with the ip and udp headers and
+ *   no longer than the callbacks clients already read */
+constexpr size_t delta_datagram_max = out_buf_len;
+
+/* a multicast datagram is this byte, the sequence number as 8 little-endian bytes
+ *   and the text of the callback with its null terminator */
+constexpr uint8_t multicast_tag = 1;
+constexpr size_t multicast_header_size = 1 + sizeof(uint64_t);
+
+/* Sends the monitor callbacks of every shard off the request path
+ *
+ *   shards queue the text of a callback and move on, a thread of its own sends each
+ *   text to every active monitor window with batched sendmmsg (sendto where there is
+ *   none), so serving a request never waits on the number of windows. a callback
+ *   that finds the queue full is dropped and counted, delivery is best effort as udp
+ *   is. windows are registered once for the whole group, by the shard receiving the
+ *   monitor request.
+ *
+ *   the thread owns the windows: they are kept packed in one array, a timer wheel
+ *   closes each window when its duration is over, traffic or not, reporting it to
+ *   the controller. the windows filtering on accounts are indexed by account, a
+ *   callback only visits the windows of its accounts and those taking every account,
+ *   so it costs nothing per window it does not match nor per expired one.
+ *
+ *   a window with an update interval takes deltas instead of texts: the new balances
+ *   of each account changed are kept, one per account, and sent when the interval
+ *   is over, packed many to a datagram. the datagram starts with a zero byte, which
+ *   a text never does, followed by the encodings of BalanceDelta. such a window
+ *   costs at most one burst per interval however busy the shards are.
+ *
+ *   with a multicast group configured every text is also sent once to the group,
+ *   whatever the number of receivers that joined it, numbered so that they can tell
+ *   a datagram lost. receivers filter for themselves, deltas are unicast only */
+class Fanout
+{
+ public:
+
+  Fanout(Controller& controller, const ServerConfig& config);
+
+  ~Fanout();
+
+  Fanout(const Fanout&) = delete;
+  Fanout& operator=(const Fanout&) = delete;
+
+  /* Spawn the thread, callbacks are sent through sockfd */
+  void Start(int sockfd);
+
+  /* group:port of the multicast group, empty if none */
+  std::string_view MulticastGroup() const { return multicast_name_; }
+
+  /* Send what is queued, then stop the thread */
+  void Stop();
+
+  /* Add a monitor window, it receives the callbacks queued from now on that pass
+   *   filter, as deltas at most once per interval if it is not zero. returns false
+   *   if the client address still has a window open */
+  bool Subscribe(const CallbackData& cb, MonitorFilter filter, std::chrono::milliseconds interval);
+
+  /* Queue a callback about topic for the active windows it matches, never blocks,
+   *   returns false if the queue is full and the callback dropped */
+  bool Notify(const CallbackTopic& topic, std::string_view msg);
+
+  /* Queue the balances an op of topic left an account with, for the windows taking
+   *   deltas, returns false if dropped as Notify. nothing is queued without such
+   *   windows */
+  bool Update(const CallbackTopic& topic, const BalanceDelta& delta);
+
+ private:
+
+  /* a queued callback, what it is about, and the text and its null terminator or
+   *   the new balances of the account */
+  class Item
+  {
+   public:
+    enum class kind { text, delta };
+    kind kind_;
+    CallbackTopic topic_;
+    BalanceDelta delta_;
+    uint16_t len_;
+    std::array<char, out_buf_len> text_;
+  };
+
+  Controller& controller_;
+
+  int sockfd_;
+
+  /* the multicast group if any, the interface and hops to send to it with, and the
+   *   sequence number of the next datagram sent to it */
+  bool multicast_;
+  sockaddr_in multicast_addr_;
+  in_addr multicast_if_;
+  int multicast_ttl_;
+  std::string multicast_name_;
+  uint64_t multicast_seq_;
+
+  std::thread thread_;
+
+  std::atomic<bool> stopping_;
+
+  /* an open window, the timer closing it and the last item sent to it. a window
+   *   taking deltas has its interval in ticks, the tick before which it is not sent
+   *   again, the deltas kept meanwhile with the position of each by account and the
+   *   timer sending them, none if no delta is kept */
+  class Window
+  {
+   public:
+    CallbackData cb_;
+    MonitorFilter filter_;
+    uint32_t timer_;
+    uint64_t stamp_;
+    int64_t interval_;
+    int64_t due_;
+    std::vector<BalanceDelta> deltas_;
+    std::unordered_map<int, uint32_t> delta_pos_;
+    uint32_t send_timer_;
+  };
+
+  MpscQueue<Item> queue_;
+  /* callbacks dropped because the queue was full, reported by the thread */
+  std::atomic<size_t> dropped_;
+  /* windows taking deltas, shards queue no balances without any */
+  std::atomic<size_t> delta_windows_;
+
+  /* guards subscribed_ and live_, the thread sleeps on cv_ with it */
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  /* set while the thread waits, a push wakes it only then */
+  std::atomic<bool> sleeping_;
+  /* windows subscribed and not yet picked up by the thread */
+  std::vector<Window> subscribed_;
+  /* end of the window open for each client address, erased when it is closed */
+  std::unordered_map<uint64_t, std::chrono::steady_clock::time_point> live_;
+
+  /* origin of the ticks of the wheel, one per ms */
+  std::chrono::steady_clock::time_point epoch_;
+
+  /* only touched by the thread: the windows, packed, the position of each by client
+   *   address, the positions of the windows taking each account and of those taking
+   *   every account, the wheel, the callbacks drained in one pass, the count of items
+   *   sent and the message headers pointing into them */
+  std::vector<Window> windows_;
+  std::unordered_map<uint64_t, size_t> index_;
+  std::unordered_map<int, std::vector<uint32_t>> by_account_;
+  std::vector<uint32_t> every_account_;
+  TimerWheel<uint64_t> wheel_;
+  /* last tick the wheel was moved to */
+  int64_t tick_;
+  std::vector<Item> batch_;
+  uint64_t stamp_;
+  /* datagrams of deltas, one per message header */
+  std::vector<std::array<char, delta_datagram_max>> out_;
+#ifdef __linux__
+  std::array<mmsghdr, fanout_batch> msgs_;
+  std::array<iovec, fanout_batch> iovs_;
+#endif
+  size_t n_msgs_;
+
+  /* Queue item, counting it dropped if the queue is full, and wake the thread */
+  bool Push(const Item& item);
+
+  void Run();
+
+  /* Open the windows subscribed since the last pass */
+  void Open();
+
+  /* Close the windows whose duration is over by now */
+  void Expire(std::chrono::steady_clock::time_point now);
+
+  /* Remove the window of client address key, swapping the last one in its place */
+  void Close(uint64_t key);
+
+  /* Add or remove window at position pos in the account index */
+  void Index(const Window& window, uint32_t pos);
+  void Unindex(const Window& window, uint32_t pos);
+
+  /* Add item for the windows at positions that match it and have not had it yet */
+  void Match(const Item& item, const std::vector<uint32_t>& positions, size_t& matched);
+
+  /* Keep delta for the window at position pos, replacing that of the same account */
+  void Keep(uint32_t pos, const BalanceDelta& delta);
+
+  /* Pack the deltas kept for window into datagrams */
+  void AddDeltas(Window& window);
+
+  /* Send one pass of drained callbacks to the active windows */
+  void Deliver();
+
+  /* Queue a datagram of len bytes at data to addr, sent by the next Flush */
+  void Add(const char* data, size_t len, const sockaddr_in& addr, socklen_t addr_len);
+
+  /* Queue item to the multicast group */
+  void AddMulticast(const Item& item);
+
+  void Flush();
+
+};
+
+#endif /* FANOUT_H */
@@ -0,0 +1,97 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "group.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+ServerGroup::ServerGroup(const ServerConfig& config) : controller_{}, servers_{}, fanout_(controller_, config) {
+  controller_.BindChangeModeCallback([this](mode m)->void {
+    this->ChangeMode(m);
+  });
+  controller_.BindChangeLostRateCallback([this](int i)->void {
+    this->ChangeLostRate(i);
+  });
+  controller_.SetRpcSampling(config.rpc_log_sample);
+  // before any shard serves an exchange
+  if (!config.rates_file.empty()) {
+    // the console is bound after construction
+    fprintf(stderr, "%s\n", LoadRates(config.rates_file).c_str());
+    rates_watcher_ = std::thread(&ServerGroup::WatchRates, this, config.rates_file,
+                                 std::chrono::seconds(config.rates_poll));
+  }
+  // construct every shard before starting any, a shard may hand off to its peers
+  // as soon as it receives its first datagram
+  for (int i = 0; i < config.shards; ++i) {
+    servers_.push_back(std::make_unique<Server>(config, i, controller_, *this));
+  }
+  for (auto& server : servers_) {
+    server->Start();
+  }
+  // callbacks go out through the socket of the first shard, from the server's port
+  fanout_.Start(servers_.front()->Socket());
+  if (!config.wal_dir.empty() && config.snapshot_interval > 0) {
+    std::chrono::seconds interval(config.snapshot_interval);
+    snapshot_timer_ = std::thread([this, interval]() {
+      std::unique_lock<std::mutex> lock(timer_mutex_);
+      while (!timer_cv_.wait_for(lock, interval, [this]() { return stopping_; })) {
+        for (auto& server : servers_) {
+          server->RequestSnapshot();
+        }
+      }
+    });
+  }
+}
+
+ServerGroup::~ServerGroup() {
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    stopping_ = true;
+  }
+  timer_cv_.notify_all();
+  if (snapshot_timer_.joinable()) { snapshot_timer_.join(); }
+  if (rates_watcher_.joinable()) { rates_watcher_.join(); }
+  // before the shards close their sockets
+  fanout_.Stop();
+  for (auto& server : servers_) {
+    server->Stop();
+  }
+  // the console lines written while stopping
+  controller_.DrainEvents();
+}
+
+void ServerGroup::ChangeMode(mode m) {
+  for (auto& server : servers_) {
+    server->ChangeMode(m);
+  }
+  controller_.WriteToConsole("mode changed to " + mode_to_str(m));
+}
+
+void ServerGroup::ChangeLostRate(int i) {
+  for (auto& server : servers_) {
+    server->ChangeLostRate(i);
+  }
+}
+
+std::string ServerGroup::LoadRates(const std::string& path) {
+  try {
+    size_t n = exchange_rates.Load(path);
+    return "exchange rates: " + std::to_string(n) + " loaded from " + path;
+  } catch (const std::runtime_error& e) {
+    return std::string("exchange rates kept: ") + e.what();
+  }
+}
+
+void ServerGroup::WatchRates(std::string path, std::chrono::seconds poll) {
+  std::error_code ec;
+  auto loaded = std::filesystem::last_write_time(path, ec);
+  std::unique_lock<std::mutex> lock(timer_mutex_);
+  while (!timer_cv_.wait_for(lock, poll, [this]() { return stopping_; })) {
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec || mtime == loaded) { continue; }
+    // a file failing to load is tried again once changed again
+    loaded = mtime;
+    controller_.WriteToConsole(LoadRates(path));
+  }
+}
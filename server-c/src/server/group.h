@@ -0,0 +1,92 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <group.h> file implements the group of listener shards forming one bank server. */
+
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "controller.h"
+#include "fanout.h"
+#include "server.h"
+
+/* Owns the shards and the controller they share
+ *
+ *   every shard listens on the same port (SO_REUSEPORT) and owns the accounts whose
+ *   id modulo the number of shards equals its index, requests for accounts of another
+ *   shard are handed off to its inbox */
+class ServerGroup
+{
+ public:
+
+  ServerGroup(int port) : ServerGroup(DefaultConfig(port)) {}
+
+  ServerGroup(const ServerConfig& config);
+
+  ~ServerGroup();
+
+  int Size() const { return static_cast<int>(servers_.size()); }
+
+  Server& GetServer(int shard) { return *servers_[shard]; }
+
+  Fanout& GetFanout() { return fanout_; }
+
+  void BindHeaderViewModel(HeaderViewInterface* view) { controller_.BindHeaderViewModel(view); }
+
+  void BindRpcViewModel(RpcViewInterface* view) { controller_.BindRpcViewModel(view); }
+
+  void BindConsoleViewModel(ConsoleViewInterface* view) { controller_.BindConsoleViewModel(view); }
+
+  void BindAccountViewModel(AccountViewInterface* view) { controller_.BindAccountViewModel(view); }
+
+  void BindCallbackViewModel(CallbackViewInterface* view) { controller_.BindCallbackViewModel(view); }
+
+  /* Apply the events published by the shards to the bound views, see Controller */
+  size_t DrainEvents(size_t max = event_drain_batch) { return controller_.DrainEvents(max); }
+
+ private:
+
+  /* default configuration listening on port */
+  static ServerConfig DefaultConfig(int port) {
+    ServerConfig config;
+    config.port = port;
+    return config;
+  }
+
+  /* the controller to which gui is bounded, shared by all shards */
+  Controller controller_;
+
+  std::vector<std::unique_ptr<Server>> servers_;
+
+  /* sends the monitor callbacks of every shard */
+  Fanout fanout_;
+
+  /* asks every shard for a snapshot each snapshot interval */
+  std::thread snapshot_timer_;
+  std::mutex timer_mutex_;
+  std::condition_variable timer_cv_;
+  bool stopping_ = false;
+
+  /* reloads the rates file when it changes, woken by timer_cv_ to stop */
+  std::thread rates_watcher_;
+
+  void ChangeMode(mode m);
+
+  void ChangeLostRate(int i);
+
+  /* Load the rates file into exchange_rates, returns the line reporting how it went */
+  std::string LoadRates(const std::string& path);
+
+  void WatchRates(std::string path, std::chrono::seconds poll);
+
+};
+
+#endif /* GROUP_H */
@@ -0,0 +1,97 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <mpsc.h> file implements a bounded lock-free multi producer single consumer queue. */
+
+#ifndef MPSC_H
+#define MPSC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/* Bounded ring of cells, each tagged with a sequence number (d. vyukov's design)
+ *
+ *   producers claim a slot by a cas on the tail, write the value, then publish it by
+ *   bumping the sequence of the cell; the single consumer reads cells in order and
+ *   hands them back to producers one lap later. capacity is rounded up to a power of 2 */
+template<typename T>
+class MpscQueue
+{
+ public:
+
+  explicit MpscQueue(size_t capacity) : head_(0), tail_(0) {
+    size_t n = 2;
+    while (n < capacity) { n <<= 1; }
+    mask_ = n - 1;
+    cells_ = std::make_unique<Cell[]>(n);
+    for (size_t i = 0; i < n; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  /* Try to enqueue, returns false without blocking when the queue is full */
+  template<typename U>
+  bool TryPush(U&& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[pos & mask_];
+      size_t seq = cell.seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = std::forward<U>(value);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /* Try to dequeue, must only be called by the consumer thread */
+  bool TryPop(T& value) {
+    Cell& cell = cells_[head_ & mask_];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(head_ + 1) < 0) {
+      return false;
+    }
+    value = std::move(cell.value);
+    cell.seq.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return true;
+  }
+
+  /* Whether the queue is observed empty by the consumer */
+  bool Empty() const {
+    const Cell& cell = cells_[head_ & mask_];
+    return cell.seq.load(std::memory_order_acquire) != head_ + 1;
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  /* consumer position, only touched by the consumer thread */
+  alignas(64) size_t head_;
+  /* producer position, claimed by cas */
+  alignas(64) std::atomic<size_t> tail_;
+
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+};
+
+#endif /* MPSC_H */
@@ -0,0 +1,106 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <pool.h> file implements a free list of recycled objects and a queue of
+ * recycled slots. */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/* Objects handed out and taken back by a single thread
+ *
+ *   released objects are not destroyed, whatever storage they grew (e.g. the payload
+ *   of a request) is kept for the next user, so once the pool has warmed up acquiring
+ *   and releasing allocates nothing. every object is owned by the pool and destroyed
+ *   with it, released or not */
+template<typename T>
+class ObjectPool
+{
+ public:
+
+  ObjectPool() = default;
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  /* A free object, in the state its last user left it */
+  T* Acquire() {
+    if (free_.empty()) {
+      all_.push_back(std::make_unique<T>());
+      free_.reserve(all_.size());
+      return all_.back().get();
+    }
+    T* obj = free_.back();
+    free_.pop_back();
+    return obj;
+  }
+
+  void Release(T* obj) { free_.push_back(obj); }
+
+  /* number of objects created */
+  size_t Size() const { return all_.size(); }
+
+ private:
+
+  std::vector<std::unique_ptr<T>> all_;
+
+  std::vector<T*> free_;
+
+};
+
+/* First in first out queue of slots used by a single thread
+ *
+ *   the slots live in one array doubled when full, a pushed slot is in the state its
+ *   last user left it, so once the queue has reached its peak length pushing and
+ *   popping allocates nothing */
+template<typename T>
+class SlotQueue
+{
+ public:
+
+  SlotQueue() = default;
+
+  SlotQueue(const SlotQueue&) = delete;
+  SlotQueue& operator=(const SlotQueue&) = delete;
+
+  bool Empty() const { return size_ == 0; }
+
+  size_t Size() const { return size_; }
+
+  T& Front() { return slots_[head_]; }
+
+  /* The slot behind the last one, to be filled in by the caller */
+  T& Push() {
+    if (size_ == slots_.size()) { Grow(); }
+    T& slot = slots_[(head_ + size_) & (slots_.size() - 1)];
+    size_++;
+    return slot;
+  }
+
+  void Pop() {
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    size_--;
+  }
+
+ private:
+
+  std::vector<T> slots_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+
+  void Grow() {
+    std::vector<T> slots(std::max<size_t>(16, 2 * slots_.size()));
+    for (size_t i = 0; i < size_; ++i) {
+      slots[i] = std::move(slots_[(head_ + i) & (slots_.size() - 1)]);
+    }
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+};
+
+#endif /* POOL_H */
@@ -2,17 +2,98 @@
 
 #include "server.h"
 
-static inline void SetResponse(Response& response, int id, status_code s, const std::string& msg) {
+#include <cerrno>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#endif
+
+#include "group.h"
+
+#ifdef __linux__
+/* tags in the upper half of io_uring user data */
+static constexpr uint64_t uring_recv = 1ull << 32;
+static constexpr uint64_t uring_send = 2ull << 32;
+static constexpr uint64_t uring_wake = 3ull << 32;
+static constexpr uint64_t uring_probe = 4ull << 32;
+static constexpr uint64_t uring_tag_mask = ~0ull << 32;
+
+/* provided receive buffers: recvmsg header, client address, then the datagram */
+static constexpr unsigned uring_n_bufs = 256;
+static constexpr size_t uring_buf_len = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + in_buf_len;
+#endif
+
+/* write-ahead log record types, the first byte of every record
+ *
+ *   create:        the serialized account
+ *   erase:         account id
+ *   balance:       account id, held currencies and balances after the change
+ *   transfer:      balance of the sender after the debit of a cross shard transfer,
+ *                  then its token, receiver, currency and amount
+ *   transfer_done: token of a transfer whose credit was acknowledged, then the
+ *                  balance of its sender after any refund
+ *   credit:        origin shard and token of a credit, then the balance of the
+ *                  account it was applied to
+ *   credit_forget: origin shard and token of a credit settled by its sender
+ *
+ *   a transfer debited here is credited again after a crash until its
+ *   transfer_done is on disk, the receiver applies each (origin, token) once
+ *
+ *   logs written while balances were floats hold create_float and balance_float
+ *   records, still replayed with their amounts rounded to minor units */
+static constexpr uint8_t wal_create_float = 1;
+static constexpr uint8_t wal_erase = 2;
+static constexpr uint8_t wal_balance_float = 3;
+static constexpr uint8_t wal_create = 4;
+static constexpr uint8_t wal_balance = 5;
+static constexpr uint8_t wal_transfer = 6;
+static constexpr uint8_t wal_transfer_done = 7;
+static constexpr uint8_t wal_credit = 8;
+static constexpr uint8_t wal_credit_forget = 9;
+static constexpr size_t wal_record_len = 256;
+
+static inline void SetResponse(Response& response, int id, status_code s, std::string_view msg) {
   response.SetId(id);
   response.SetStatusCode(s);
   response.SetPayload(msg);
 }
 
+std::string_view Server::Text(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(text_.data(), text_.size(), fmt, args);
+  va_end(args);
+  return std::string_view(text_.data(), n < 0 ? 0 : std::min<size_t>(n, text_.size() - 1));
+}
+
+const char* Server::Describe(const Account& account) {
+  account.Format(account_text_.data(), account_text_.size());
+  return account_text_.data();
+}
+
 void Server::BindSocket(int port) {
   if ((sockfd_ = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
     perror("socket");
     exit(1);
   }
+  if (n_shards_ > 1) {
+    // every shard binds the same port, the kernel spreads clients by address hash
+    int on = 1;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+      perror("setsockopt");
+      close(sockfd_);
+      exit(1);
+    }
+  }
   addr_.sin_family = AF_INET;
   addr_.sin_addr.s_addr = INADDR_ANY;
   addr_.sin_port = htons(port);
@@ -23,420 +104,1447 @@ void Server::BindSocket(int port) {
   }
 }
 
-void Server::ResetIOStreams() {
-  memset(in_.data(), 0, in_buf_len);
-  memset(out_.data(), 0, out_buf_len);
-}
-
 int Server::GenRandomValue(int min, int max) {
   std::uniform_int_distribution<> distr(min, max);
   return distr(gen_);
 };
 
-void Server::StartListening(int port)  {
-  BindSocket(port);
+void Server::Start() {
+  BindSocket(port_);
+#ifdef __linux__
+  if (transport_ == transport::uring && !SetupUring()) {
+    std::cerr << "io_uring or its multishot receive is not supported, falling back to socket transport" << std::endl;
+    transport_ = transport::socket;
+  }
+#else
+  transport_ = transport::socket;
+#endif
+  // the pipe wakes a shard sleeping for handoffs or for the log, and any uring loop on stop
+  if (n_shards_ > 1 || transport_ == transport::uring || !wal_dir_.empty()) {
+    if (pipe(wake_fds_) < 0) {
+      perror("pipe");
+      exit(1);
+    }
+    fcntl(wake_fds_[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_fds_[1], F_SETFL, O_NONBLOCK);
+  }
+  if (!wal_dir_.empty()) {
+    Recover();
+  }
+#ifdef __linux__
+  in_iovs_.resize(batch_size_);
+  out_iovs_.resize(out_.size());
+  in_msgs_.resize(batch_size_);
+  out_msgs_.resize(out_.size());
+#endif
+  thread_ptr_ = std::make_unique<std::thread>(&Server::StartListening, this);
+#ifdef __linux__
+  if (n_shards_ > 1) {
+    unsigned n_cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(shard_ % n_cores, &cpus);
+    pthread_setaffinity_np(thread_ptr_->native_handle(), sizeof(cpus), &cpus);
+  }
+#endif
+}
+
+void Server::Stop() {
+  if (!thread_ptr_) { return; }
+  running_ = false;
+  if (wake_fds_[1] >= 0) {
+    char c = 0;
+    write(wake_fds_[1], &c, 1);
+  } else {
+    shutdown(sockfd_, SHUT_RDWR); // unblock the thread waiting in recvfrom
+  }
+  thread_ptr_->join();
+  thread_ptr_.reset();
+  if (wal_ && !wal_->Failed()) {
+    // a last snapshot spares the next start from replaying the log
+    ReapSnapshot(true);
+    if (wal_lsn_ != snapshot_lsn_) {
+      StartSnapshot();
+      ReapSnapshot(true);
+    }
+  }
+  wal_.reset();
+#ifdef __linux__
+  uring_.reset();
+#endif
+  close(sockfd_);
+  if (wake_fds_[0] >= 0) {
+    close(wake_fds_[0]);
+    close(wake_fds_[1]);
+  }
+}
+
+void Server::StartListening()  {
+#ifdef __linux__
+  if (uring_) {
+    ListenUring();
+    return;
+  }
+#endif
+  // a lone shard owns every account, it never receives handoffs and can block in recv
+  // unless it also waits for the log to release replies
+  bool sharded = n_shards_ > 1;
+  bool polling = sharded || wal_;
   while (running_) {
-    sockaddr_in client_addr{};
-    socklen_t client_addr_len = sizeof(client_addr);
+    if (sharded) {
+      DrainInbox();
+    }
+    if (wal_) {
+      ReleaseDurable();
+      Checkpoint();
+    }
+    if (sharded) {
+      FlushBacklog();
+    }
+    int n = Receive(!polling);
+    for (int i = 0; i < n; ++i) {
+      ProcessDatagram(in_[i].data(), in_lens_[i], in_addrs_[i].first, in_addrs_[i].second);
+    }
+    Flush();
+    if (polling && n == 0) {
+      Wait();
+    }
+  }
+}
+
+int Server::Receive(bool block) {
+#ifdef __linux__
+  if (batch_size_ > 1) {
+    for (size_t i = 0; i < batch_size_; ++i) {
+      in_iovs_[i] = iovec{in_[i].data(), in_buf_len};
+      in_msgs_[i] = mmsghdr{};
+      in_msgs_[i].msg_hdr.msg_name = &in_addrs_[i].first;
+      in_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      in_msgs_[i].msg_hdr.msg_iov = &in_iovs_[i];
+      in_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+    // when blocking, wait for one datagram then take whatever else is queued
+    int n = recvmmsg(sockfd_, in_msgs_.data(), batch_size_, block ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+    if (n < 0 || !running_) {
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && running_) { perror("recvmmsg"); }
+      return 0;
+    }
+    for (int i = 0; i < n; ++i) {
+      in_lens_[i] = in_msgs_[i].msg_len;
+      in_addrs_[i].second = in_msgs_[i].msg_hdr.msg_namelen;
+    }
+    return n;
+  }
+#endif
+  auto& [client_addr, client_addr_len] = in_addrs_[0];
+  client_addr_len = sizeof(client_addr);
+  ssize_t n = recvfrom(sockfd_, in_[0].data(), in_buf_len, block ? 0 : MSG_DONTWAIT, 
+    (sockaddr*)(&client_addr), &client_addr_len);
+  if (n < 0 || !running_) {
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && running_) { perror("recvfrom"); }
+    return 0;
+  }
+  in_lens_[0] = n;
+  return 1;
+}
 
-    ssize_t n = recvfrom(sockfd_, in_.data(), sizeof(in_), 0, (sockaddr*)(&client_addr), &client_addr_len);
-    if (n < 0) {
-      perror("recvfrom");
-      continue;
+void Server::Flush() {
+  if (n_out_ == 0) { return; }
+#ifdef __linux__
+  if (uring_) {
+    FlushUring();
+    return;
+  }
+  if (n_out_ > 1) {
+    for (size_t i = 0; i < n_out_; ++i) {
+      out_iovs_[i] = iovec{out_[i].data(), out_lens_[i]};
+      out_msgs_[i] = mmsghdr{};
+      out_msgs_[i].msg_hdr.msg_name = &out_addrs_[i].first;
+      out_msgs_[i].msg_hdr.msg_namelen = out_addrs_[i].second;
+      out_msgs_[i].msg_hdr.msg_iov = &out_iovs_[i];
+      out_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+    // sendmmsg may post only part of the batch, resume from the first unsent message
+    size_t n_sent = 0;
+    while (n_sent < n_out_) {
+      int sent = sendmmsg(sockfd_, out_msgs_.data() + n_sent, n_out_ - n_sent, 0);
+      if (sent < 0) {
+        if (running_) { perror("sendmmsg"); }
+        break;
+      }
+      n_sent += sent;
+    }
+    n_out_ = 0;
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n_out_; ++i) {
+    auto& [client_addr, client_addr_len] = out_addrs_[i];
+    ssize_t sent = sendto(sockfd_, out_[i].data(), out_lens_[i], 0, (sockaddr*)(&client_addr), client_addr_len);
+    if (sent < 0 && running_) {
+      perror("sendto");
     }
+  }
+  n_out_ = 0;
+}
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distr(1, 100);
-    
+void Server::Wait() {
+  // announce the sleep before the last look at the inbox, a producer either sees
+  // the flag and writes to the pipe, or its handoff is seen here
+  sleeping_.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!inbox_.Empty() || !running_) {
+    sleeping_.store(false);
+    return;
+  }
+  bool pending_backlog = false;
+  for (const auto& backlog : backlog_) {
+    pending_backlog = pending_backlog || !backlog.empty();
+  }
+  pollfd fds[2] = {{sockfd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+  poll(fds, 2, pending_backlog ? 1 : -1);
+  sleeping_.store(false);
+  if (fds[1].revents & POLLIN) {
+    char buf[64];
+    while (read(wake_fds_[0], buf, sizeof(buf)) > 0) {}
+  }
+}
 
-    int recv_seed = GenRandomValue(1, 100);
-    if (recv_seed < intv_start_ || recv_seed > intv_end_) {
-      controller_.WriteToConsole("experimental simulation: package lost during receiving request");
-      memset(in_.data(), 0, in_buf_len);
-      continue;
+#ifdef __linux__
+bool Server::SetupUring() {
+  uring_ = std::make_unique<Uring>();
+  unsigned entries = std::max<unsigned>(64, 2 * batch_size_ + 4);
+  if (!uring_->Init(entries) || !uring_->ProvideBufs(0, uring_n_bufs, uring_buf_len)) {
+    uring_.reset();
+    return false;
+  }
+  uring_recv_msg_.msg_namelen = sizeof(sockaddr_in);
+  uring_recv_msg_.msg_controllen = 0;
+  // a kernel without multishot recvmsg fails the receive as it is submitted, the nop
+  // behind it completes once that outcome would have been posted. a receive that
+  // is accepted stays armed for ListenUring
+  bool multishot = uring_->PrepRecvMsgMultishot(sockfd_, &uring_recv_msg_, 0, uring_recv) &&
+                   uring_->PrepNop(uring_probe);
+  bool probed = false;
+  while (multishot && !probed) {
+    io_uring_cqe cqe;
+    if (!uring_->PopCqe(cqe)) {
+      multishot = uring_->Submit(1) >= 0;
+    } else if ((cqe.user_data & uring_tag_mask) == uring_probe) {
+      probed = true;
+    } else if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      multishot = false;
+    } else {
+      uring_stash_.push_back(cqe);
     }
+  }
+  if (!multishot) {
+    uring_stash_.clear();
+    uring_.reset();
+    return false;
+  }
+  // the sends of one half of the output slots stay in flight while the other is filled
+  out_.resize(2 * batch_size_);
+  out_lens_.resize(2 * batch_size_);
+  out_addrs_.resize(2 * batch_size_);
+  return true;
+}
 
-    Request* request = new Request();
-    Response* response = new Response();
+void Server::ListenUring() {
+  uring_->PrepRead(wake_fds_[0], uring_wake_buf_, sizeof(uring_wake_buf_), uring_wake);
+  bool sharded = n_shards_ > 1;
+  while (running_) {
+    unsigned min_complete = uring_stash_.empty() ? 1 : 0;
+    if (wal_) {
+      ReleaseDurable();
+      Flush();
+      Checkpoint();
+    }
+    if (sharded) {
+      DrainInbox();
+      FlushBacklog();
+      Flush();
+      // same protocol as Wait, a producer seeing the flag writes to the wake pipe
+      sleeping_.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool pending_backlog = false;
+      for (const auto& backlog : backlog_) {
+        pending_backlog = pending_backlog || !backlog.empty();
+      }
+      if (!inbox_.Empty() || pending_backlog) { min_complete = 0; }
+    }
+    // one syscall hands the queued sends to the kernel and sleeps for completions
+    uring_->Submit(min_complete);
+    sleeping_.store(false);
+    ReapUring(false);
+    Flush();
+  }
+}
 
-    request->Deserialize(in_.data());
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-    controller_.ReceiveRpcRequest(std::string(client_ip), *request);
-    
-    Filter(request, response, client_addr, client_addr_len); // after this, response should be serialized to out
+void Server::ReapUring(bool stash) {
+  io_uring_cqe cqe;
+  while (!stash && !uring_stash_.empty()) {
+    cqe = uring_stash_.front();
+    uring_stash_.pop_front();
+    HandleUringRecv(cqe);
+  }
+  while (uring_->PopCqe(cqe)) {
+    switch (cqe.user_data & uring_tag_mask) {
+      case uring_recv: {
+        // a multishot receive ends when buffers run out or the kernel stops it, arm it
+        // again. after any other error it would only fail once more
+        if (!(cqe.flags & IORING_CQE_F_MORE) && running_) {
+          if (cqe.res >= 0 || cqe.res == -ENOBUFS) {
+            uring_->PrepRecvMsgMultishot(sockfd_, &uring_recv_msg_, 0, uring_recv);
+          } else if (running_.exchange(false)) {
+            std::cerr << "receive of shard " << shard_ << " failed, stopping the server" << std::endl;
+            kill(getpid(), SIGTERM);
+          }
+        }
+        if (stash) {
+          uring_stash_.push_back(cqe);
+        } else {
+          HandleUringRecv(cqe);
+        }
+        break;
+      }
+      case uring_send: {
+        uring_inflight_[cqe.user_data & 1]--;
+        if (cqe.res < 0) {
+          errno = -cqe.res;
+          perror("sendmsg");
+        }
+        break;
+      }
+      case uring_wake: {
+        if (running_) {
+          uring_->PrepRead(wake_fds_[0], uring_wake_buf_, sizeof(uring_wake_buf_), uring_wake);
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+}
 
-    int send_seed = GenRandomValue(1, 100);
-    if (send_seed < intv_start_ || send_seed > intv_end_) {
-      controller_.WriteToConsole("experimental simulation: package lost during posting response");
-      ResetIOStreams();
-      continue;
+void Server::HandleUringRecv(const io_uring_cqe& cqe) {
+  if (cqe.res < 0) {
+    if (cqe.res != -ENOBUFS) {
+      errno = -cqe.res;
+      perror("recvmsg");
     }
+    return;
+  }
+  if (!(cqe.flags & IORING_CQE_F_BUFFER)) { return; }
+  // the datagram is handled in place in the provided buffer, no copy to the input slots
+  uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  char* buf = uring_->GetBuf(bid);
+  auto* msg = reinterpret_cast<io_uring_recvmsg_out*>(buf);
+  auto* client_addr = reinterpret_cast<sockaddr_in*>(buf + sizeof(io_uring_recvmsg_out));
+  char* payload = buf + sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in);
+  size_t len = std::min<size_t>(msg->payloadlen, in_buf_len);
+  ProcessDatagram(payload, len, *client_addr, msg->namelen);
+  uring_->RecycleBuf(bid);
+}
 
-    ssize_t sent = sendto(sockfd_, out_.data(), sizeof(out_), 0, (sockaddr*)(&client_addr), client_addr_len);
-    if (sent < 0) {
-      perror("sendto");
+void Server::FlushUring() {
+  size_t half = out_base_ == 0 ? 0 : 1;
+  for (size_t i = out_base_; i < out_base_ + n_out_; ++i) {
+    out_iovs_[i] = iovec{out_[i].data(), out_lens_[i]};
+    out_msgs_[i] = mmsghdr{};
+    out_msgs_[i].msg_hdr.msg_name = &out_addrs_[i].first;
+    out_msgs_[i].msg_hdr.msg_namelen = out_addrs_[i].second;
+    out_msgs_[i].msg_hdr.msg_iov = &out_iovs_[i];
+    out_msgs_[i].msg_hdr.msg_iovlen = 1;
+    if (uring_->PrepSendMsg(sockfd_, &out_msgs_[i].msg_hdr, uring_send | half)) {
+      uring_inflight_[half]++;
     }
-    
-    ResetIOStreams();
+  }
+  n_out_ = 0;
+  // the sends are submitted with the next wait, switch to the other half and
+  // make sure its previous sends have completed before it is overwritten
+  half ^= 1;
+  out_base_ = half * batch_size_;
+  while (uring_inflight_[half] > 0 && running_) {
+    uring_->Submit(1);
+    ReapUring(true);
+  }
+}
+#endif
+
+void Server::ProcessDatagram(const char* in, size_t n, const sockaddr_in& client_addr, socklen_t len) {
+  int recv_seed = GenRandomValue(1, 100);
+  if (recv_seed < intv_start_ || recv_seed > intv_end_) {
+    controller_.WriteToConsole("experimental simulation: package lost during receiving request");
+    return;
+  }
+
+  Request* request = requests_.Acquire();
+  try {
+    request->Deserialize(in, n);
+  } catch (const std::runtime_error& e) {
+    controller_.WriteToConsole(std::string("dropped malformed datagram: ") + e.what());
+    requests_.Release(request);
+    return;
+  }
+  controller_.ReceiveRpcRequest(client_addr, *request);
+
+  if (n_shards_ > 1) {
+    // every op but open and monitor starts its payload with the account id
+    int owner = shard_;
+    if (request->GetOpCode() != op_code::open && request->GetOpCode() != op_code::monitor) {
+      try {
+        int id;
+        Reader in = request->GetReader();
+        des(in, id);
+        owner = OwnerOf(id);
+      } catch (const std::runtime_error&) {
+        // too short to name an account, served here and answered with an error
+      }
+    }
+    if (owner != shard_) {
+      Handoff h{};
+      h.kind_ = Handoff::kind::request;
+      h.origin_ = shard_;
+      h.client_addr_ = client_addr;
+      h.client_addr_len_ = len;
+      memcpy(h.data_.data(), in, n);
+      h.data_len_ = n;
+      Forward(owner, std::move(h));
+      requests_.Release(request);
+      return;
+    }
+  }
+
+  Serve(request, client_addr, len);
+}
+
+void Server::Serve(Request* request, const sockaddr_in& client_addr, socklen_t len) {
+  Response* response = responses_.Acquire();
+  // a recycled response keeps the fields of its last use
+  response->SetVersion(request->GetVersion());
+  SetResponse(*response, request->GetId(), status_code::error, {});
+  Filter(request, response, client_addr, len); // after this, response should be queued to out
+}
+
+bool Server::DropReply() {
+  int send_seed = GenRandomValue(1, 100);
+  if (send_seed < intv_start_ || send_seed > intv_end_) {
+    controller_.WriteToConsole("experimental simulation: package lost during posting response");
+    return true;
+  }
+  return false;
+}
+
+void Server::Reply(const Response& response, const sockaddr_in& client_addr, socklen_t len) {
+  controller_.PostRpcResponse(client_addr, response);
+  if (DropReply()) { return; }
+  if (MustHold()) {
+    HeldReply& held = held_replies_.Push();
+    held.lsn_ = wal_lsn_;
+    held.len_ = response.Serialize(held.data_.data());
+    held.client_addr_ = client_addr;
+    held.client_addr_len_ = len;
+    return;
+  }
+  if (n_out_ == batch_size_) { Flush(); }
+  size_t slot = out_base_ + n_out_;
+  out_lens_[slot] = response.Serialize(out_[slot].data());
+  out_addrs_[slot] = {client_addr, len};
+  n_out_++;
+}
+
+void Server::Replay(const DedupCache::Entry& entry, const sockaddr_in& client_addr, socklen_t len) {
+  controller_.PostRpcResponse(client_addr, entry.key_.id_, static_cast<status_code>(entry.code_));
+  if (DropReply()) { return; }
+  char* out;
+  if (MustHold()) {
+    HeldReply& held = held_replies_.Push();
+    held.lsn_ = wal_lsn_;
+    held.len_ = entry.frame_len_;
+    held.client_addr_ = client_addr;
+    held.client_addr_len_ = len;
+    out = held.data_.data();
+  } else {
+    if (n_out_ == batch_size_) { Flush(); }
+    size_t slot = out_base_ + n_out_;
+    out_lens_[slot] = entry.frame_len_;
+    out_addrs_[slot] = {client_addr, len};
+    n_out_++;
+    out = out_[slot].data();
+  }
+  std::memcpy(out, entry.Data(), entry.len_);
+  std::memset(out + entry.len_, 0, entry.frame_len_ - entry.len_);
+}
+
+const DedupCache::Entry& Server::Record(const Response& response, const sockaddr_in& client_addr) {
+  char buf[out_buf_len];
+  size_t frame_len = response.Serialize(buf);
+  size_t n = frame_len;
+  if (response.GetVersion() == wire_version::v1) {
+    // keep the message without the zero padding of the v1 frame
+    constexpr size_t header_len = 2 * sizeof(int);
+    n = header_len + strnlen(buf + header_len, payload_size);
+  }
+  return dedup_.Complete(KeyOf(client_addr, response.GetId()), static_cast<int>(response.GetStatusCode()),
+    buf, n, frame_len, NowMs());
+}
+
+/* Write-ahead log */
+
+void Server::Recover() {
+  wal_ = std::make_unique<Wal>();
+  std::string path = WalPath();
+  uint64_t from = 0;
+  bool loaded = LoadSnapshot(from);
+  size_t n_records = 0;
+  bool ok = wal_->Open(path, from, [this, &n_records](const char* record, size_t n) {
+    ApplyWalRecord(record, n);
+    ++n_records;
+  }, [this]() {
+    // wake the loop to release the replies covered by the sync
+    char c = 0;
+    write(wake_fds_[1], &c, 1);
+  });
+  if (!ok) {
+    std::cerr << "cannot open " << path << ", running without write-ahead log" << std::endl;
+    wal_.reset();
+    return;
+  }
+  if (loaded || n_records > 0) {
+    std::cerr << "shard " << shard_ << " recovered " << accounts_.Size() << " accounts from " 
+      << (loaded ? "its snapshot and " : "") << n_records << " log records" << std::endl;
+  }
+  ResendCredits();
+}
+
+void Server::ResendCredits() {
+  if (pending_.empty()) { return; }
+  std::cerr << "shard " << shard_ << " credits " << pending_.size() << " unsettled transfers again" << std::endl;
+  // the peers' inboxes exist before any shard starts, they drain them once recovered
+  for (const auto& [token, p] : pending_) {
+    Handoff h{};
+    h.kind_ = Handoff::kind::credit;
+    h.origin_ = shard_;
+    h.token_ = token;
+    h.account_id_ = p.receiver_id_;
+    h.cur_ = p.cur_;
+    h.amount_ = p.amount_;
+    Forward(OwnerOf(p.receiver_id_), std::move(h));
+  }
+}
+
+/* Account of a create_float record */
+static Account FloatAccount(Reader& in) {
+  int id;
+  std::string_view user_name, password;
+  size_t n = 0;
+  des(in, id, user_name, password, n);
+  Account account;
+  account.SetId(id);
+  account.SetUserName(user_name);
+  account.SetPassword(password);
+  for (size_t k = 0; k < n; ++k) {
+    currency c;
+    float amount;
+    des(in, c, amount);
+    account.SetBalance(c, Money::FromDecimal(amount, c));
+  }
+  return account;
+}
+
+void Server::ApplyWalRecord(const char* record, size_t n) {
+  // every field is checked against the length of the record, a record that does not
+  // decode is reported and skipped. the credentials of a create_float record may also
+  // exceed the shorter limit of the fixed point record
+  Reader in(record, n);
+  try {
+    uint8_t op;
+    des(in, op);
+    switch (op) {
+      case wal_create:
+      case wal_create_float: {
+        Account account;
+        if (op == wal_create) {
+          account.Deserialize(in);
+        } else {
+          account = FloatAccount(in);
+        }
+        if (!accounts_.Insert(account)) {
+          std::cerr << "log of shard " << shard_ << " holds account " << account.GetId() 
+            << " of another shard, was the number of shards changed?" << std::endl;
+        }
+        break;
+      }
+      case wal_erase: {
+        int id;
+        des(in, id);
+        accounts_.Erase(id);
+        break;
+      }
+      case wal_balance: {
+        int id;
+        uint8_t held;
+        std::array<Money, n_currencies> balance;
+        des(in, id, held, balance);
+        ApplyBalance(id, held, balance);
+        break;
+      }
+      case wal_transfer: {
+        int id;
+        uint8_t held;
+        std::array<Money, n_currencies> balance;
+        uint64_t token;
+        PendingTransfer p{nullptr, {}, 0, false, 0, 0, currency::usd, Money()};
+        des(in, id, held, balance, token, p.receiver_id_, p.cur_, p.amount_);
+        ApplyBalance(id, held, balance);
+        p.sender_id_ = id;
+        pending_[token] = p;
+        pending_ctr_ = std::max(pending_ctr_, token + 1);
+        break;
+      }
+      case wal_transfer_done: {
+        uint64_t token;
+        int id;
+        uint8_t held;
+        std::array<Money, n_currencies> balance;
+        des(in, token, id, held, balance);
+        ApplyBalance(id, held, balance);
+        pending_.erase(token);
+        pending_ctr_ = std::max(pending_ctr_, token + 1);
+        break;
+      }
+      case wal_credit: {
+        int origin;
+        uint64_t token;
+        int id;
+        uint8_t held;
+        std::array<Money, n_currencies> balance;
+        des(in, origin, token, id, held, balance);
+        ApplyBalance(id, held, balance);
+        credited_.insert(CreditKey(origin, token));
+        break;
+      }
+      case wal_credit_forget: {
+        int origin;
+        uint64_t token;
+        des(in, origin, token);
+        credited_.erase(CreditKey(origin, token));
+        break;
+      }
+      case wal_balance_float: {
+        int id;
+        uint8_t held;
+        std::array<float, n_currencies> balance;
+        des(in, id, held, balance);
+        if (Account* account = accounts_.Find(id)) {
+          for (size_t c = 0; c < n_currencies; ++c) {
+            auto cur = static_cast<currency>(c);
+            if (held & (1u << c)) { account->SetBalance(cur, Money::FromDecimal(balance[c], cur)); }
+          }
+        }
+        break;
+      }
+      default: break;
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << "log of shard " << shard_ << " holds a record that cannot be restored: " << e.what() << std::endl;
+  }
+}
+
+void Server::LogCreate(const Account& account) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_create);
+  n += account.Serialize(record.data() + n);
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogErase(int id) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_erase, id);
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogBalance(const Account& account) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_balance, account.GetId(), account.GetHeld(), account.GetBalance());
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogTransfer(const Account& sender, uint64_t token, const PendingTransfer& p) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_transfer, sender.GetId(), sender.GetHeld(), sender.GetBalance(),
+    token, p.receiver_id_, p.cur_, p.amount_);
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogTransferDone(uint64_t token, int sender_id, const Account* sender) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  // a closed sender holds nothing, its balances are not restored
+  size_t n = ser(record.data(), wal_transfer_done, token, sender_id, sender ? sender->GetHeld() : uint8_t(0),
+    sender ? sender->GetBalance() : std::array<Money, n_currencies>{});
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogCredit(int origin, uint64_t token, const Account& account) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_credit, origin, token, account.GetId(), account.GetHeld(), account.GetBalance());
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::LogCreditForget(int origin, uint64_t token) {
+  if (!wal_) { return; }
+  std::array<char, wal_record_len> record;
+  size_t n = ser(record.data(), wal_credit_forget, origin, token);
+  wal_lsn_ = wal_->Append(record.data(), n);
+}
+
+void Server::ApplyBalance(int id, uint8_t held, const std::array<Money, n_currencies>& balance) {
+  if (Account* account = accounts_.Find(id)) {
+    for (size_t c = 0; c < n_currencies; ++c) {
+      if (held & (1u << c)) { account->SetBalance(static_cast<currency>(c), balance[c]); }
+    }
+  }
+}
+
+/* Snapshots */
+
+void Server::RequestSnapshot() {
+  if (wal_dir_.empty()) { return; }
+  snapshot_due_.store(true);
+  if (wake_fds_[1] >= 0) {
+    char c = 0;
+    write(wake_fds_[1], &c, 1);
+  }
+}
+
+void Server::Checkpoint() {
+  if (snapshot_pid_ > 0) {
+    ReapSnapshot(false);
+  }
+  if (snapshot_due_.load(std::memory_order_relaxed)) {
+    snapshot_due_.store(false);
+    // nothing changed since the last one, or the last one is still being written
+    if (wal_lsn_ != snapshot_lsn_ && snapshot_pid_ < 0) {
+      StartSnapshot();
+    }
+  }
+}
+
+void Server::StartSnapshot() {
+  std::string path = SnapshotPath();
+  std::string tmp_path = path + ".tmp";
+  pid_t parent = getpid();
+  pid_t pid = fork();
+  if (pid == 0) {
+    /* a child outliving a killed server would publish its snapshot against the
+     *   log of the next run, whose records at that offset are not ours */
+#ifdef __linux__
+    if (prctl(PR_SET_PDEATHSIG, SIGKILL) < 0) {
+      _exit(1);
+    }
+#endif
+    if (getppid() != parent) {
+      _exit(1);
+    }
+    WriteSnapshot(tmp_path.c_str(), path.c_str());
+  }
+  if (pid < 0) {
+    perror("fork");
+    return;
+  }
+  snapshot_pid_ = pid;
+  snapshot_pending_lsn_ = wal_lsn_;
+}
+
+void Server::ReapSnapshot(bool block) {
+  if (snapshot_pid_ < 0) { return; }
+  int status = 0;
+  pid_t r = waitpid(snapshot_pid_, &status, block ? 0 : WNOHANG);
+  if (r == 0) { return; }
+  snapshot_pid_ = -1;
+  if (r > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    snapshot_lsn_ = snapshot_pending_lsn_;
+  } else {
+    controller_.WriteToConsole("snapshot of shard " + std::to_string(shard_) + " failed");
+  }
+}
+
+void Server::WriteSnapshot(const char* tmp_path, const char* path) {
+  // forked from a multithreaded process, only syscalls and no allocation from here on
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) { _exit(1); }
+  SnapshotHeader header{};
+  std::memcpy(header.magic_, snapshot_magic, sizeof(snapshot_magic));
+  header.version_ = snapshot_version;
+  header.account_size_ = sizeof(Account);
+  header.shard_ = shard_;
+  header.n_shards_ = n_shards_;
+  header.wal_offset_ = wal_->Base() + wal_lsn_;
+  header.n_slots_ = accounts_.Slots();
+  header.n_chunks_ = accounts_.Chunks();
+
+  SnapshotWriter writer(fd);
+  writer.Write(&header, sizeof(header));
+  writer.Pad(snapshot_align);
+  header.accounts_off_ = writer.Offset();
+  for (size_t k = 0; k < accounts_.Chunks(); ++k) {
+    writer.Write(accounts_.Chunk(k), AccountStore::chunk_size * sizeof(Account));
+  }
+  header.live_off_ = writer.Offset();
+  writer.Write(accounts_.Live().data(), accounts_.Live().size() * sizeof(uint64_t));
+  header.history_off_ = writer.Offset();
+  dedup_.ForEach([&writer, &header](const DedupCache::Entry& entry) {
+    SnapshotReply reply{entry.key_.ip_, entry.key_.port_, entry.frame_len_, entry.key_.id_, entry.code_, entry.len_};
+    writer.Write(&reply, sizeof(reply));
+    writer.Write(entry.Data(), entry.len_);
+    header.n_history_++;
+  });
+  header.transfers_off_ = writer.Offset();
+  for (const auto& [token, p] : pending_) {
+    SnapshotTransfer transfer{token, p.sender_id_, p.receiver_id_, static_cast<int32_t>(p.cur_), 0, p.amount_.units_};
+    writer.Write(&transfer, sizeof(transfer));
+    header.n_transfers_++;
+  }
+  header.credits_off_ = writer.Offset();
+  for (uint64_t key : credited_) {
+    writer.Write(&key, sizeof(key));
+    header.n_credits_++;
+  }
+  header.next_token_ = pending_ctr_;
+  bool ok = writer.Finish() && pwrite(fd, &header, sizeof(header), 0) == sizeof(header) && fsync(fd) == 0;
+  close(fd);
+  // the snapshot holds every record up to wal_offset_, some may still sit in the
+  // batch of the syncer: publish it only once they are on disk too
+  if (!ok || !wal_->SyncTo(header.wal_offset_, snapshot_sync_timeout_ms) || rename(tmp_path, path) < 0) {
+    unlink(tmp_path);
+    _exit(1);
+  }
+  // make the rename durable
+  int dir = open(wal_dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+  _exit(0);
+}
+
+bool Server::LoadSnapshot(uint64_t& wal_offset) {
+  std::string path = SnapshotPath();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) { return false; }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  // private and writable, the accounts are updated in place and never written back
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror("mmap snapshot");
+    return false;
+  }
+  const char* p = static_cast<const char*>(base);
+  SnapshotHeader header;
+  std::memcpy(&header, p, sizeof(header));
+  size_t live_len = header.n_chunks_ * AccountStore::chunk_size / 64 * sizeof(uint64_t);
+  bool valid = std::memcmp(header.magic_, snapshot_magic, sizeof(snapshot_magic)) == 0 &&
+    header.version_ == snapshot_version && header.account_size_ == sizeof(Account) &&
+    header.shard_ == shard_ && header.n_shards_ == n_shards_ &&
+    header.n_slots_ <= header.n_chunks_ * AccountStore::chunk_size &&
+    header.accounts_off_ % snapshot_align == 0 &&
+    header.live_off_ == header.accounts_off_ + header.n_chunks_ * AccountStore::chunk_size * sizeof(Account) &&
+    header.history_off_ == header.live_off_ + live_len && header.history_off_ <= size &&
+    header.transfers_off_ >= header.history_off_ && header.transfers_off_ <= size &&
+    header.n_transfers_ <= (size - header.transfers_off_) / sizeof(SnapshotTransfer) &&
+    header.credits_off_ == header.transfers_off_ + header.n_transfers_ * sizeof(SnapshotTransfer) &&
+    header.n_credits_ <= (size - header.credits_off_) / sizeof(uint64_t);
+  if (!valid) {
+    std::cerr << "ignoring snapshot " << path << ", it does not match this build or configuration" << std::endl;
+    munmap(base, size);
+    return false;
+  }
+  // a snapshot is published after the log it covers, one ahead of the log is corrupt
+  struct stat wal_st;
+  uint64_t wal_size = stat(WalPath().c_str(), &wal_st) == 0 ? static_cast<uint64_t>(wal_st.st_size) : 0;
+  if (header.wal_offset_ > wal_size) {
+    std::cerr << "ignoring snapshot " << path << ", it covers " << header.wal_offset_ << " bytes of a "
+      << wal_size << " byte log" << std::endl;
+    munmap(base, size);
+    return false;
+  }
+  std::shared_ptr<void> mapping(base, [size](void* b) { munmap(b, size); });
+  accounts_.Adopt(reinterpret_cast<Account*>(static_cast<char*>(base) + header.accounts_off_),
+    header.n_chunks_, header.n_slots_, reinterpret_cast<const uint64_t*>(p + header.live_off_), mapping);
+
+  // replies restart their ttl, in the order they were used
+  size_t off = header.history_off_;
+  int64_t now = NowMs();
+  for (uint64_t i = 0; i < header.n_history_ && off + sizeof(SnapshotReply) <= size; ++i) {
+    SnapshotReply reply;
+    std::memcpy(&reply, p + off, sizeof(reply));
+    off += sizeof(reply);
+    if (reply.len_ > size - off || reply.len_ > reply.frame_len_) { break; }
+    dedup_.Complete(DedupKey{reply.ip_, reply.port_, reply.id_}, reply.code_, p + off, reply.len_,
+      reply.frame_len_, now);
+    off += reply.len_;
+  }
+  for (uint64_t i = 0; i < header.n_transfers_; ++i) {
+    SnapshotTransfer transfer;
+    std::memcpy(&transfer, p + header.transfers_off_ + i * sizeof(transfer), sizeof(transfer));
+    if (transfer.cur_ < 0 || transfer.cur_ >= static_cast<int32_t>(n_currencies)) { continue; }
+    pending_[transfer.token_] = PendingTransfer{nullptr, {}, 0, false, transfer.sender_id_, transfer.receiver_id_,
+      static_cast<currency>(transfer.cur_), Money(transfer.amount_)};
+  }
+  for (uint64_t i = 0; i < header.n_credits_; ++i) {
+    uint64_t key;
+    std::memcpy(&key, p + header.credits_off_ + i * sizeof(key), sizeof(key));
+    credited_.insert(key);
+  }
+  pending_ctr_ = header.next_token_;
+  wal_offset = header.wal_offset_;
+  return true;
+}
+
+void Server::ReleaseDurable() {
+  if (wal_->Failed()) {
+    // the held replies and acks and every later change can never be made durable,
+    // stop serving rather than leave clients waiting or acknowledge lost updates
+    if (running_.exchange(false)) {
+      std::cerr << "write-ahead log of shard " << shard_ << " failed, stopping the server" << std::endl;
+      kill(getpid(), SIGTERM);
+    }
+    return;
+  }
+  uint64_t durable = wal_->Durable();
+  while (!held_replies_.Empty() && held_replies_.Front().lsn_ <= durable) {
+    HeldReply& held = held_replies_.Front();
+    if (n_out_ == batch_size_) { Flush(); }
+    size_t slot = out_base_ + n_out_;
+    std::memcpy(out_[slot].data(), held.data_.data(), held.len_);
+    out_lens_[slot] = held.len_;
+    out_addrs_[slot] = {held.client_addr_, held.client_addr_len_};
+    n_out_++;
+    held_replies_.Pop();
+  }
+  while (!held_acks_.Empty() && held_acks_.Front().lsn_ <= durable) {
+    HeldAck& held = held_acks_.Front();
+    Forward(held.shard_, std::move(held.ack_));
+    held_acks_.Pop();
   }
 }
 
 void Server::ChangeMode(mode m) { 
   mode_ = m; 
-  controller_.WriteToConsole("mode changed to " + mode_to_str(m));
 }
 
 void Server::ChangeLostRate(int i) {
   intv_start_ = i;
 }
 
+/* Sharding */
+
+int Server::OwnerOf(int account_id) const {
+  return ((account_id % n_shards_) + n_shards_) % n_shards_;
+}
+
+bool Server::Post(Handoff&& h) {
+  if (!inbox_.TryPush(std::move(h))) { return false; }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.exchange(false)) {
+    char c = 0;
+    write(wake_fds_[1], &c, 1);
+  }
+  return true;
+}
+
+void Server::Forward(int shard, Handoff&& h) {
+  // keep the order of handoffs to a peer, never overtake the backlog
+  auto& backlog = backlog_[shard];
+  if (backlog.empty() && group_.GetServer(shard).Post(std::move(h))) { return; }
+  backlog.push_back(std::move(h));
+}
+
+void Server::FlushBacklog() {
+  for (int shard = 0; shard < n_shards_; ++shard) {
+    auto& backlog = backlog_[shard];
+    while (!backlog.empty() && group_.GetServer(shard).Post(std::move(backlog.front()))) {
+      backlog.pop_front();
+    }
+  }
+}
+
+void Server::DrainInbox() {
+  Handoff h;
+  while (inbox_.TryPop(h)) {
+    switch (h.kind_) {
+      case Handoff::kind::request: {
+        Request* request = requests_.Acquire();
+        request->Deserialize(h.data_.data(), h.data_len_);
+        Serve(request, h.client_addr_, h.client_addr_len_);
+        break;
+      }
+      case Handoff::kind::credit: {
+        HandleCredit(h);
+        break;
+      }
+      case Handoff::kind::credit_ack: {
+        HandleCreditAck(h);
+        break;
+      }
+      case Handoff::kind::credit_done: {
+        HandleCreditDone(h);
+        break;
+      }
+    }
+  }
+}
+
+void Server::HandleCredit(const Handoff& h) {
+  Handoff ack{};
+  ack.kind_ = Handoff::kind::credit_ack;
+  ack.origin_ = shard_;
+  ack.token_ = h.token_;
+  uint64_t key = CreditKey(h.origin_, h.token_);
+  Account* account = accounts_.Find(h.account_id_);
+  if (credited_.contains(key)) {
+    // sent again by a sender recovering from a crash, applied before it
+    ack.ok_ = true;
+  } else if (!account) {
+    ack.ok_ = false;
+  } else if (!account->Deposit(h.cur_, h.amount_)) {
+    ack.ok_ = false;
+    ack.full_ = true;
+  } else {
+    LogCredit(h.origin_, h.token_, *account);
+    if (wal_) { credited_.insert(key); }
+    controller_.Deposit(*account);
+    InvokeDelta(CallbackTopic{op_code::transfer, account->GetId(), -1, h.cur_, h.amount_}, BalanceDelta::Of(*account));
+    ack.ok_ = true;
+  }
+  // the sender only answers its client once the ack arrives, so the credit must be
+  // durable by then
+  ForwardDurable(h.origin_, std::move(ack));
+}
+
+void Server::HandleCreditAck(const Handoff& h) {
+  auto node = pending_.extract(h.token_);
+  if (node.empty()) { return; }
+  PendingTransfer& p = node.mapped();
+  Response* response = p.response_;
+  Account* sender = accounts_.Find(p.sender_id_);
+  status_code code = status_code::success;
+  std::string_view msg;
+  bool refunded = false;
+  if (!h.ok_) { 
+    // the receiver does not exist or cannot hold the amount, refund the sender. it
+    // cannot be closed meanwhile, but its balance may have grown too large
+    refunded = sender && sender->Deposit(p.cur_, p.amount_);
+    if (refunded) {
+      controller_.Deposit(*sender);
+      InvokeDelta(CallbackTopic{op_code::transfer, p.sender_id_, -1, p.cur_, p.amount_}, BalanceDelta::Of(*sender));
+    }
+    if (!refunded) {
+      // the amount is lost, say so to the client and on the console
+      code = status_code::error;
+      msg = Text("transfer to account with id: %d failed and its refund of %s %s overflows the balance "
+        "of account with id: %d", p.receiver_id_, MoneyText(p.amount_, p.cur_).text_, currency_name(p.cur_),
+        p.sender_id_);
+      controller_.WriteToConsole(msg);
+    } else if (h.full_) {
+      code = status_code::fail;
+      msg = Text("balance of account with id: %d cannot hold the amount", p.receiver_id_);
+    } else {
+      code = status_code::error;
+      msg = Text("account not found with id: %d", p.receiver_id_);
+    }
+  } else {
+    msg = Text("transferred %s %s to account with id: %d", 
+      MoneyText(p.amount_, p.cur_).text_, currency_name(p.cur_), p.receiver_id_);
+    controller_.WriteToConsole(msg);
+    InvokeCallback(CallbackTopic{op_code::transfer, p.sender_id_, p.receiver_id_, p.cur_, p.amount_}, msg);
+  }
+  // settled with the refund, if any, in one record. the receiver keeps the credit
+  // until this is durable, a crash before would credit it again
+  LogTransferDone(h.token_, p.sender_id_, sender);
+  if (h.ok_ && wal_) {
+    Handoff done{};
+    done.kind_ = Handoff::kind::credit_done;
+    done.origin_ = shard_;
+    done.token_ = h.token_;
+    ForwardDurable(h.origin_, std::move(done));
+  }
+  if (!response) {
+    // recovered from the log, its client was answered by nobody
+    if (refunded) { controller_.WriteToConsole(msg); }
+    return;
+  }
+  SetResponse(*response, response->GetId(), code, msg);
+  if (p.record_) {
+    Replay(Record(*response, p.client_addr_), p.client_addr_, p.client_addr_len_);
+  } else {
+    Reply(*response, p.client_addr_, p.client_addr_len_);
+  }
+  responses_.Release(response);
+}
+
+void Server::HandleCreditDone(const Handoff& h) {
+  if (credited_.erase(CreditKey(h.origin_, h.token_)) > 0) {
+    LogCreditForget(h.origin_, h.token_);
+  }
+}
+
+void Server::ForwardDurable(int shard, Handoff&& h) {
+  if (wal_ && (!held_acks_.Empty() || wal_lsn_ > wal_->Durable())) {
+    held_acks_.Push() = HeldAck{wal_lsn_, shard, std::move(h)};
+    return;
+  }
+  Forward(shard, std::move(h));
+}
+
 void Server::Filter(Request* request, Response* response, const sockaddr_in& client_addr, socklen_t len) {
-  switch (mode_) {
+  switch (mode_.load()) {
     case mode::at_least_once: {
       // perform request again, but do not record them in history
       Dispatch(request, response, client_addr, len);
-      response->Serialize(out_.data());
-      char client_ip[INET_ADDRSTRLEN];
-      inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-      controller_.PostRpcResponse(std::string(client_ip), *response);
-      delete request;
-      delete response;
-      request = nullptr;
-      response = nullptr;
+      requests_.Release(request);
+      if (deferred_) { // response is posted once the transfer completes
+        deferred_ = nullptr;
+        return;
+      }
+      Reply(*response, client_addr, len);
+      responses_.Release(response);
       return;
     }
     case mode::at_most_once: {
-      auto iter = requests_.find(request->GetId());
-      if (iter != requests_.end()) { // duplicated request
-        // return previous response outcome to the client
-        auto iter_resp = responses_.find(request->GetId());
-        response = iter_resp->second;
-        response->Serialize(out_.data());
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-        controller_.PostRpcResponse(std::string(client_ip), *response);
-        response = nullptr;
-        delete request;
-        request = nullptr;
-      } else {
-        Dispatch(request, response, client_addr, len);
-        requests_[request->GetId()] = request;
-        responses_[request->GetId()] = response;
-        response->Serialize(out_.data());
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-        controller_.PostRpcResponse(std::string(client_ip), *response);
+      DedupKey key = KeyOf(client_addr, request->GetId());
+      int64_t now = NowMs();
+      if (const DedupCache::Entry* seen = dedup_.Find(key, now)) { // duplicated request
+        // return previous response outcome to the client, unless the original
+        // request is still waiting for another shard
+        if (seen->done_) {
+          Replay(*seen, client_addr, len);
+        }
+        requests_.Release(request);
+        responses_.Release(response);
+        return;
       }
+      dedup_.Reserve(key, now);
+      Dispatch(request, response, client_addr, len);
+      requests_.Release(request);
+      if (deferred_) {
+        deferred_->record_ = true;
+        deferred_ = nullptr;
+        return;
+      }
+      Replay(Record(*response, client_addr), client_addr, len);
+      responses_.Release(response);
       return;
     } // ignore
-    default: return;
+    default: {
+      requests_.Release(request);
+      responses_.Release(response);
+      return;
+    }
   }
 }
 
-void Server::Dispatch(Request* request, Response* response, const sockaddr_in& client_addr, socklen_t len) {
-  switch (request->GetOpCode()) {
-    case op_code::open: {
-      HandleCreateAccount(*request, *response);
-      break;
-    }
-    case op_code::close: {
-      HandleDeleteAccount(*request, *response);
-      break;
-    } 
-    case op_code::check_balance: {
-      HandleCheckBalance(*request, *response);
-      break;
-    }
-    case op_code::deposit: {
-      HandleDeposit(*request, *response);
-      break;
-    }
-    case op_code::withdraw: {
-      HandleWithdraw(*request, *response);
-      break;
-    }
-    case op_code::transfer: {
-      HandleTransfer(*request, *response);
-      break;
-    }
-    case op_code::exchange: {
-      HandleExchange(*request, *response);
-      break; 
-    }
-    case op_code::monitor: {
-      HandleMonitor(*request, *response, client_addr, len);
-      break;
+template<typename M, auto handler, auto id>
+class Server::Op
+{
+ public:
+
+  static constexpr op_code code = M::code;
+
+  static void Run(Server& server, Call& call) {
+    M msg = decode<M>(call.request_);
+    if constexpr (id != nullptr) {
+      call.account_ = server.Authenticate(call, msg.*id, msg.user_name_, msg.password_);
+      if (!call.account_) { return; }
     }
-    default: return;
+    (server.*handler)(call, msg);
+  }
+};
+
+void Server::Dispatch(Request* request, Response* response, const sockaddr_in& client_addr, socklen_t len) {
+  // one entry per op, in the order of the op codes
+  using ops = std::tuple<
+    Op<OpenRequest, &Server::HandleCreateAccount>,
+    Op<CloseRequest, &Server::HandleDeleteAccount, &CloseRequest::id_>,
+    Op<CheckBalanceRequest, &Server::HandleCheckBalance, &CheckBalanceRequest::id_>,
+    Op<DepositRequest, &Server::HandleDeposit, &DepositRequest::id_>,
+    Op<WithdrawRequest, &Server::HandleWithdraw, &WithdrawRequest::id_>,
+    Op<TransferRequest, &Server::HandleTransfer, &TransferRequest::sender_id_>,
+    Op<ExchangeRequest, &Server::HandleExchange, &ExchangeRequest::id_>,
+    Op<MonitorRequest, &Server::HandleMonitor>>;
+  static constexpr auto table = []<size_t... I>(std::index_sequence<I...>) {
+    static_assert(((op_code_to_int(std::tuple_element_t<I, ops>::code) == static_cast<int>(I) + 1) && ...),
+                  "ops out of order");
+    return std::array<OpRunner, sizeof...(I)>{&std::tuple_element_t<I, ops>::Run...};
+  }(std::make_index_sequence<std::tuple_size_v<ops>>{});
+
+  size_t op = static_cast<size_t>(op_code_to_int(request->GetOpCode())) - 1;
+  if (op >= table.size()) { return; }
+  Call call{*request, *response, client_addr, len, nullptr};
+  // a malformed payload is answered with an error
+  try {
+    table[op](*this, call);
+  } catch (const std::runtime_error& e) {
+    SetResponse(*response, request->GetId(), status_code::error, std::string("invalid request: ") + e.what());
   }
 }
 
-void Server::HandleCreateAccount(const Request& request, Response& response) {
-  size_t i = 0;
-  int id = account_id_ctr_++;
-  std::string user_name;
-  std::string password;
-  float balance;
-  currency currency;
+Account* Server::Authenticate(Call& call, int id, std::string_view user_name, std::string_view password) {
+  Account* account = accounts_.Find(id);
+  if (!account) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::error, Text("account not found with id: %d", id));
+  } else if (user_name != account->GetUserName()) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "authentication fails: username not correct");
+  } else if (password != account->GetPassword()) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "authentication fails: password not correct");
+  } else {
+    return account;
+  }
+  return nullptr;
+}
 
-  des(request.GetPayload(), user_name, password, balance, currency);
-  Account* account = new Account(id, user_name, password, currency, balance);
-  accounts_[id] = account;
+void Server::HandleCreateAccount(Call& call, const OpenRequest& msg) {
+  if (!msg.balance_.Valid()) {
+    SetResponse(call.response_, call.request_.GetId(), status_code::fail, "invalid amount");
+    return;
+  }
+  Account* account = &accounts_.Create(msg.user_name_, msg.password_, msg.currency_, msg.balance_);
+  LogCreate(*account);
 
   controller_.CreateAccount(*account);
 
-  SetResponse(response, request.GetId(), status_code::success, "account created: " + account->ToString());
+  std::string_view text = Text("account created: %s", Describe(*account));
+  SetResponse(call.response_, call.request_.GetId(), status_code::success, text);
 
-  InvokeCallback("account created: " + account->ToString()); 
+  InvokeCallback(CallbackTopic{op_code::open, account->GetId(), -1, msg.currency_, msg.balance_}, text);
+  InvokeDelta(CallbackTopic{op_code::open, account->GetId(), -1, msg.currency_, msg.balance_}, BalanceDelta::Of(*account));
 }
 
-void Server::HandleDeleteAccount(const Request& request, Response& response) {
-  size_t i = 0;
-  int id;
-  std::string user_name;
-  std::string password;
-  i += des(request.GetPayload(), id, user_name, password);
-
-  auto iter = accounts_.find(id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
-  } else { // delete
-    delete iter->second;
-    accounts_.erase(iter);
-    std::unique_ptr<Account> account = std::make_unique<Account>();
-    account->SetId(id);
-    controller_.DeleteAccount(*account);
-    SetResponse(response, request.GetId(),
-      status_code::success, "successfully remove the account with id: " + std::to_string(id));
-    InvokeCallback("account with id: " + std::to_string(id) + "deleted");
-  }  
-}
-
-void Server::HandleCheckBalance(const Request& request, Response& response) {
-  size_t i = 0;
-  int id;
-  std::string user_name;
-  std::string password;
-  currency cur_unit;
-  i += des(request.GetPayload(), id, user_name, password, cur_unit);
-
-  auto iter = accounts_.find(id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
-  } else {
-    float bal = iter->second->GetBalance(cur_unit);
-    SetResponse(response, request.GetId(), 
-      status_code::success, "your current account balance is: " + std::to_string(bal));
+void Server::HandleDeleteAccount(Call& call, const CloseRequest& msg) {
+  int id = msg.id_;
+  // a transfer still waiting for its receiver may have to refund this account
+  if (std::ranges::any_of(pending_, [id](const auto& entry) { return entry.second.sender_id_ == id; })) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, Text("account with id: %d has transfers in flight, try again later", id));
+    return;
   }
+  controller_.DeleteAccount(*call.account_);
+  accounts_.Erase(id);
+  LogErase(id);
+  SetResponse(call.response_, call.request_.GetId(),
+    status_code::success, Text("successfully remove the account with id: %d", id));
+  InvokeCallback(CallbackTopic{op_code::close, id, -1, currency::usd, Money()}, Text("account with id: %ddeleted", id));
+  InvokeDelta(CallbackTopic{op_code::close, id, -1, currency::usd, Money()}, BalanceDelta::Closed(id));
 }
 
-void Server::HandleDeposit(const Request& request, Response& response) {
-  int id;
-  std::string user_name;
-  std::string password;
-  currency cur_unit;
-  float amount;
-  des(request.GetPayload(), id, user_name, password, cur_unit, amount);
-
-  auto iter = accounts_.find(id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
-  } else {
-    float orig_bal = iter->second->GetBalance(cur_unit);
-    iter->second->Deposit(cur_unit, amount);
-    float curr_bal = iter->second->GetBalance(cur_unit);
-    controller_.Deposit(*iter->second);
-    controller_.WriteToConsole("deposit success: " + iter->second->ToString());
-    SetResponse(response, request.GetId(), status_code::success, 
-      "deposit success, current balance of " + currency_to_str(cur_unit) + " is: " + std::to_string(curr_bal));
-    InvokeCallback(
-      "successful deposit " + std::to_string(amount) + currency_to_str(cur_unit) + " to account with id: " + std::to_string(id));
+void Server::HandleCheckBalance(Call& call, const CheckBalanceRequest& msg) {
+  Money bal = call.account_->GetBalance(msg.currency_);
+  SetResponse(call.response_, call.request_.GetId(),
+    status_code::success, Text("your current account balance is: %s", MoneyText(bal, msg.currency_).text_));
+}
+
+void Server::HandleDeposit(Call& call, const DepositRequest& msg) {
+  auto& [id, user_name, password, cur_unit, amount] = msg;
+  Account* account = call.account_;
+  if (!amount.Valid()) {
+    SetResponse(call.response_, call.request_.GetId(), status_code::fail, "invalid amount");
+    return;
   }
+  if (!account->Deposit(cur_unit, amount)) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "deposit fails: balance cannot hold the amount");
+    return;
+  }
+  LogBalance(*account);
+  Money curr_bal = account->GetBalance(cur_unit);
+  controller_.Deposit(*account);
+  controller_.WriteToConsole(Text("deposit success: %s", Describe(*account)));
+  SetResponse(call.response_, call.request_.GetId(), status_code::success,
+    Text("deposit success, current balance of %s is: %s", currency_name(cur_unit),
+      MoneyText(curr_bal, cur_unit).text_));
+  InvokeCallback(CallbackTopic{op_code::deposit, id, -1, cur_unit, amount},
+    Text("successful deposit %s%s to account with id: %d", MoneyText(amount, cur_unit).text_,
+      currency_name(cur_unit), id));
+  InvokeDelta(CallbackTopic{op_code::deposit, id, -1, cur_unit, amount}, BalanceDelta::Of(*account));
 }
 
-void Server::HandleWithdraw(const Request& request, Response& response) {
-  int id;
-  std::string user_name;
-  std::string password;
-  currency cur_unit;
-  float amount;
-  des(request.GetPayload(), id, user_name, password, cur_unit, amount);
-  auto iter = accounts_.find(id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
-  } else {
-    float orig_bal = iter->second->GetBalance(cur_unit);
-    if (orig_bal < amount) {
-      SetResponse(response, request.GetId(), 
-        status_code::fail, "withdraw fails: insufficient fund");
-    } else {
-      iter->second->Withdraw(cur_unit, amount);
-      float curr_bal = iter->second->GetBalance(cur_unit);
-      controller_.Withdraw(*iter->second);
-      controller_.WriteToConsole("withdraw success: " + iter->second->ToString());
-      SetResponse(response, request.GetId(), status_code::success, 
-        "withdraw success, current balance of " + currency_to_str(cur_unit) + " is: " + std::to_string(curr_bal));
-      InvokeCallback(
-        "successful withdraw " + std::to_string(amount) + currency_to_str(cur_unit) + " from account with id: " + std::to_string(id));
-    }
-  }
-}
-
-void Server::HandleTransfer(const Request& request, Response& response) {
-  int sender_id;
-  std::string user_name;
-  std::string password;
-  currency cur_unit;
-  float amount;
-  int receiver_id;
-  des(request.GetPayload(), sender_id, user_name, password, cur_unit, amount, receiver_id);
-  auto iter = accounts_.find(sender_id);
-  auto iter_receiver = accounts_.find(receiver_id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(sender_id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
-  } else if (iter_receiver == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(receiver_id));
-  } else {
-    if (iter->second->GetBalance(cur_unit) < amount) {
-      SetResponse(response, request.GetId(), 
-        status_code::fail, "withdraw fails: insufficient fund");
-    } else {
-      iter->second->Withdraw(cur_unit, amount);
-      iter_receiver->second->Deposit(cur_unit, amount);
-      controller_.Transfer(*iter_receiver->second, *iter->second);
-      controller_.WriteToConsole(
-        "transferred " + std::to_string(amount) + " " + currency_to_str(cur_unit) + 
-        " to account with id: " + std::to_string(receiver_id));
-      SetResponse(response, request.GetId(), 
-        status_code::success, 
-        "transferred " + std::to_string(amount) + " " + currency_to_str(cur_unit) + 
-        " to account with id: " + std::to_string(receiver_id));
-      InvokeCallback(
-        "transferred " + std::to_string(amount) + " " + currency_to_str(cur_unit) + 
-        " to account with id: " + std::to_string(receiver_id));
-    }
-  };
-}
-
-void Server::HandleExchange(const Request& request, Response& response) {
-  int id;
-  std::string user_name;
-  std::string password;
-  currency from_cur_unit;
-  currency to_cur_unit;
-  float amount_to_exchange;
-  des(request.GetPayload(), id, user_name, password, from_cur_unit, to_cur_unit, amount_to_exchange);
-  auto iter = accounts_.find(id);
-  if (iter == accounts_.end()) {
-    SetResponse(response, request.GetId(), 
-      status_code::error, "account not found with id: " + std::to_string(id));
-  } else if (user_name != iter->second->GetUserName()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: username not correct");
-  } else if (password != iter->second->GetPassword()) {
-    SetResponse(response, request.GetId(), 
-      status_code::fail, "authentication fails: password not correct");
+void Server::HandleWithdraw(Call& call, const WithdrawRequest& msg) {
+  auto& [id, user_name, password, cur_unit, amount] = msg;
+  Account* account = call.account_;
+  if (!amount.Valid()) {
+    SetResponse(call.response_, call.request_.GetId(), status_code::fail, "invalid amount");
+    return;
+  }
+  if (account->GetBalance(cur_unit) < amount || !account->Withdraw(cur_unit, amount)) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "withdraw fails: insufficient fund");
+    return;
+  }
+  LogBalance(*account);
+  Money curr_bal = account->GetBalance(cur_unit);
+  controller_.Withdraw(*account);
+  controller_.WriteToConsole(Text("withdraw success: %s", Describe(*account)));
+  SetResponse(call.response_, call.request_.GetId(), status_code::success,
+    Text("withdraw success, current balance of %s is: %s", currency_name(cur_unit),
+      MoneyText(curr_bal, cur_unit).text_));
+  InvokeCallback(CallbackTopic{op_code::withdraw, id, -1, cur_unit, amount},
+    Text("successful withdraw %s%s from account with id: %d", MoneyText(amount, cur_unit).text_,
+      currency_name(cur_unit), id));
+  InvokeDelta(CallbackTopic{op_code::withdraw, id, -1, cur_unit, amount}, BalanceDelta::Of(*account));
+}
+
+void Server::HandleTransfer(Call& call, const TransferRequest& msg) {
+  auto& [sender_id, user_name, password, cur_unit, amount, receiver_id] = msg;
+  Account* account = call.account_;
+  Response& response = call.response_;
+  Account* receiver = accounts_.Find(receiver_id);
+  // the receiver may live on another shard, it is then checked when credited
+  bool remote_receiver = OwnerOf(receiver_id) != shard_;
+  if (!amount.Valid()) {
+    SetResponse(response, call.request_.GetId(), status_code::fail, "invalid amount");
+  } else if (!remote_receiver && !receiver) {
+    SetResponse(response, call.request_.GetId(),
+      status_code::error, Text("account not found with id: %d", receiver_id));
+  } else if (account->GetBalance(cur_unit) < amount) {
+    SetResponse(response, call.request_.GetId(),
+      status_code::fail, "withdraw fails: insufficient fund");
+  } else if (remote_receiver) {
+    // debit here, credit on the receiver's shard, respond once it acknowledges. a
+    // valid amount not above the balance always withdraws
+    (void)account->Withdraw(cur_unit, amount);
+    uint64_t token = pending_ctr_++;
+    PendingTransfer& p = pending_[token];
+    p = PendingTransfer{&response, call.client_addr_, call.client_addr_len_, false, sender_id, receiver_id,
+                        cur_unit, amount};
+    // the debit and the transfer in one record, recovery credits it again until settled
+    LogTransfer(*account, token, p);
+    controller_.Withdraw(*account);
+    InvokeDelta(CallbackTopic{op_code::transfer, sender_id, -1, cur_unit, amount}, BalanceDelta::Of(*account));
+    response.SetId(call.request_.GetId());
+    deferred_ = &p;
+    Handoff h{};
+    h.kind_ = Handoff::kind::credit;
+    h.origin_ = shard_;
+    h.token_ = token;
+    h.account_id_ = receiver_id;
+    h.cur_ = cur_unit;
+    h.amount_ = amount;
+    // a credit for a debit lost in a crash would create money, and its token would
+    // be issued again and taken by the receiver for this one
+    ForwardDurable(OwnerOf(receiver_id), std::move(h));
+  } else if (!receiver->Deposit(cur_unit, amount)) {
+    SetResponse(response, call.request_.GetId(),
+      status_code::fail, Text("balance of account with id: %d cannot hold the amount", receiver_id));
   } else {
-    float amount_needed = convert(amount_to_exchange, from_cur_unit, to_cur_unit);
-    if (iter->second->GetBalance(from_cur_unit) < amount_needed) {
-      SetResponse(response, request.GetId(), 
-        status_code::fail, "withdraw fails: insufficient fund");
-    } else {
-      iter->second->Withdraw(from_cur_unit, amount_needed);
-      iter->second->Deposit(to_cur_unit, amount_to_exchange);
-      controller_.Exchange(*iter->second);
-      controller_.WriteToConsole("exchange successfully: " + iter->second->ToString());
-      SetResponse(response, request.GetId(), 
-        status_code::success, 
-        "exchange successfully: " + iter->second->ToString());
-      InvokeCallback("exchange successfully: " + iter->second->ToString());
-    }
-  }
-}
-
-void Server::HandleMonitor(const Request& request, Response& response, const sockaddr_in& client_addr, socklen_t len) {
-  int64_t d;
-  des(request.GetPayload(), d);
-  bool flag = false;
-  // assume no monitor request sent when one with same ip is active
-
-  auto iter = callbacks_.begin();
-  while (iter != callbacks_.end()) {
-    if (
-      iter->GetClientAddr().sin_addr.s_addr == client_addr.sin_addr.s_addr &&
-      iter->GetClientAddr().sin_port == client_addr.sin_port
-    ) {
-      if (iter->IsActive()) {
-        flag = true;
-      } else {
-        controller_.DeleteCallback(*iter);
-        iter = callbacks_.erase(iter);
-        continue;
-      }
+    (void)account->Withdraw(cur_unit, amount);
+    LogBalance(*account);
+    LogBalance(*receiver);
+    controller_.Transfer(*receiver, *account);
+    std::string_view text = Text("transferred %s %s to account with id: %d",
+      MoneyText(amount, cur_unit).text_, currency_name(cur_unit), receiver_id);
+    controller_.WriteToConsole(text);
+    SetResponse(response, call.request_.GetId(), status_code::success, text);
+    InvokeCallback(CallbackTopic{op_code::transfer, sender_id, receiver_id, cur_unit, amount}, text);
+    InvokeDelta(CallbackTopic{op_code::transfer, sender_id, -1, cur_unit, amount}, BalanceDelta::Of(*account));
+    InvokeDelta(CallbackTopic{op_code::transfer, receiver_id, -1, cur_unit, amount}, BalanceDelta::Of(*receiver));
+  }
+}
+
+void Server::HandleExchange(Call& call, const ExchangeRequest& msg) {
+  Account* account = call.account_;
+  if (!msg.amount_.Valid()) {
+    SetResponse(call.response_, call.request_.GetId(), status_code::fail, "invalid amount");
+    return;
+  }
+  // saturated past int64, never below a balance
+  Money amount_needed = convert(msg.amount_, msg.from_currency_, msg.to_currency_);
+  if (account->GetBalance(msg.from_currency_) < amount_needed) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "withdraw fails: insufficient fund");
+    return;
+  }
+  if (!account->Deposit(msg.to_currency_, msg.amount_)) {
+    SetResponse(call.response_, call.request_.GetId(),
+      status_code::fail, "exchange fails: balance cannot hold the amount");
+    return;
+  }
+  (void)account->Withdraw(msg.from_currency_, amount_needed);
+  LogBalance(*account);
+  controller_.Exchange(*account);
+  std::string_view text = Text("exchange successfully: %s", Describe(*account));
+  controller_.WriteToConsole(text);
+  SetResponse(call.response_, call.request_.GetId(), status_code::success, text);
+  InvokeCallback(CallbackTopic{op_code::exchange, msg.id_, -1, msg.to_currency_, msg.amount_}, text);
+  InvokeDelta(CallbackTopic{op_code::exchange, msg.id_, -1, msg.to_currency_, msg.amount_}, BalanceDelta::Of(*account));
+}
+
+void Server::HandleMonitor(Call& call, const MonitorRequest& msg) {
+  if (msg.multicast_) {
+    // nothing to register, the client joins the group and filters for itself
+    std::string_view group = group_.GetFanout().MulticastGroup();
+    if (group.empty()) {
+      SetResponse(call.response_, call.request_.GetId(), status_code::fail, "multicast is not enabled");
+      return;
     }
-    iter++;
+    SetResponse(call.response_, call.request_.GetId(), status_code::success,
+      Text("multicast group: %.*s", static_cast<int>(group.size()), group.data()));
+    return;
   }
-  if (flag) {
-    SetResponse(response, request.GetId(), status_code::fail, "monitor window already exists");
-  } else {
-    CallbackData cb{client_addr, len, std::chrono::steady_clock::now(), std::chrono::milliseconds(d)};
-    callbacks_.push_back(cb);
-    controller_.WriteToConsole("new callback created");
-    controller_.CreateCallback(cb);
-    SetResponse(response, request.GetId(), status_code::success, "new monitor window created");
-  }
-}
-
-/* Helper: send callback result to the client */
-void Server::InvokeCallback(const std::string& msg) {
-  size_t len = msg.length();
-  for (auto& cb : callbacks_) {
-    if (cb.IsActive()) {
-      std::copy(msg.begin(), msg.begin() + len, callback_out_.data());
-      ssize_t sent = sendto(
-        sockfd_, callback_out_.data(), sizeof(callback_out_), 0, (sockaddr*)(&cb.GetClientAddr()), cb.GetClientAddrLen()
-      );
-      if (sent < 0) { perror("sendto"); }
-      controller_.WriteToConsole("monitor callback send: " + msg);
-      memset(callback_out_.data(), 0, out_buf_len);
-    }
-  } 
+  // the fan-out indexes windows by account, the ranges are expanded for it
+  std::vector<int> accounts;
+  for (size_t i = 0; i < msg.ranges_.size(); i += 3) {
+    if (i + 3 > msg.ranges_.size() || msg.ranges_[i] > msg.ranges_[i + 1] || msg.ranges_[i + 2] < 1) {
+      SetResponse(call.response_, call.request_.GetId(), status_code::fail, "invalid account ranges");
+      return;
+    }
+    int64_t first = msg.ranges_[i];
+    int64_t last = msg.ranges_[i + 1];
+    int64_t step = msg.ranges_[i + 2];
+    if ((last - first) / step >= static_cast<int64_t>(monitor_max_accounts - accounts.size())) {
+      SetResponse(call.response_, call.request_.GetId(),
+        status_code::fail, Text("account ranges cover more than %zu accounts", monitor_max_accounts));
+      return;
+    }
+    for (int64_t id = first; id <= last; id += step) {
+      accounts.push_back(static_cast<int>(id));
+    }
+  }
+  CallbackData cb{call.client_addr_, call.client_addr_len_, std::chrono::steady_clock::now(),
+                  std::chrono::milliseconds(msg.duration_)};
+  // a single window for the group, the fan-out sends the callbacks of every shard and
+  // closes the window once it is over
+  MonitorFilter filter{std::move(accounts), static_cast<uint32_t>(msg.ops_), msg.min_amount_};
+  if (!group_.GetFanout().Subscribe(cb, std::move(filter), std::chrono::milliseconds(std::max(msg.interval_, 0)))) {
+    SetResponse(call.response_, call.request_.GetId(), status_code::fail, "monitor window already exists");
+    return;
+  }
+  controller_.WriteToConsole("new callback created");
+  SetResponse(call.response_, call.request_.GetId(), status_code::success, "new monitor window created");
+}
+
+/* Helper: hand a callback to the fan-out */
+void Server::InvokeCallback(const CallbackTopic& topic, std::string_view msg) {
+  // copied into the queue, msg may be text_
+  group_.GetFanout().Notify(topic, msg);
+}
+
+/* Helper: hand new balances to the fan-out */
+void Server::InvokeDelta(const CallbackTopic& topic, const BalanceDelta& delta) {
+  group_.GetFanout().Update(topic, delta);
 }
\ No newline at end of file
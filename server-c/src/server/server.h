@@ -6,163 +6,498 @@
 #define SERVER_H
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <deque>
 #include <iostream>
 #include <utility>
 #include <chrono>
 #include <random>
+#include <string>
+#include <string_view>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/types.h>
 
 #include "../core/accounts.h"
+#include "../core/rates.h"
+#include "../core/store.h"
 #include "../rpc/include.h"
 #include "../serdes.h"
 #include "callback.h"
+#include "config.h"
 #include "controller.h"
+#include "dedup.h"
+#include "mpsc.h"
+#include "pool.h"
+#include "uring.h"
+#include "snapshot.h"
+#include "wal.h"
 
 constexpr size_t in_buf_len = 200 + payload_size;
 constexpr size_t out_buf_len = 200 + payload_size;
 
+/* capacity of the inbox through which other shards hand off work */
+constexpr size_t inbox_capacity = 1024;
+
+class ServerGroup;
+
+/* Message posted by one shard to the inbox of another
+ *
+ *   request:     a client datagram for an account owned by the receiving shard
+ *   credit:      second half of a cross partition transfer, deposit to account_id_
+ *   credit_ack:  outcome of a credit, sent back to the shard holding the transfer
+ *   credit_done: the sender has durably settled the credit token_, the receiver
+ *                may forget it */
+class Handoff
+{
+ public:
+
+  enum class kind { request, credit, credit_ack, credit_done };
+
+  kind kind_;
+  int origin_;
+
+  sockaddr_in client_addr_;
+  socklen_t client_addr_len_;
+
+  /* request */
+  std::array<char, in_buf_len> data_;
+  size_t data_len_;
+
+  /* credit, credit_ack and credit_done */
+  uint64_t token_;
+  int account_id_;
+  currency cur_;
+  Money amount_;
+  bool ok_;
+  /* credit_ack not ok: the receiver exists but its balance cannot hold the amount */
+  bool full_;
+
+};
+
 class Server
 {
  public:
 
-  Server(int port) : controller_{}, 
-      running_(true), mode_(mode::at_most_once), rd_{}, gen_(rd_()),
-      in_{}, out_{}, callback_out_{},
-      requests_{}, responses_{},
-      account_id_ctr_(0), accounts_{}, callbacks_{} {
-    controller_.BindChangeModeCallback([this](mode m)->void {
-      this->ChangeMode(m);
-    });
-    controller_.BindChangeLostRateCallback([this](int i)->void {
-      this->ChangeLostRate(i);
-    });
-    thread_ptr_ = std::make_unique<std::thread>(&Server::StartListening, this, port);
-  }
+  Server(const ServerConfig& config, int shard, Controller& controller, ServerGroup& group)
+      : controller_(controller), group_(group),
+      running_(true), port_(config.port), batch_size_(config.batch_size), transport_(config.backend),
+      shard_(shard), n_shards_(config.shards), sockfd_(-1), addr_{},
+      in_(config.batch_size), in_lens_(config.batch_size), in_addrs_(config.batch_size),
+      out_(config.batch_size), out_lens_(config.batch_size), out_addrs_(config.batch_size), n_out_(0),
+      inbox_(inbox_capacity), backlog_(config.shards), sleeping_(false),
+      dedup_(config.dedup_memory, static_cast<int64_t>(config.dedup_ttl) * 1000),
+      pending_{}, pending_ctr_(0), deferred_(nullptr),
+      accounts_(shard, config.shards), wal_dir_(config.wal_dir), wal_lsn_(0),
+      rd_{}, gen_(rd_()), mode_(mode::at_most_once) {}
 
   ~Server() {
-    running_ = false;
-    close(sockfd_);
-    thread_ptr_->join();
-    for (auto& [_, req] : requests_) { delete req; }
-    for (auto& [_, resp] : responses_) { delete resp; }
-    for (auto& [_, acc] : accounts_) { delete acc; }
+    Stop();
   };
 
-  void BindHeaderViewModel(HeaderViewInterface* view) { controller_.BindHeaderViewModel(view); }
+  /* Bind the socket and spawn the listening thread */
+  void Start();
+
+  /* Stop the listening thread and wait for it to exit */
+  void Stop();
 
-  void BindRpcViewModel(RpcViewInterface* view) { controller_.BindRpcViewModel(view); }
+  /* Ask the shard to snapshot its state in the background, no-op without a log */
+  void RequestSnapshot();
 
-  void BindConsoleViewModel(ConsoleViewInterface* view) { controller_.BindConsoleViewModel(view); }
+  /* Enqueue a handoff from another shard, returns false if the inbox is full */
+  bool Post(Handoff&& h);
 
-  void BindAccountViewModel(AccountViewInterface* view) { controller_.BindAccountViewModel(view); }
+  void ChangeMode(mode m);
+
+  void ChangeLostRate(int i);
+
+  /* descriptor of the socket, valid once started */
+  int Socket() const { return sockfd_; }
 
-  void BindCallbackViewModel(CallbackViewInterface* view) { controller_.BindCallbackViewModel(view); }
-  
  private:
 
+  /* A request being dispatched to its handler */
+  class Call
+  {
+   public:
+    const Request& request_;
+    Response& response_;
+    const sockaddr_in& client_addr_;
+    socklen_t client_addr_len_;
+    /* the account named by the request, set before the handler runs for ops that
+     *   authenticate */
+    Account* account_;
+  };
+
+  /* Entry of the dispatch table: decodes message M, authenticates the account named
+   *   by its id field unless id is nullptr, then runs handler. defined in server.cc */
+  template<typename M, auto handler, auto id = nullptr>
+  class Op;
+
+  using OpRunner = void (*)(Server& server, Call& call);
+
+  /* Transfer debited on this shard, waiting for the credit on the receiver's shard
+   *
+   *   logged with the debit and until its ack is, a transfer recovered from the log
+   *   is credited again with no client waiting for it (response_ null) */
+  class PendingTransfer
+  {
+   public:
+    Response* response_;
+    sockaddr_in client_addr_;
+    socklen_t client_addr_len_;
+    /* whether the response goes to the at most once reply cache once completed */
+    bool record_;
+    int sender_id_;
+    int receiver_id_;
+    currency cur_;
+    Money amount_;
+  };
+
+  /* Serialized reply waiting for the write-ahead log */
+  class HeldReply
+  {
+   public:
+    uint64_t lsn_;
+    std::array<char, out_buf_len> data_;
+    size_t len_;
+    sockaddr_in client_addr_;
+    socklen_t client_addr_len_;
+  };
+
+  /* Credit, credit ack or credit done waiting for the write-ahead log, shard_ is its
+   *   destination */
+  class HeldAck
+  {
+   public:
+    uint64_t lsn_;
+    int shard_;
+    Handoff ack_;
+  };
+
   /* the controller to which gui is bounded
-   *   used to update gui view model */
-  Controller controller_;
+   *   used to update gui view model, shared by all shards */
+  Controller& controller_;
+  /* the group of shards this server belongs to */
+  ServerGroup& group_;
 
   /* atomic bool indicator of whether the server is running */
   std::atomic<bool> running_;
-  /* pointer to the main thread for server to listen requests 
+  /* pointer to the main thread for server to listen requests
    *   on socket with sockfd_, addr_, and port */
   std::unique_ptr<std::thread> thread_ptr_;
+  int port_;
+
+  /* max number of datagrams handled per recvmmsg / sendmmsg round trip */
+  size_t batch_size_;
+  /* transport backend of the listening loop */
+  transport transport_;
+
+  /* index of this shard, it owns account ids with id % n_shards_ == shard_ */
+  int shard_;
+  int n_shards_;
 
   /* socket descriptor */
   int sockfd_;
   /* address of the socket */
   sockaddr_in addr_;
-
-  /* input stream buffer of client request datagram */
-  std::array<char, in_buf_len> in_;
-  /* output stream buffer of server response datagram */
-  std::array<char, out_buf_len> out_;
-  /* output stream buffer of callback response datagram */
-  std::array<char, out_buf_len> callback_out_;
-
-  /* history of requests received from client 
-   *   key: request id, value: pointer to request object on heap */
-  std::unordered_map<int, Request*> requests_;
-  /* history of attempted response the server posted to client's request
-   *   key: request id, value: pointer to response object on heap */
-  std::unordered_map<int, Response*> responses_;
-
-  /* the account id counter */
-  int account_id_ctr_;
-  /* database: all accounts registered by clients */
-  std::unordered_map<int, Account*> accounts_;
-  /* database: all callbacks that client send to server 
-   *   in order to receive update on their account balance */
-  std::vector<CallbackData> callbacks_;
-
+  /* pipe used to wake the shard from poll when a handoff arrives or on stop */
+  int wake_fds_[2] = {-1, -1};
+
+  /* input stream buffers of client request datagrams, one slot per batch entry */
+  std::vector<std::array<char, in_buf_len>> in_;
+  std::vector<size_t> in_lens_;
+  std::vector<std::pair<sockaddr_in, socklen_t>> in_addrs_;
+  /* output stream buffers of server response datagrams waiting to be flushed */
+  std::vector<std::array<char, out_buf_len>> out_;
+  std::vector<size_t> out_lens_;
+  std::vector<std::pair<sockaddr_in, socklen_t>> out_addrs_;
+  size_t n_out_;
+  /* first output slot in use, the uring transport alternates between two halves
+   *   so that one half is filled while the sends of the other are in flight */
+  size_t out_base_ = 0;
+#ifdef __linux__
+  /* message headers handed to recvmmsg / sendmmsg, pointing into the slots above */
+  std::vector<iovec> in_iovs_, out_iovs_;
+  std::vector<mmsghdr> in_msgs_, out_msgs_;
+
+  /* io_uring transport, null when the socket transport is used */
+  std::unique_ptr<Uring> uring_;
+  /* template of the multishot recvmsg, only the name and control lengths are used */
+  msghdr uring_recv_msg_{};
+  /* sink of the wake pipe read */
+  char uring_wake_buf_[64];
+  /* sends in flight per half of the output slots */
+  size_t uring_inflight_[2] = {0, 0};
+  /* receive completions reaped while waiting for sends, handled on the next pass */
+  std::deque<io_uring_cqe> uring_stash_;
+#endif
+  /* scratch text of the messages built while serving a request */
+  std::array<char, payload_size> text_;
+  std::array<char, account_text_len> account_text_;
+
+  /* handoffs posted by other shards */
+  MpscQueue<Handoff> inbox_;
+  /* handoffs this shard could not post yet because the peer's inbox was full,
+   *   indexed by destination shard, retried every loop */
+  std::vector<std::deque<Handoff>> backlog_;
+  /* set while blocked in poll, producers only write to the wake pipe when set */
+  std::atomic<bool> sleeping_;
+
+  /* replies to the recent requests of every client, for at most once semantics */
+  DedupCache dedup_;
+  /* requests and responses in flight, recycled so that serving allocates nothing */
+  ObjectPool<Request> requests_;
+  ObjectPool<Response> responses_;
+  /* transfers waiting for the receiver's shard, key: transfer token */
+  std::unordered_map<uint64_t, PendingTransfer> pending_;
+  uint64_t pending_ctr_;
+  /* set by a handler which will post its response once a handoff completes */
+  PendingTransfer* deferred_;
+  /* credits applied here whose sender has not settled them yet, key: CreditKey. a
+   *   credit sent again after a crash is acknowledged without being applied twice,
+   *   only kept with a log */
+  std::unordered_set<uint64_t> credited_;
+
+  /* database: accounts owned by this shard, ids congruent to shard_ */
+  AccountStore accounts_;
+
+  /* write-ahead log of the account changes, null if no log directory is configured */
+  std::string wal_dir_;
+  std::unique_ptr<Wal> wal_;
+  /* lsn at which the last change made by this shard is durable */
+  uint64_t wal_lsn_;
+  /* replies and handoffs produced after a change that is not durable yet, held
+   *   back in order until the log has caught up with their lsn */
+  SlotQueue<HeldReply> held_replies_;
+  SlotQueue<HeldAck> held_acks_;
+
+  /* set by RequestSnapshot, checked by the shard between requests */
+  std::atomic<bool> snapshot_due_ = false;
+  /* child writing a snapshot, -1 if none */
+  pid_t snapshot_pid_ = -1;
+  /* wal_lsn_ covered by the running and by the last written snapshot */
+  uint64_t snapshot_pending_lsn_ = 0;
+  uint64_t snapshot_lsn_ = 0;
   std::random_device rd_;
   std::mt19937 gen_;
-  int intv_start_ = 0, intv_end_ = 100;
+  std::atomic<int> intv_start_ = 0;
+  int intv_end_ = 100;
 
   /* mode specifying the udp semantic
-   * 
-   *   at least once: when client sends duplicated request, 
+   *
+   *   at least once: when client sends duplicated request,
    *     operate all regardless of idempotency
-   * 
-   *   at most once: when client sends duplicated request, do not perform 
+   *
+   *   at most once: when client sends duplicated request, do not perform
    *     operation, post previous response again */
-  mode mode_;
+  std::atomic<mode> mode_;
 
 
 
-  /* The main thread function, consistently listen for client's requests 
-   *   on a given port number */
-  void StartListening(int port);
+  /* The main thread function, consistently listen for client's requests
+   *   on the bound socket and for handoffs from other shards */
+  void StartListening();
 
-  /* Helpers */
+  /* Receive up to batch_size_ datagrams into the input slots and return the count,
+   *   blocks until the first datagram arrives if block is set */
+  int Receive(bool block);
 
-  void BindSocket(int port);
+  /* Post all responses queued in the output slots */
+  void Flush();
 
-  void ResetIOStreams();
+  /* Sleep until a datagram or a handoff arrives */
+  void Wait();
 
-  void ChangeMode(mode m);
+#ifdef __linux__
+  /* Set up the io_uring transport and arm its receive, returns false if the kernel
+   *   lacks io_uring or its multishot recvmsg */
+  bool SetupUring();
 
-  void ChangeLostRate(int i);
+  /* Completion driven variant of the listening loop */
+  void ListenUring();
+
+  /* Handle the completions posted by the kernel, receive completions are only
+   *   stashed if stash is set */
+  void ReapUring(bool stash);
+
+  void HandleUringRecv(const io_uring_cqe& cqe);
+
+  void FlushUring();
+#endif
+
+  /* Run one received datagram through loss simulation and route it to the shard
+   *   owning its account, the response (if any) is queued to the output slots */
+  void ProcessDatagram(const char* in, size_t n, const sockaddr_in& client_addr, socklen_t len);
+
+  /* Run a request owned by this shard through Filter and Dispatch */
+  void Serve(Request* request, const sockaddr_in& client_addr, socklen_t len);
+
+  /* Queue a response to the output slots, subject to loss simulation, it is held
+   *   back while a change it may depend on is not durable */
+  void Reply(const Response& response, const sockaddr_in& client_addr, socklen_t len);
+
+  /* Queue a reply kept in the at most once cache, as Reply */
+  void Replay(const DedupCache::Entry& entry, const sockaddr_in& client_addr, socklen_t len);
+
+  /* Keep the reply to a request of client_addr in the at most once cache */
+  const DedupCache::Entry& Record(const Response& response, const sockaddr_in& client_addr);
+
+  /* Whether the loss simulation drops the reply about to be sent */
+  bool DropReply();
+
+  static DedupKey KeyOf(const sockaddr_in& client_addr, int id) {
+    return DedupKey{client_addr.sin_addr.s_addr, client_addr.sin_port, id};
+  }
+
+  /* ms of a steady clock, the time base of the at most once cache */
+  static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /* Write-ahead log helpers */
+
+  /* Open the shard's log and replay it into the account store */
+  void Recover();
+
+  void ApplyWalRecord(const char* record, size_t n);
+
+  void LogCreate(const Account& account);
+
+  void LogErase(int id);
+
+  void LogBalance(const Account& account);
+
+  /* the debit of a cross shard transfer and the transfer itself, in one record */
+  void LogTransfer(const Account& sender, uint64_t token, const PendingTransfer& p);
+
+  /* the transfer token settled, with the balances of its sender (if still open) */
+  void LogTransferDone(uint64_t token, int sender_id, const Account* sender);
+
+  /* a credit from shard origin applied to account, in one record */
+  void LogCredit(int origin, uint64_t token, const Account& account);
+
+  void LogCreditForget(int origin, uint64_t token);
+
+  /* Set the balances of the held currencies of account id, if it exists */
+  void ApplyBalance(int id, uint8_t held, const std::array<Money, n_currencies>& balance);
+
+  /* Send the credits of the transfers recovered from the log again */
+  void ResendCredits();
+
+  std::string WalPath() const { return wal_dir_ + "/shard-" + std::to_string(shard_) + ".wal"; }
+
+  /* Snapshot helpers */
+
+  std::string SnapshotPath() const { return wal_dir_ + "/shard-" + std::to_string(shard_) + ".snap"; }
+
+  /* Map the shard's snapshot into the store and history, sets wal_offset to the log
+   *   position it covers, returns false if there is no usable snapshot */
+  bool LoadSnapshot(uint64_t& wal_offset);
+
+  /* Start a snapshot if one is due and reap a finished one, called between requests */
+  void Checkpoint();
+
+  /* Fork a child writing the snapshot */
+  void StartSnapshot();
+
+  /* Reap the snapshot child, waits for it if block is set */
+  void ReapSnapshot(bool block);
+
+  /* Body of the child, writes the snapshot to path through a temporary file then exits */
+  [[noreturn]] void WriteSnapshot(const char* tmp_path, const char* path);
+
+  /* whether replies must wait for the log */
+  bool MustHold() const { return wal_ && (!held_replies_.Empty() || wal_lsn_ > wal_->Durable()); }
+
+  /* Queue the held replies and post the held acks the log has caught up with, stops
+   *   the server if the log failed */
+  void ReleaseDurable();
+
+  /* Sharding helpers */
+
+  int OwnerOf(int account_id) const;
+
+  void Forward(int shard, Handoff&& h);
+
+  void DrainInbox();
+
+  void FlushBacklog();
+
+  void HandleCredit(const Handoff& h);
+
+  void HandleCreditAck(const Handoff& h);
+
+  void HandleCreditDone(const Handoff& h);
+
+  /* Forward h once the changes made so far are durable */
+  void ForwardDurable(int shard, Handoff&& h);
+
+  /* credits of shard origin are told apart by their token, which stays below 2^48 */
+  static uint64_t CreditKey(int origin, uint64_t token) {
+    return static_cast<uint64_t>(origin) << 48 | token;
+  }
+
+  /* Helpers */
+
+  void BindSocket(int port);
 
   void Filter(Request* request, Response* response, const sockaddr_in& client_addr, socklen_t len);
 
   int GenRandomValue(int min, int max);
 
-  /* Dispatch the tasks by the request's operation code */
+  /* Dispatch the request through the op table, answering a malformed payload with
+   *   an error */
   void Dispatch(Request* request, Response* response, const sockaddr_in& client_addr, socklen_t len);
 
-  /* Send message to client with active monitor window to inform updates on all accounts */
-  void InvokeCallback(const std::string& msg);
+  /* Queue message about topic for the clients with an active monitor window whose
+   *   filter it passes, sent by the group's fan-out thread */
+  void InvokeCallback(const CallbackTopic& topic, std::string_view msg);
+
+  /* Queue the new balances of an account for the monitor windows taking deltas */
+  void InvokeDelta(const CallbackTopic& topic, const BalanceDelta& delta);
+
+  /* Format a message into text_, valid until the next call */
+  std::string_view Text(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  /* Text of an account in account_text_, valid until the next call */
+  const char* Describe(const Account& account);
+
+  /* The account id if user_name and password match it, otherwise nullptr with the
+   *   failure set as the response */
+  Account* Authenticate(Call& call, int id, std::string_view user_name, std::string_view password);
 
-  /* Handler helper functions */
+  /* Handlers, run by Dispatch once the message is decoded and, for the ops that
+   *   authenticate, call.account_ set */
 
-  void HandleCreateAccount(const Request& request, Response& response);
+  void HandleCreateAccount(Call& call, const OpenRequest& msg);
 
-  void HandleDeleteAccount(const Request& request, Response& repsonse);
+  void HandleDeleteAccount(Call& call, const CloseRequest& msg);
 
-  void HandleCheckBalance(const Request& request, Response& response);
+  void HandleCheckBalance(Call& call, const CheckBalanceRequest& msg);
 
-  void HandleDeposit(const Request& request, Response& response);
+  void HandleDeposit(Call& call, const DepositRequest& msg);
 
-  void HandleWithdraw(const Request& request, Response& response);
+  void HandleWithdraw(Call& call, const WithdrawRequest& msg);
 
-  void HandleTransfer(const Request& request, Response& response);
+  void HandleTransfer(Call& call, const TransferRequest& msg);
 
-  void HandleExchange(const Request& request, Response& response);
+  void HandleExchange(Call& call, const ExchangeRequest& msg);
 
-  void HandleMonitor(const Request& request, Response& response, const sockaddr_in& client_addr, socklen_t len);
+  void HandleMonitor(Call& call, const MonitorRequest& msg);
 
 };
 
-#endif /* SERVER_H */
\ No newline at end of file
+#endif /* SERVER_H */
@@ -0,0 +1,60 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+void SnapshotWriter::Write(const void* data, size_t len) {
+  const char* p = static_cast<const char*>(data);
+  off_ += len;
+  if (n_ + len <= sizeof(buf_)) {
+    std::memcpy(buf_ + n_, p, len);
+    n_ += len;
+    return;
+  }
+  // large sections, e.g. whole chunks of accounts, bypass the buffer
+  Drain();
+  while (len > 0 && ok_) {
+    ssize_t w = write(fd_, p, len);
+    if (w < 0) {
+      if (errno == EINTR) { continue; }
+      ok_ = false;
+      return;
+    }
+    p += w;
+    len -= w;
+  }
+}
+
+void SnapshotWriter::Pad(size_t align) {
+  static const char zeros[snapshot_align] = {};
+  size_t rem = off_ % align;
+  size_t pad = rem == 0 ? 0 : align - rem;
+  while (pad > 0) {
+    size_t n = pad < sizeof(zeros) ? pad : sizeof(zeros);
+    Write(zeros, n);
+    pad -= n;
+  }
+}
+
+bool SnapshotWriter::Finish() {
+  Drain();
+  return ok_;
+}
+
+void SnapshotWriter::Drain() {
+  size_t off = 0;
+  while (off < n_ && ok_) {
+    ssize_t w = write(fd_, buf_ + off, n_ - off);
+    if (w < 0) {
+      if (errno == EINTR) { continue; }
+      ok_ = false;
+      return;
+    }
+    off += w;
+  }
+  n_ = 0;
+}
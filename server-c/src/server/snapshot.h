@@ -0,0 +1,117 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <snapshot.h> file defines the checkpoint format of a shard.
+ *
+ * A snapshot is written by a child forked from the shard thread between two requests,
+ * the copy on write image it inherits is consistent and the shard goes on serving
+ * while the child writes. On start the file is mapped privately and the account
+ * records are used in place, they are only paged in when first touched.
+ *
+ *   header
+ *   account records   page aligned, the store's chunks back to back, sizeof(Account) each
+ *   live bitmap       one bit per slot of those chunks
+ *   history           at most once replies, least recently used first, each a
+ *                     SnapshotReply followed by its bytes
+ *   transfers         SnapshotTransfer of every transfer debited and not settled
+ *   credits           key of every credit applied and not settled by its sender */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr char snapshot_magic[8] = {'D', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t snapshot_version = 4;
+constexpr size_t snapshot_align = 4096;
+
+/* how long the snapshot child waits for the log it covers to be written */
+constexpr int snapshot_sync_timeout_ms = 10000;
+
+class SnapshotHeader
+{
+ public:
+  char magic_[8];
+  uint32_t version_;
+  /* size of the account records, the layout must match to map them */
+  uint32_t account_size_;
+  int32_t shard_;
+  int32_t n_shards_;
+  /* offset in the shard's write-ahead log up to which changes are included */
+  uint64_t wal_offset_;
+  /* slots handed out by the store and chunks holding them */
+  uint64_t n_slots_;
+  uint64_t n_chunks_;
+  /* file offsets of the sections */
+  uint64_t accounts_off_;
+  uint64_t live_off_;
+  uint64_t history_off_;
+  uint64_t n_history_;
+  uint64_t transfers_off_;
+  uint64_t n_transfers_;
+  uint64_t credits_off_;
+  uint64_t n_credits_;
+  /* token of the next transfer, tokens are never reused */
+  uint64_t next_token_;
+};
+
+/* Reply kept for at most once semantics */
+class SnapshotReply
+{
+ public:
+  uint32_t ip_;
+  uint16_t port_;
+  uint16_t frame_len_;
+  int32_t id_;
+  int32_t code_;
+  /* bytes following, the rest of the frame being zeros */
+  uint32_t len_;
+};
+
+/* Transfer waiting for its credit */
+class SnapshotTransfer
+{
+ public:
+  uint64_t token_;
+  int32_t sender_id_;
+  int32_t receiver_id_;
+  int32_t cur_;
+  int32_t pad_;
+  int64_t amount_;
+};
+
+/* Buffered writes to a file descriptor without any allocation, the only kind of
+ *   writer usable in a child forked from a multithreaded process */
+class SnapshotWriter
+{
+ public:
+
+  explicit SnapshotWriter(int fd) : fd_(fd), n_(0), off_(0), ok_(true) {}
+
+  void Write(const void* data, size_t len);
+
+  /* Write zeros up to the next multiple of align */
+  void Pad(size_t align);
+
+  /* Write out the buffer, returns false if any write failed */
+  bool Finish();
+
+  uint64_t Offset() const { return off_; }
+
+ private:
+
+  int fd_;
+
+  char buf_[1 << 16];
+
+  size_t n_;
+
+  uint64_t off_;
+
+  bool ok_;
+
+  void Drain();
+
+};
+
+#endif /* SNAPSHOT_H */
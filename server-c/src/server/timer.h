@@ -0,0 +1,173 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <timer.h> file implements a hierarchical timing wheel. */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/* Timers firing at a tick, used by a single thread
+ *
+ *   four levels of 256 slots, a slot of level l spans 256^l ticks. a timer sits in the
+ *   slot of the highest level where its expiry differs from the current tick, when the
+ *   wheel reaches that slot its timers cascade down a level, so adding and cancelling
+ *   are O(1) and advancing costs one slot per tick plus the cascades. timers past the
+ *   last level wait in its furthest slot and are placed again once it is reached.
+ *   timers live in a pool with stable indices, chained within their slot */
+template<typename T>
+class TimerWheel
+{
+ public:
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  explicit TimerWheel(int64_t now) : now_(now), size_(0) {
+    for (auto& level : slots_) { level.fill(none); }
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /* Arm a timer carrying value to fire at tick expiry, a past tick fires on the next
+   *   Advance. returns its handle, valid until it fires or is cancelled */
+  uint32_t Add(int64_t expiry, const T& value) {
+    uint32_t t;
+    if (!free_.empty()) {
+      t = free_.back();
+      free_.pop_back();
+    } else {
+      t = static_cast<uint32_t>(timers_.size());
+      timers_.emplace_back();
+    }
+    timers_[t].expiry_ = expiry;
+    timers_[t].value_ = value;
+    Place(t, now_ + 1);
+    ++size_;
+    return t;
+  }
+
+  void Cancel(uint32_t t) {
+    Unlink(t);
+    free_.push_back(t);
+    --size_;
+  }
+
+  /* Move to tick now, calling f(value) for every timer expired by then */
+  template<typename F>
+  void Advance(int64_t now, F&& f) {
+    while (now_ < now) {
+      ++now_;
+      // cascade the levels whose slot turns over at this tick, highest first
+      for (int level = levels - 1; level > 0; --level) {
+        if ((now_ & ((int64_t(1) << (level * slot_bits)) - 1)) == 0) { Cascade(level); }
+      }
+      uint32_t& head = slots_[0][now_ & slot_mask];
+      while (head != none) {
+        uint32_t t = head;
+        Unlink(t);
+        free_.push_back(t);
+        --size_;
+        // f may arm timers and reuse the entry
+        T value = timers_[t].value_;
+        f(value);
+      }
+    }
+  }
+
+  /* Tick by which Advance is due: the next timer of the first level, or the next
+   *   cascade if the first level is empty. max of int64_t without timers */
+  int64_t NextTick() const {
+    if (size_ == 0) { return std::numeric_limits<int64_t>::max(); }
+    for (int64_t tick = now_ + 1; tick <= (now_ | slot_mask); ++tick) {
+      if (slots_[0][tick & slot_mask] != none) { return tick; }
+    }
+    return (now_ | slot_mask) + 1;
+  }
+
+  /* number of armed timers */
+  size_t Size() const { return size_; }
+
+ private:
+
+  static constexpr int levels = 4;
+  static constexpr int slot_bits = 8;
+  static constexpr int64_t slot_mask = (1 << slot_bits) - 1;
+
+  class Timer
+  {
+   public:
+    int64_t expiry_;
+    T value_;
+    uint32_t prev_;
+    uint32_t next_;
+    /* level and slot holding the timer */
+    uint16_t level_;
+    uint16_t slot_;
+  };
+
+  int64_t now_;
+
+  size_t size_;
+
+  std::vector<Timer> timers_;
+
+  std::vector<uint32_t> free_;
+
+  /* head of the chain of every slot */
+  std::array<std::array<uint32_t, 1 << slot_bits>, levels> slots_;
+
+  /* Chain timer t in its slot, firing no earlier than tick first */
+  void Place(uint32_t t, int64_t first) {
+    Timer& timer = timers_[t];
+    int64_t expiry = std::max(timer.expiry_, first);
+    int level = 0;
+    // the first level whose span around now_ contains the expiry
+    while (level < levels - 1 && (expiry >> ((level + 1) * slot_bits)) != (now_ >> ((level + 1) * slot_bits))) {
+      ++level;
+    }
+    int64_t slot = expiry >> (level * slot_bits);
+    if (level == levels - 1 && (expiry >> (levels * slot_bits)) != (now_ >> (levels * slot_bits))) {
+      // beyond the wheel, parked in the furthest slot of the last level
+      slot = (now_ >> (level * slot_bits)) - 1;
+    }
+    timer.level_ = static_cast<uint16_t>(level);
+    timer.slot_ = static_cast<uint16_t>(slot & slot_mask);
+    uint32_t& head = slots_[level][timer.slot_];
+    timer.prev_ = none;
+    timer.next_ = head;
+    if (head != none) { timers_[head].prev_ = t; }
+    head = t;
+  }
+
+  void Unlink(uint32_t t) {
+    Timer& timer = timers_[t];
+    if (timer.prev_ != none) {
+      timers_[timer.prev_].next_ = timer.next_;
+    } else {
+      slots_[timer.level_][timer.slot_] = timer.next_;
+    }
+    if (timer.next_ != none) { timers_[timer.next_].prev_ = timer.prev_; }
+  }
+
+  /* Place again the timers of the slot of level reached at now_, the slot of now_ in
+   *   the first level is yet to fire */
+  void Cascade(int level) {
+    uint32_t& head = slots_[level][(now_ >> (level * slot_bits)) & slot_mask];
+    uint32_t t = head;
+    head = none;
+    while (t != none) {
+      uint32_t next = timers_[t].next_;
+      Place(t, now_);
+      t = next;
+    }
+  }
+
+};
+
+#endif /* TIMER_H */
@@ -0,0 +1,205 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "uring.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static inline int io_uring_setup(unsigned entries, io_uring_params* p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static inline int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+/* The rings are shared with the kernel, indices are published with release stores
+ *   and observed with acquire loads */
+
+static inline unsigned LoadAcquire(unsigned* p) {
+  return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+static inline void StoreRelease(unsigned* p, unsigned v) {
+  std::atomic_ref<unsigned>(*p).store(v, std::memory_order_release);
+}
+
+Uring::~Uring() {
+  // closing the ring cancels in flight requests, buffers are freed afterwards
+  if (ring_fd_ >= 0) { close(ring_fd_); }
+  if (sqes_) { munmap(sqes_, sqes_len_); }
+  if (cq_ptr_ && cq_ptr_ != sq_ptr_) { munmap(cq_ptr_, cq_len_); }
+  if (sq_ptr_) { munmap(sq_ptr_, sq_len_); }
+}
+
+bool Uring::Init(unsigned entries) {
+  io_uring_params p{};
+  ring_fd_ = io_uring_setup(entries, &p);
+  if (ring_fd_ < 0) { return false; }
+  cqe_skip_ = p.features & IORING_FEAT_CQE_SKIP;
+
+  sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+  }
+
+  sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; return false; }
+  if (single_mmap) {
+    cq_ptr_ = sq_ptr_;
+  } else {
+    cq_ptr_ = mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; return false; }
+  }
+  sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) { return false; }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  char* sq = static_cast<char*>(sq_ptr_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+  char* cq = static_cast<char*>(cq_ptr_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+  return true;
+}
+
+bool Uring::ProvideBufs(uint16_t bgid, unsigned n_bufs, size_t buf_size) {
+  bgid_ = bgid;
+  buf_size_ = buf_size;
+  bufs_ = std::make_unique<char[]>(n_bufs * buf_size);
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return false; }
+  PrepProvideBufs(sqe, 0, n_bufs);
+  sqe->flags = 0;
+  sqe->user_data = 0;
+  recycle_sqe_ = nullptr;
+  // wait for the outcome here, later recycles do not report success
+  if (Submit(1) < 0) { return false; }
+  io_uring_cqe cqe;
+  return PopCqe(cqe) && cqe.res >= 0;
+}
+
+void Uring::RecycleBuf(uint16_t bid) {
+  if (recycle_sqe_ && recycle_sqe_->off + recycle_sqe_->fd == bid) {
+    recycle_sqe_->fd++;
+    return;
+  }
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return; }
+  PrepProvideBufs(sqe, bid, 1);
+  recycle_sqe_ = sqe;
+}
+
+void Uring::PrepProvideBufs(io_uring_sqe* sqe, uint16_t bid, unsigned n_bufs) {
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = static_cast<int>(n_bufs);
+  sqe->addr = reinterpret_cast<uint64_t>(GetBuf(bid));
+  sqe->len = static_cast<uint32_t>(buf_size_);
+  sqe->off = bid;
+  sqe->buf_group = bgid_;
+  // failures still complete, with user data 0 which no caller uses
+  sqe->flags = cqe_skip_ ? IOSQE_CQE_SKIP_SUCCESS : 0;
+  sqe->user_data = 0;
+}
+
+io_uring_sqe* Uring::GetSqe() {
+  unsigned tail = *sq_tail_;
+  if (tail - LoadAcquire(sq_head_) > *sq_mask_) {
+    Submit(0);
+    tail = *sq_tail_;
+    if (tail - LoadAcquire(sq_head_) > *sq_mask_) { return nullptr; }
+  }
+  unsigned idx = tail & *sq_mask_;
+  io_uring_sqe* sqe = &sqes_[idx];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sq_array_[idx] = idx;
+  StoreRelease(sq_tail_, tail + 1);
+  sq_pending_++;
+  return sqe;
+}
+
+int Uring::Submit(unsigned min_complete) {
+  unsigned to_submit = sq_pending_;
+  recycle_sqe_ = nullptr;
+  unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  if (to_submit == 0 && min_complete == 0) { return 0; }
+  int r = io_uring_enter(ring_fd_, to_submit, min_complete, flags);
+  if (r < 0) {
+    // nothing was taken, the entries stay queued for the next submit
+    return errno == EINTR ? 0 : r;
+  }
+  sq_pending_ -= std::min<unsigned>(r, to_submit);
+  return r;
+}
+
+bool Uring::PopCqe(io_uring_cqe& cqe) {
+  unsigned head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_)) { return false; }
+  cqe = cqes_[head & *cq_mask_];
+  StoreRelease(cq_head_, head + 1);
+  return true;
+}
+
+bool Uring::PrepRecvMsgMultishot(int fd, msghdr* msg, uint16_t bgid, uint64_t user_data) {
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return false; }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(msg);
+  sqe->len = 1;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = bgid;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::PrepNop(uint64_t user_data) {
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return false; }
+  sqe->opcode = IORING_OP_NOP;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::PrepSendMsg(int fd, const msghdr* msg, uint64_t user_data) {
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return false; }
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(msg);
+  sqe->len = 1;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::PrepRead(int fd, void* buf, unsigned len, uint64_t user_data) {
+  io_uring_sqe* sqe = GetSqe();
+  if (!sqe) { return false; }
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = len;
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->user_data = user_data;
+  return true;
+}
+
+#endif /* __linux__ */
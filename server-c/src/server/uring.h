@@ -0,0 +1,113 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <uring.h> file implements a minimal io_uring wrapper used by the server's
+ * completion driven transport. It talks to the kernel with raw syscalls so that no
+ * liburing is needed, and is only available on linux.
+ *
+ * Receive buffers are handed over with IORING_OP_PROVIDE_BUFFERS rather than a
+ * registered buffer ring, the former is available on every kernel with multishot
+ * receive while the latter depends on how the ring memory gets pinned. */
+
+#ifndef URING_H
+#define URING_H
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+class Uring
+{
+ public:
+
+  Uring() = default;
+
+  Uring(const Uring&) = delete;
+  Uring& operator=(const Uring&) = delete;
+
+  ~Uring();
+
+  /* Set up a ring with the given number of submission entries,
+   *   returns false if io_uring is not supported by the kernel */
+  bool Init(unsigned entries);
+
+  /* Hand n_bufs buffers of buf_size bytes to the kernel as buffer group bgid,
+   *   receives with buffer selection pick one of them per datagram */
+  bool ProvideBufs(uint16_t bgid, unsigned n_bufs, size_t buf_size);
+
+  /* Get a free submission entry, submits queued entries first if the queue is full */
+  io_uring_sqe* GetSqe();
+
+  /* Submit queued entries and wait for at least min_complete completions, entries
+   *   the kernel did not take stay queued for the next call */
+  int Submit(unsigned min_complete);
+
+  /* Copy out the next completion and advance the completion queue head,
+   *   returns false if the completion queue is empty */
+  bool PopCqe(io_uring_cqe& cqe);
+
+  /* Provided buffers */
+
+  char* GetBuf(uint16_t bid) { return bufs_.get() + bid * buf_size_; }
+
+  size_t GetBufSize() const { return buf_size_; }
+
+  /* Give a consumed provided buffer back to the kernel, consecutive buffers
+   *   recycled before the next submit share one submission entry */
+  void RecycleBuf(uint16_t bid);
+
+  /* Submission helpers, return false if no submission entry is available */
+
+  bool PrepRecvMsgMultishot(int fd, msghdr* msg, uint16_t bgid, uint64_t user_data);
+
+  bool PrepNop(uint64_t user_data);
+
+  bool PrepSendMsg(int fd, const msghdr* msg, uint64_t user_data);
+
+  bool PrepRead(int fd, void* buf, unsigned len, uint64_t user_data);
+
+ private:
+
+  int ring_fd_ = -1;
+
+  /* submission queue ring */
+  void* sq_ptr_ = nullptr;
+  size_t sq_len_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_len_ = 0;
+  /* entries queued but not yet handed to the kernel */
+  unsigned sq_pending_ = 0;
+
+  /* completion queue ring, shares sq_ptr_ with IORING_FEAT_SINGLE_MMAP */
+  void* cq_ptr_ = nullptr;
+  size_t cq_len_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  /* whether the kernel can skip completions of successful requests */
+  bool cqe_skip_ = false;
+
+  /* provided buffers */
+  uint16_t bgid_ = 0;
+  size_t buf_size_ = 0;
+  std::unique_ptr<char[]> bufs_;
+  /* queued recycle entry, extended while buffers are given back in order */
+  io_uring_sqe* recycle_sqe_ = nullptr;
+
+  void PrepProvideBufs(io_uring_sqe* sqe, uint16_t bid, unsigned n_bufs);
+
+};
+
+#endif /* __linux__ */
+
+#endif /* URING_H */
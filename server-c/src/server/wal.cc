@@ -0,0 +1,147 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao */
+
+#include "wal.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr size_t frame_header_len = 2 * sizeof(uint32_t);
+
+/* fnv-1a, enough to tell a torn record from a complete one */
+static uint32_t Checksum(const char* data, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool Wal::Open(const std::string& path, uint64_t from, 
+               const std::function<void(const char*, size_t)>& replay, std::function<void()> on_durable) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    perror("open wal");
+    return false;
+  }
+  // the records before from are covered by a snapshot, which cannot be ahead of the log
+  off_t size = lseek(fd_, 0, SEEK_END);
+  if (size < 0 || from > static_cast<uint64_t>(size)) {
+    fprintf(stderr, "wal %s ends before offset %llu\n", path.c_str(), static_cast<unsigned long long>(from));
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  lseek(fd_, static_cast<off_t>(from), SEEK_SET);
+  std::vector<char> log;
+  char buf[1 << 16];
+  ssize_t n;
+  while ((n = read(fd_, buf, sizeof(buf))) > 0) {
+    log.insert(log.end(), buf, buf + n);
+  }
+  // replay up to the first record that is cut short or does not match its checksum
+  size_t pos = 0;
+  while (pos + frame_header_len <= log.size()) {
+    uint32_t len, sum;
+    std::memcpy(&len, log.data() + pos, sizeof(len));
+    std::memcpy(&sum, log.data() + pos + sizeof(len), sizeof(sum));
+    const char* record = log.data() + pos + frame_header_len;
+    if (len > log.size() - pos - frame_header_len || Checksum(record, len) != sum) { break; }
+    replay(record, len);
+    pos += frame_header_len + len;
+  }
+  base_ = from + pos;
+  if (pos < log.size() && ftruncate(fd_, static_cast<off_t>(base_)) < 0) {
+    perror("ftruncate wal");
+  }
+  lseek(fd_, static_cast<off_t>(base_), SEEK_SET);
+  on_durable_ = std::move(on_durable);
+  syncer_ = std::thread(&Wal::Sync, this);
+  return true;
+}
+
+uint64_t Wal::Append(const char* record, size_t n) {
+  uint32_t len = static_cast<uint32_t>(n);
+  uint32_t sum = Checksum(record, n);
+  uint64_t lsn;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const char* len_bytes = reinterpret_cast<const char*>(&len);
+    const char* sum_bytes = reinterpret_cast<const char*>(&sum);
+    batch_.insert(batch_.end(), len_bytes, len_bytes + sizeof(len));
+    batch_.insert(batch_.end(), sum_bytes, sum_bytes + sizeof(sum));
+    batch_.insert(batch_.end(), record, record + n);
+    appended_ += frame_header_len + n;
+    lsn = appended_;
+  }
+  cv_.notify_one();
+  return lsn;
+}
+
+bool Wal::SyncTo(uint64_t offset, int timeout_ms) const {
+  struct stat st;
+  for (int waited = 0; fstat(fd_, &st) == 0; ++waited) {
+    if (static_cast<uint64_t>(st.st_size) >= offset) { return fdatasync(fd_) == 0; }
+    if (waited == timeout_ms) { break; }
+    usleep(1000);
+  }
+  return false;
+}
+
+void Wal::Close() {
+  if (syncer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    syncer_.join();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void Wal::Sync() {
+  std::vector<char> writing;
+  while (true) {
+    uint64_t lsn;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || !batch_.empty(); });
+      if (batch_.empty()) { return; }
+      // take the whole batch, the shard starts filling the next one right away
+      writing.swap(batch_);
+      lsn = appended_;
+    }
+    size_t off = 0;
+    while (off < writing.size()) {
+      ssize_t n = write(fd_, writing.data() + off, writing.size() - off);
+      if (n < 0) {
+        if (errno == EINTR) { continue; }
+        Fail("write wal");
+        return;
+      }
+      off += n;
+    }
+    if (fdatasync(fd_) < 0) {
+      Fail("fdatasync wal");
+      return;
+    }
+    writing.clear();
+    durable_.store(lsn, std::memory_order_release);
+    if (on_durable_) { on_durable_(); }
+  }
+}
+
+void Wal::Fail(const char* what) {
+  perror(what);
+  failed_.store(true, std::memory_order_release);
+  if (on_durable_) { on_durable_(); }
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <wal.h> file implements the write-ahead log of a shard.
+ *
+ * The shard appends records to an in memory batch and goes on serving, a syncer
+ * thread writes out whatever has been appended and makes it durable with a single
+ * fdatasync. Records appended while a sync is running form the next batch, so under
+ * load one fdatasync covers many requests. */
+
+#ifndef WAL_H
+#define WAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Append only log of opaque records
+ *
+ *   every record is framed as [u32 length][u32 checksum][bytes], a torn or corrupt
+ *   tail left by a crash is detected by its frame and cut off when the log is opened.
+ *   positions in the log (lsn) count the bytes appended since it was opened, the
+ *   record at lsn 0 sits at file offset Base() */
+class Wal
+{
+ public:
+
+  Wal() = default;
+
+  Wal(const Wal&) = delete;
+  Wal& operator=(const Wal&) = delete;
+
+  ~Wal() { Close(); }
+
+  /* Open or create the log at path, hand every intact record from file offset from
+   *   on to replay in order, then start the syncer, which calls on_durable after every
+   *   sync. returns false if the file cannot be opened or is shorter than from */
+  bool Open(const std::string& path, uint64_t from, 
+            const std::function<void(const char*, size_t)>& replay, std::function<void()> on_durable);
+
+  /* Append a record to the current batch, returns the lsn at which it is durable */
+  uint64_t Append(const char* record, size_t n);
+
+  /* file offset of lsn 0 */
+  uint64_t Base() const { return base_; }
+
+  /* lsn up to which every record is on disk */
+  uint64_t Durable() const { return durable_.load(std::memory_order_acquire); }
+
+  /* whether a write or sync failed, Durable() never advances again once set */
+  bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+  /* Wait until the file holds offset bytes and make them durable, for a process
+   *   forked from the shard, which has no syncer of its own: only syscalls, no lock.
+   *   returns false if they are not written within timeout_ms */
+  bool SyncTo(uint64_t offset, int timeout_ms) const;
+
+  /* Sync what has been appended and stop the syncer */
+  void Close();
+
+ private:
+
+  int fd_ = -1;
+
+  uint64_t base_ = 0;
+
+  std::function<void()> on_durable_;
+
+  std::thread syncer_;
+
+  std::mutex mutex_;
+
+  std::condition_variable cv_;
+
+  /* batch being filled by the shard, guarded by mutex_ */
+  std::vector<char> batch_;
+
+  /* lsn of the end of batch_, guarded by mutex_ */
+  uint64_t appended_ = 0;
+
+  bool stop_ = false;
+
+  std::atomic<uint64_t> durable_ = 0;
+
+  std::atomic<bool> failed_ = false;
+
+  void Sync();
+
+  /* Record a failed write or sync and wake the shard, which must not wait for it */
+  void Fail(const char* what);
+
+};
+
+#endif /* WAL_H */
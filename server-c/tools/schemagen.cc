@@ -0,0 +1,377 @@
+/* Copyright (c) 2026, Yao Zeran, Zhang Chenzhi, Zhang Senyao
+ *
+ * The <schemagen.cc> file emits the client codecs of the request schemas.
+ *
+ * Every message of request_messages in rpc/messages.h becomes a pack and an unpack
+ * function of the python client and a pack method of the java client, in both the
+ * fixed and the compact encoding, so the clients follow the server's layouts. run it
+ * through the codecs target after changing a schema.
+ *
+ *   usage: distbank-schemagen [--python messages.py] [--java Messages.java] */
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "rpc/messages.h"
+
+enum class kind {
+  int32, int64, float32, text, unit, int32_list
+};
+
+template<typename T>
+constexpr kind kind_of() {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    return kind::text;
+  } else if constexpr (std::is_same_v<T, currency>) {
+    return kind::unit;
+  } else if constexpr (std::is_same_v<T, float>) {
+    return kind::float32;
+  } else if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, Money>) {
+    // money travels as its minor units, the clients scale decimals by SCALES
+    return kind::int64;
+  } else if constexpr (std::is_same_v<T, std::vector<int>>) {
+    return kind::int32_list;
+  } else {
+    static_assert(std::is_same_v<T, int>, "no client codec for this field type");
+    return kind::int32;
+  }
+}
+
+/* a schema field as seen by the generator */
+class FieldInfo
+{
+ public:
+  const char* name_;
+  kind kind_;
+  size_t max_len_;
+};
+
+/* name of an op code as used in the generated identifiers */
+static const char* MessageName(op_code c) {
+  switch (c) {
+    case op_code::open: return "open";
+    case op_code::close: return "close";
+    case op_code::check_balance: return "check_balance";
+    case op_code::deposit: return "deposit";
+    case op_code::withdraw: return "withdraw";
+    case op_code::transfer: return "transfer";
+    case op_code::exchange: return "exchange";
+    case op_code::monitor: return "monitor";
+    default: return "error";
+  }
+}
+
+/* snake_case to camelCase, upper case first letter if pascal */
+static std::string Camel(const char* name, bool pascal) {
+  std::string out;
+  bool up = pascal;
+  for (const char* p = name; *p; ++p) {
+    if (*p == '_') {
+      up = true;
+    } else {
+      out += up ? static_cast<char>(toupper(*p)) : *p;
+      up = false;
+    }
+  }
+  return out;
+}
+
+static std::string Upper(const char* name) {
+  std::string out;
+  for (const char* p = name; *p; ++p) { out += static_cast<char>(toupper(*p)); }
+  return out;
+}
+
+template<typename M>
+static std::vector<FieldInfo> FieldsOf() {
+  std::vector<FieldInfo> fields;
+  std::apply([&](const auto&... f) {
+    (fields.push_back(FieldInfo{f.name_, kind_of<std::remove_cvref_t<decltype(std::declval<M&>().*f.member_)>>(),
+                                f.max_len_}), ...);
+  }, message_fields<M>);
+  return fields;
+}
+
+static const char* python_prelude = R"(# Generated by distbank-schemagen from server-c/src/rpc/messages.h, do not edit.
+# Payload codecs of the requests, in the fixed encoding (wire v1 and v2) or the
+# compact one (wire v3): varint integers, zigzag when signed, varint prefixed
+# strings, one byte currencies, floats always 4 bytes little-endian. amounts
+# are integers of minor units, SCALES[c] decimal digits of currency c.
+
+import struct
+from typing import List, Tuple
+
+)";
+
+static const char* python_helpers = R"(
+
+def _varint(v: int) -> bytes:
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _get_varint(data: bytes, i: int) -> Tuple[int, int]:
+    v = 0
+    for shift in range(0, 64, 7):
+        if i >= len(data):
+            raise ValueError("Varint truncated")
+        b = data[i]
+        i += 1
+        v |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return v, i
+    raise ValueError("Varint too long")
+
+
+def _int(v: int, fmt: str, compact: bool) -> bytes:
+    return _varint((v << 1) ^ (v >> 63)) if compact else struct.pack(fmt, v)
+
+
+def _get_int(data: bytes, i: int, fmt: str, compact: bool) -> Tuple[int, int]:
+    if compact:
+        v, i = _get_varint(data, i)
+        return (v >> 1) ^ -(v & 1), i
+    return struct.unpack_from(fmt, data, i)[0], i + struct.calcsize(fmt)
+
+
+def _float(v: float, compact: bool) -> bytes:
+    return struct.pack("<f", v)
+
+
+def _get_float(data: bytes, i: int, compact: bool) -> Tuple[float, int]:
+    return struct.unpack_from("<f", data, i)[0], i + 4
+
+
+def _text(s: str, max_len: int, compact: bool) -> bytes:
+    raw = s.encode("utf-8")
+    if len(raw) > max_len:
+        raise ValueError(f"String of {len(raw)} bytes exceeds {max_len}")
+    return (_varint(len(raw)) if compact else struct.pack("<Q", len(raw))) + raw
+
+
+def _get_text(data: bytes, i: int, max_len: int, compact: bool) -> Tuple[str, int]:
+    if compact:
+        n, i = _get_varint(data, i)
+    else:
+        n, i = struct.unpack_from("<Q", data, i)[0], i + 8
+    if n > max_len or i + n > len(data):
+        raise ValueError("String too long")
+    return data[i : i + n].decode("utf-8", errors="replace"), i + n
+
+
+def _int_list(v: List[int], max_len: int, compact: bool) -> bytes:
+    if len(v) > max_len:
+        raise ValueError(f"List of {len(v)} exceeds {max_len}")
+    count = _varint(len(v)) if compact else struct.pack("<Q", len(v))
+    return count + b"".join(_int(x, "<i", compact) for x in v)
+
+
+def _get_int_list(data: bytes, i: int, max_len: int, compact: bool) -> Tuple[List[int], int]:
+    if compact:
+        n, i = _get_varint(data, i)
+    else:
+        n, i = struct.unpack_from("<Q", data, i)[0], i + 8
+    if n > max_len:
+        raise ValueError("List too long")
+    out = []
+    for _ in range(n):
+        x, i = _get_int(data, i, "<i", compact)
+        out.append(x)
+    return out, i
+
+
+def _unit(s: str, compact: bool) -> bytes:
+    return struct.pack("<B", CURRENCIES.index(s)) if compact else _text(s, 8, False)
+
+
+def _get_unit(data: bytes, i: int, compact: bool) -> Tuple[str, int]:
+    if compact:
+        if i >= len(data) or data[i] >= len(CURRENCIES):
+            raise ValueError("Invalid currency")
+        return CURRENCIES[data[i]], i + 1
+    s, i = _get_text(data, i, 8, False)
+    if s not in CURRENCIES:
+        raise ValueError("Invalid currency")
+    return s, i
+)";
+
+static const char* PythonType(kind k) {
+  switch (k) {
+    case kind::int32: case kind::int64: return "int";
+    case kind::float32: return "float";
+    case kind::int32_list: return "List[int]";
+    default: return "str";
+  }
+}
+
+static std::string PythonPack(const FieldInfo& f) {
+  std::string name = f.name_;
+  switch (f.kind_) {
+    case kind::int32: return "_int(" + name + ", \"<i\", compact)";
+    case kind::int64: return "_int(" + name + ", \"<q\", compact)";
+    case kind::float32: return "_float(" + name + ", compact)";
+    case kind::text: return "_text(" + name + ", " + std::to_string(f.max_len_) + ", compact)";
+    case kind::int32_list: return "_int_list(" + name + ", " + std::to_string(f.max_len_) + ", compact)";
+    default: return "_unit(" + name + ", compact)";
+  }
+}
+
+static std::string PythonUnpack(const FieldInfo& f) {
+  switch (f.kind_) {
+    case kind::int32: return "_get_int(data, i, \"<i\", compact)";
+    case kind::int64: return "_get_int(data, i, \"<q\", compact)";
+    case kind::float32: return "_get_float(data, i, compact)";
+    case kind::text: return "_get_text(data, i, " + std::to_string(f.max_len_) + ", compact)";
+    case kind::int32_list: return "_get_int_list(data, i, " + std::to_string(f.max_len_) + ", compact)";
+    default: return "_get_unit(data, i, compact)";
+  }
+}
+
+template<typename M>
+static void EmitPython(FILE* out) {
+  const char* name = MessageName(M::code);
+  std::vector<FieldInfo> fields = FieldsOf<M>();
+  fprintf(out, "\n\n# --- %s ---\n", name);
+  fprintf(out, "OP_%s = %d\n", Upper(name).c_str(), op_code_to_int(M::code));
+  fprintf(out, "%s_MAX_SIZE = %zu\n", Upper(name).c_str(), max_message_size<M>(false));
+  fprintf(out, "%s_MAX_SIZE_COMPACT = %zu\n\n\n", Upper(name).c_str(), max_message_size<M>(true));
+
+  fprintf(out, "def pack_%s(", name);
+  for (const FieldInfo& f : fields) { fprintf(out, "%s: %s, ", f.name_, PythonType(f.kind_)); }
+  fprintf(out, "compact: bool = False) -> bytes:\n    return b\"\".join((\n");
+  for (const FieldInfo& f : fields) { fprintf(out, "        %s,\n", PythonPack(f).c_str()); }
+  fprintf(out, "    ))\n\n\n");
+
+  fprintf(out, "def unpack_%s(data: bytes, compact: bool = False) -> dict:\n    i = 0\n", name);
+  for (const FieldInfo& f : fields) { fprintf(out, "    %s, i = %s\n", f.name_, PythonUnpack(f).c_str()); }
+  fprintf(out, "    return {");
+  for (size_t k = 0; k < fields.size(); ++k) {
+    fprintf(out, "%s\"%s\": %s", k ? ", " : "", fields[k].name_, fields[k].name_);
+  }
+  fprintf(out, "}\n");
+}
+
+static const char* JavaType(kind k) {
+  switch (k) {
+    case kind::int32: return "int";
+    case kind::int64: return "long";
+    case kind::float32: return "float";
+    case kind::int32_list: return "int[]";
+    default: return "String";
+  }
+}
+
+static std::string JavaPack(const FieldInfo& f) {
+  std::string name = Camel(f.name_, false);
+  switch (f.kind_) {
+    case kind::int32:
+      return "if (compact) Marshaller.packCompactInt(buf, " + name + "); else Marshaller.packInt(buf, " + name + ");";
+    case kind::int64:
+      return "if (compact) Marshaller.packCompactInt(buf, " + name + "); else Marshaller.packLong(buf, " + name + ");";
+    case kind::float32:
+      return "Marshaller.packFloat(buf, " + name + ");";
+    case kind::text:
+      return "checkLength(" + name + ", " + std::to_string(f.max_len_) + ");\n        "
+        "if (compact) Marshaller.packCompactString(buf, " + name + "); else Marshaller.packString(buf, " + name + ");";
+    case kind::int32_list:
+      return "packIntList(buf, compact, " + name + ", " + std::to_string(f.max_len_) + ");";
+    default:
+      return "if (compact) Marshaller.packCompactCurrency(buf, " + name + "); else Marshaller.packString(buf, " + name +
+        ");";
+  }
+}
+
+template<typename M>
+static void EmitJava(FILE* out) {
+  const char* name = MessageName(M::code);
+  std::vector<FieldInfo> fields = FieldsOf<M>();
+  fprintf(out, "\n    // === %s ===\n\n", name);
+  fprintf(out, "    public static final int %s_MAX_SIZE = %zu;\n", Upper(name).c_str(), max_message_size<M>(false));
+  fprintf(out, "    public static final int %s_MAX_SIZE_COMPACT = %zu;\n\n", Upper(name).c_str(),
+          max_message_size<M>(true));
+  fprintf(out, "    public static void pack%s(ByteBuffer buf, boolean compact", Camel(name, true).c_str());
+  for (const FieldInfo& f : fields) { fprintf(out, ", %s %s", JavaType(f.kind_), Camel(f.name_, false).c_str()); }
+  fprintf(out, ") {\n        buf.order(ByteOrder.LITTLE_ENDIAN);\n");
+  for (const FieldInfo& f : fields) { fprintf(out, "        %s\n", JavaPack(f).c_str()); }
+  fprintf(out, "    }\n");
+}
+
+static bool WritePython(const char* path) {
+  FILE* out = fopen(path, "w");
+  if (!out) { return false; }
+  fputs(python_prelude, out);
+  fputs("CURRENCIES = [", out);
+  for (size_t c = 0; c < n_currencies; ++c) {
+    fprintf(out, "%s\"%s\"", c ? ", " : "", currency_name(static_cast<currency>(c)));
+  }
+  fputs("]\nSCALES = [", out);
+  for (size_t c = 0; c < n_currencies; ++c) {
+    fprintf(out, "%s%d", c ? ", " : "", currency_scale(static_cast<currency>(c)));
+  }
+  fputs("]\n", out);
+  fputs(python_helpers, out);
+  std::apply([&](auto... m) { (EmitPython<decltype(m)>(out), ...); }, request_messages{});
+  return fclose(out) == 0;
+}
+
+static bool WriteJava(const char* path) {
+  FILE* out = fopen(path, "w");
+  if (!out) { return false; }
+  fputs("// Generated by distbank-schemagen from server-c/src/rpc/messages.h, do not edit.\n"
+        "package common;\n\n"
+        "import java.nio.ByteBuffer;\n"
+        "import java.nio.ByteOrder;\n"
+        "import java.nio.charset.StandardCharsets;\n\n"
+        "/** Payload layouts of the requests, fixed (wire v1 and v2) or compact (wire v3). */\n"
+        "public final class Messages {\n\n"
+        "    private Messages() {}\n\n", out);
+  fputs("    /** Decimal digits of the minor units of each currency, amounts are sent in minor units. */\n"
+        "    public static final int[] SCALES = {", out);
+  for (size_t c = 0; c < n_currencies; ++c) {
+    fprintf(out, "%s%d", c ? ", " : "", currency_scale(static_cast<currency>(c)));
+  }
+  fputs("};\n\n"
+        "    private static void checkLength(String text, int maxLength) {\n"
+        "        if (text != null && text.getBytes(StandardCharsets.UTF_8).length > maxLength) {\n"
+        "            throw new IllegalArgumentException(\"String exceeds \" + maxLength + \" bytes\");\n"
+        "        }\n"
+        "    }\n\n"
+        "    private static void packIntList(ByteBuffer buf, boolean compact, int[] list, int maxLength) {\n"
+        "        if (list == null) list = new int[0];\n"
+        "        if (list.length > maxLength) {\n"
+        "            throw new IllegalArgumentException(\"List exceeds \" + maxLength + \" entries\");\n"
+        "        }\n"
+        "        if (compact) Marshaller.packVarInt(buf, list.length); else Marshaller.packLong(buf, list.length);\n"
+        "        for (int v : list) {\n"
+        "            if (compact) Marshaller.packCompactInt(buf, v); else Marshaller.packInt(buf, v);\n"
+        "        }\n"
+        "    }\n", out);
+  std::apply([&](auto... m) { (EmitJava<decltype(m)>(out), ...); }, request_messages{});
+  fputs("}\n", out);
+  return fclose(out) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    bool ok = true;
+    if (strcmp(argv[i], "--python") == 0) {
+      ok = WritePython(argv[i + 1]);
+    } else if (strcmp(argv[i], "--java") == 0) {
+      ok = WriteJava(argv[i + 1]);
+    }
+    if (!ok) {
+      fprintf(stderr, "cannot write %s\n", argv[i + 1]);
+      return 1;
+    }
+  }
+  return 0;
+}